@@ -0,0 +1,76 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace aoe {
+
+/** Keeps track of iterations for a single benchmark run. */
+class BenchState final {
+	uint64_t iter, max;
+public:
+	BenchState(uint64_t max) : iter(0), max(max) {}
+
+	/** Returns whether another iteration should be run. */
+	bool next() noexcept { return iter++ < max; }
+
+	uint64_t iterations() const noexcept { return max; }
+};
+
+typedef std::function<void(BenchState&)> BenchFunc;
+
+class Benchmark final {
+public:
+	std::string name;
+	BenchFunc fn;
+	bool once; // does its own timing and reporting
+
+	Benchmark(const std::string &name, BenchFunc fn, bool once) : name(name), fn(fn), once(once) {}
+};
+
+std::vector<Benchmark> &benchmarks();
+
+class BenchRegister final {
+public:
+	BenchRegister(const char *name, BenchFunc fn, bool once=false) {
+		benchmarks().emplace_back(name, fn, once);
+	}
+};
+
+/** Value of command line option \a name=value or \a def if not specified. */
+unsigned bench_arg(const char *name, unsigned def);
+/** Same as bench_arg, but for options that aren't numbers. */
+std::string bench_str(const char *name, const std::string &def);
+
+/** Total number of operator new calls so far. */
+uint64_t bench_allocs() noexcept;
+
+/** Prevent the compiler from optimizing \a v away. */
+template<typename T> static inline void bench_keep(const T &v) noexcept {
+#if defined(__GNUC__) || defined(__clang__)
+	asm volatile("" : : "r,m"(v) : "memory");
+#else
+	static volatile const void *sink;
+	sink = &v;
+#endif
+}
+
+#define BENCH_CAT2(a, b) a ## b
+#define BENCH_CAT(a, b) BENCH_CAT2(a, b)
+
+/** Define benchmark \a name. The body must loop over BenchState::next(). */
+#define BENCH(name) \
+	static void bench_ ## name(::aoe::BenchState&); \
+	static ::aoe::BenchRegister BENCH_CAT(bench_reg_, name)(#name, bench_ ## name); \
+	static void bench_ ## name(::aoe::BenchState &state)
+
+/** Define benchmark \a name that is run exactly once and reports its own results. */
+#define BENCH_RUN(name) \
+	static void bench_ ## name(::aoe::BenchState&); \
+	static ::aoe::BenchRegister BENCH_CAT(bench_reg_, name)(#name, bench_ ## name, true); \
+	static void bench_ ## name(::aoe::BenchState&)
+
+}
@@ -0,0 +1,152 @@
+#include "bench.hpp"
+
+#include "../src/server.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+namespace aoe {
+
+/** What World::add_event and pump_events used to do: one mutex around a deque, held while processing. */
+class LockedEvents final {
+	std::mutex m;
+	std::deque<WorldEvent> q;
+public:
+	LockedEvents() : m(), q() {}
+
+	void add(const EntityTask &task) {
+		std::lock_guard<std::mutex> lk(m);
+		q.emplace_back(invalid_ref, WorldEventType::entity_task, task);
+	}
+
+	template<typename F> size_t pump(F fn) {
+		std::lock_guard<std::mutex> lk(m);
+		size_t n = q.size();
+
+		for (WorldEvent &ev : q)
+			fn(ev);
+
+		q.clear();
+		return n;
+	}
+};
+
+class QueuedEvents final {
+	MpscQueue<WorldEvent> q;
+	std::vector<WorldEvent> batch;
+public:
+	uint64_t stalled;
+
+	QueuedEvents() : q(World::event_queue_size), batch(), stalled(0) {}
+
+	void add(const EntityTask &task) {
+		if (q.try_emplace(invalid_ref, WorldEventType::entity_task, task))
+			return;
+
+		++stalled;
+
+		while (!q.try_emplace(invalid_ref, WorldEventType::entity_task, task))
+			std::this_thread::sleep_for(std::chrono::microseconds(100));
+	}
+
+	template<typename F> size_t pump(F fn) {
+		batch.clear();
+		size_t n = q.drain(batch);
+
+		for (WorldEvent &ev : batch)
+			fn(ev);
+
+		return n;
+	}
+
+	MpscStats stats() const noexcept { return q.stats(); }
+};
+
+/**
+ * Producers add bursts of events like network threads would, while the consumer pumps the queue
+ * once per tick and spends some time on every event like the world thread would. What matters is
+ * how long producers are held up, because that is time the network thread isn't doing I/O.
+ */
+template<typename Q> static void bench_events(const char *name, Q &q, unsigned producers, unsigned count, unsigned burst, unsigned work) {
+	using namespace std::chrono;
+
+	std::vector<std::thread> threads;
+	std::vector<std::vector<uint32_t>> waits(producers); // ns per add
+	std::atomic<unsigned> running(producers);
+	size_t total = (size_t)producers * count, done = 0, pumps = 0;
+	uint64_t sink = 0;
+
+	auto start = steady_clock::now();
+
+	for (unsigned p = 0; p < producers; ++p)
+		threads.emplace_back([&q, &waits, &running, count, burst, p] {
+			std::vector<uint32_t> &w = waits[p];
+			w.reserve(count);
+
+			for (unsigned i = 0; i < count; ++i) {
+				auto t0 = steady_clock::now();
+				q.add(EntityTask(IdPoolRef(p + 1, i), i % 256, i / 256 % 256));
+				w.emplace_back((uint32_t)std::min<int64_t>(UINT32_MAX, duration_cast<nanoseconds>(steady_clock::now() - t0).count()));
+
+				if (i % burst == burst - 1)
+					std::this_thread::sleep_for(microseconds(100));
+			}
+
+			--running;
+		});
+
+	while (done < total) {
+		done += q.pump([&sink, work](const WorldEvent &ev) {
+			const EntityTask &task = std::get<EntityTask>(ev.data);
+
+			for (unsigned i = 0; i < work; ++i)
+				sink = sink * 31 + task.x + i;
+		});
+
+		++pumps;
+		// eventloop sleeps between ticks too
+		if (running)
+			std::this_thread::sleep_for(microseconds(500));
+	}
+
+	for (std::thread &t : threads)
+		t.join();
+
+	double s = duration<double>(steady_clock::now() - start).count();
+	bench_keep(sink);
+
+	std::vector<uint32_t> all;
+	for (const std::vector<uint32_t> &w : waits)
+		all.insert(all.end(), w.begin(), w.end());
+
+	std::sort(all.begin(), all.end());
+	double mean = 0;
+	for (uint32_t ns : all)
+		mean += ns;
+	mean /= all.size();
+
+	printf("%-6s %u producers: %zu events in %.3f s over %zu pumps, add: %.2f us mean, %.1f us p99, %.1f us p99.9, %.1f us worst\n",
+		name, producers, total, s, pumps, mean / 1000, all[all.size() * 99 / 100] / 1000.0,
+		all[all.size() * 999 / 1000] / 1000.0, all.back() / 1000.0);
+}
+
+BENCH_RUN(Events_Contention) {
+	unsigned producers = bench_arg("producers", 4), count = bench_arg("events", 20000);
+	unsigned burst = std::max(1u, bench_arg("burst", 16)), work = bench_arg("work", 2000);
+
+	LockedEvents locked;
+	bench_events("mutex", locked, producers, count, burst, work);
+
+	QueuedEvents queued;
+	bench_events("mpsc", queued, producers, count, burst, work);
+
+	MpscStats st(queued.stats());
+	printf("mpsc: %llu events, at most %zu per pump, queue full %llu times, %llu adds stalled\n",
+		(unsigned long long)st.drained, st.peak, (unsigned long long)st.full, (unsigned long long)queued.stalled);
+}
+
+}
@@ -0,0 +1,111 @@
+#include "bench.hpp"
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <new>
+
+static std::atomic<uint64_t> alloc_count;
+
+void *operator new(size_t n) {
+	alloc_count.fetch_add(1, std::memory_order_relaxed);
+
+	void *p = malloc(n ? n : 1);
+	if (!p)
+		throw std::bad_alloc();
+
+	return p;
+}
+
+void operator delete(void *p) noexcept {
+	free(p);
+}
+
+void operator delete(void *p, size_t) noexcept {
+	free(p);
+}
+
+namespace aoe {
+
+static std::map<std::string, std::string> args;
+
+std::vector<Benchmark> &benchmarks() {
+	static std::vector<Benchmark> lst;
+	return lst;
+}
+
+unsigned bench_arg(const char *name, unsigned def) {
+	auto it = args.find(name);
+	return it == args.end() ? def : (unsigned)strtoul(it->second.c_str(), NULL, 0);
+}
+
+std::string bench_str(const char *name, const std::string &def) {
+	auto it = args.find(name);
+	return it == args.end() ? def : it->second;
+}
+
+uint64_t bench_allocs() noexcept {
+	return alloc_count.load(std::memory_order_relaxed);
+}
+
+/** Run \a b. Unless it runs once, repeat with increasing iteration counts until the time per iteration is stable. */
+static void run(const Benchmark &b) {
+	using namespace std::chrono;
+
+	if (b.once) {
+		BenchState state(1);
+		printf("%s\n", b.name.c_str());
+		b.fn(state);
+		return;
+	}
+
+	uint64_t n = 1;
+	double elapsed = 0;
+
+	for (;;) {
+		BenchState state(n);
+
+		auto start = steady_clock::now();
+		b.fn(state);
+		elapsed = duration<double>(steady_clock::now() - start).count();
+
+		if (elapsed >= 0.5 || n >= (UINT64_C(1) << 40))
+			break;
+
+		n = elapsed < 1e-3 ? n * 10 : (uint64_t)(n * 0.6 / elapsed) + 1;
+	}
+
+	printf("%-40s %12llu %14.2f ns/op\n", b.name.c_str(), (unsigned long long)n, elapsed * 1e9 / n);
+}
+
+}
+
+int main(int argc, char **argv) {
+	using namespace aoe;
+
+	// arguments are either name=value options or filters: only run benchmarks whose name contains any of them
+	std::vector<const char*> filters;
+
+	for (int i = 1; i < argc; ++i) {
+		const char *eq = strchr(argv[i], '=');
+
+		if (eq)
+			args[std::string(argv[i], eq - argv[i])] = eq + 1;
+		else
+			filters.emplace_back(argv[i]);
+	}
+
+	for (const Benchmark &b : benchmarks()) {
+		bool match = filters.empty();
+
+		for (size_t i = 0; i < filters.size() && !match; ++i)
+			match = strstr(b.name.c_str(), filters[i]) != nullptr;
+
+		if (match)
+			run(b);
+	}
+
+	return 0;
+}
@@ -0,0 +1,65 @@
+#include "bench.hpp"
+
+#include "../src/world/motion.hpp"
+
+#include <random>
+
+namespace aoe {
+
+static constexpr int32_t walk_speed = Fixed(0.04f).raw; // medium, like villagers
+
+/** Per tick movement as it was before units cached their direction: distance, angle and step every tick. */
+static void step_uncached(EntityMotion &mv, std::vector<float> &angle) noexcept {
+	for (size_t i = 0; i < mv.size(); ++i) {
+		int64_t dx = (int64_t)mv.wx[i] - mv.x[i], dy = (int64_t)mv.wy[i] - mv.y[i];
+		int64_t distance = (int64_t)isqrt((uint64_t)(dx * dx + dy * dy));
+
+		if (dx || dy)
+			angle[i] = angle_of(dx, dy);
+
+		if (distance <= walk_speed) {
+			mv.x[i] = mv.wx[i];
+			mv.y[i] = mv.wy[i];
+			mv.arrived[i] = 1;
+		} else {
+			mv.x[i] += (int32_t)(dx * walk_speed / distance);
+			mv.y[i] += (int32_t)(dy * walk_speed / distance);
+		}
+	}
+}
+
+/** \a n units walking somewhere far away on a 1024x1024 map, so nobody arrives while we measure. */
+static void bench_walkers(EntityMotion &mv, unsigned n) {
+	std::mt19937 rng(1);
+	std::uniform_real_distribution<float> pos(0, 1024);
+
+	mv.clear();
+
+	for (unsigned i = 0; i < n; ++i) {
+		Fixed x(pos(rng)), y(pos(rng));
+		mv.add(i, x, y, Fixed(pos(rng)), Fixed(pos(rng)), Fixed(0.03f), Fixed(-0.02f), UINT32_MAX >> 1);
+	}
+}
+
+BENCH(EntityMotion_Step) {
+	EntityMotion mv;
+	bench_walkers(mv, bench_arg("units", 10000));
+
+	while (state.next()) {
+		mv.step();
+		bench_keep(mv.x[0]);
+	}
+}
+
+BENCH(EntityMotion_StepUncached) {
+	EntityMotion mv;
+	bench_walkers(mv, bench_arg("units", 10000));
+	std::vector<float> angle(mv.size());
+
+	while (state.next()) {
+		step_uncached(mv, angle);
+		bench_keep(mv.x[0]);
+	}
+}
+
+}
@@ -0,0 +1,207 @@
+#include "bench.hpp"
+
+#include "../src/server.hpp"
+
+#include <climits>
+#include <cmath>
+#include <cstdarg>
+#include <stdexcept>
+
+namespace aoe {
+
+/**
+ * Copy of the runtime format string parser of NetPkg::writef, for the formats entity updates used.
+ * Kept here as a baseline for NetSchema, NetPkg doesn't expose its own.
+ */
+static void writef(std::vector<uint8_t> &data, const char *fmt, ...) {
+	unsigned mult = 0;
+	va_list args;
+
+	va_start(args, fmt);
+
+	for (unsigned ch; (ch = *fmt) != '\0'; ++fmt) {
+		if (ch >= '0' && ch <= '9') {
+			mult = 10 * mult + (ch - '0');
+			continue;
+		}
+
+		if (!mult)
+			mult = 1;
+
+		switch (ch) {
+		case 'b': case 'B': // int8/uint8
+			for (unsigned i = 0; i < mult; ++i)
+				data.emplace_back((uint8_t)va_arg(args, unsigned));
+			break;
+		case 'h': case 'H': // int16/uint16
+			for (unsigned i = 0; i < mult; ++i) {
+				uint16_t v = (uint16_t)va_arg(args, unsigned);
+				data.emplace_back(v >> 8);
+				data.emplace_back(v & 0xff);
+			}
+			break;
+		case 'i': case 'I': // int32/uint32
+			for (unsigned i = 0; i < mult; ++i) {
+				uint32_t v = va_arg(args, unsigned);
+				data.emplace_back(v >> 24);
+				data.emplace_back(v >> 16);
+				data.emplace_back(v >> 8);
+				data.emplace_back(v & 0xff);
+			}
+			break;
+		case 'F': // truncated float (cast to int32)
+			for (unsigned i = 0; i < mult; ++i) {
+				int32_t v = (int32_t)va_arg(args, double);
+				data.emplace_back(v >> 24);
+				data.emplace_back(v >> 16);
+				data.emplace_back(v >> 8);
+				data.emplace_back(v & 0xff);
+			}
+			break;
+		default:
+			va_end(args);
+			throw std::runtime_error(std::string("bad character in format: ") + (char)ch);
+		}
+
+		mult = 0;
+	}
+
+	va_end(args);
+}
+
+/** Copy of NetPkg::read for the same formats as writef. */
+static void readf(const std::vector<uint8_t> &data, const char *fmt, netargs &dst, unsigned offset) {
+	unsigned mult = 0;
+
+	for (unsigned ch; (ch = *fmt) != '\0'; ++fmt) {
+		if (ch >= '0' && ch <= '9') {
+			mult = 10 * mult + (ch - '0');
+			continue;
+		}
+
+		if (!mult)
+			mult = 1;
+
+		switch (ch) {
+		case 'b': case 'B': // int8/uint8
+			for (unsigned i = 0; i < mult; ++i, ++offset)
+				dst.emplace_back((uint64_t)data.at(offset));
+			break;
+		case 'h': case 'H': // int16/uint16
+			for (unsigned i = 0; i < mult; ++i, offset += 2)
+				dst.emplace_back((uint64_t)((uint16_t)data.at(offset) << 8 | (uint16_t)data.at(offset + 1)));
+			break;
+		case 'i': case 'I': case 'F': // int32/uint32
+			for (unsigned i = 0; i < mult; ++i, offset += 4)
+				dst.emplace_back((uint64_t)((uint32_t)data.at(offset) << 24 | (uint32_t)data.at(offset + 1) << 16
+					| (uint32_t)data.at(offset + 2) << 8 | (uint32_t)data.at(offset + 3)));
+			break;
+		default:
+			throw std::runtime_error(std::string("bad character in format: ") + (char)ch);
+		}
+
+		mult = 0;
+	}
+}
+
+static uint64_t arg(const netargs &args, unsigned pos) {
+	return std::get<uint64_t>(args.at(pos));
+}
+
+/** Entity update as it was written before NetSchema. */
+static void writef_entity_update(NetPkg &pkg, const EntityView &e) {
+	PkgWriter out(pkg, NetPkgType::entity_mod);
+
+	pkg.data.clear();
+	writef(pkg.data, "2H2I2F", (uint16_t)NetEntityControlType::update, (uint16_t)e.type,
+		e.ref.first, e.ref.second, e.x, e.y);
+	writef(pkg.data, "HHHB", (uint16_t)(e.angle * UINT16_MAX / (2 * M_PI)),
+		e.playerid, e.subimage, (uint8_t)e.state);
+	writef(pkg.data, "bbH",
+		(int8_t)(INT8_MAX * fmodf(e.x, 1)), (int8_t)(INT8_MAX * fmodf(e.y, 1)), e.hp);
+}
+
+/** Entity update as it was read before NetSchema. */
+static EntityView read_entity_update(const NetPkg &pkg, netargs &args) {
+	EntityView ev;
+
+	args.clear();
+	readf(pkg.data, "H2I2FHHHBbbH", args, 2);
+
+	ev.type = (EntityType)arg(args, 0);
+	ev.ref.first = (uint32_t)arg(args, 1); ev.ref.second = (uint32_t)arg(args, 2);
+	ev.x = (int32_t)arg(args, 3) + (int8_t)arg(args, 9) / (float)INT8_MAX;
+	ev.y = (int32_t)arg(args, 4) + (int8_t)arg(args, 10) / (float)INT8_MAX;
+	ev.angle = (uint16_t)arg(args, 5) * (2 * M_PI) / UINT16_MAX;
+	ev.playerid = (uint16_t)arg(args, 6);
+	ev.subimage = (uint16_t)arg(args, 7);
+	ev.state = (EntityState)arg(args, 8);
+	ev.hp = (uint16_t)arg(args, 11);
+
+	return ev;
+}
+
+static Entity bench_entity() {
+	Entity e(IdPoolRef(12, 3), EntityType::villager, 1, 10.5f, 20.25f);
+	e.angle = 1.5f;
+	e.subimage = 7;
+	return e;
+}
+
+/** Make sure both implementations agree before timing them. */
+static void check_same_bytes() {
+	Entity e(bench_entity());
+	NetPkg a, b;
+
+	a.set_entity_update(e);
+	writef_entity_update(b, EntityView(e));
+
+	if (a.data != b.data)
+		throw std::runtime_error("entity update: schema and writef output differ");
+}
+
+BENCH(NetPkg_EntityUpdate_writef) {
+	EntityView ev(bench_entity());
+	NetPkg pkg;
+
+	while (state.next()) {
+		writef_entity_update(pkg, ev);
+		bench_keep(pkg);
+	}
+}
+
+BENCH(NetPkg_EntityUpdate_schema) {
+	check_same_bytes();
+	Entity e(bench_entity());
+	NetPkg pkg;
+
+	while (state.next()) {
+		pkg.set_entity_update(e);
+		bench_keep(pkg);
+	}
+}
+
+BENCH(NetPkg_EntityMod_read) {
+	NetPkg p;
+	writef_entity_update(p, EntityView(bench_entity()));
+	const NetPkg &pkg = p;
+	netargs args;
+
+	while (state.next()) {
+		EntityView ev(read_entity_update(pkg, args));
+		bench_keep(ev);
+	}
+}
+
+BENCH(NetPkg_EntityMod_schema) {
+	NetPkg p;
+	p.set_entity_update(bench_entity());
+	const NetPkg &pkg = p;
+
+	while (state.next()) {
+		NetEntityMod m(pkg.get_entity_mod());
+		bench_keep(m);
+	}
+}
+
+}
@@ -0,0 +1,105 @@
+#include "bench.hpp"
+
+#include "../src/server.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <random>
+
+namespace aoe {
+
+/**
+ * Order lots of units to move across a generated map and process the paths with the same
+ * per-tick budget as World::tick_entities.
+ */
+class PathfinderBench final {
+	Terrain t;
+	Pathfinder pf;
+	std::mt19937 rng;
+	unsigned size, units;
+	uint64_t budget;
+public:
+	PathfinderBench()
+		: t(), pf(), rng(bench_arg("seed", 1))
+		, size(bench_arg("size", 250))
+		, units(bench_arg("units", 400))
+		, budget(bench_arg("budget", World::path_budget)) {}
+
+	void setup() {
+		using namespace std::chrono;
+
+		t.resize(size, size, 1, 8, false, TerrainType::normal);
+		t.generate();
+
+		auto start = steady_clock::now();
+		pf.reset(t);
+		double ms = duration<double, std::milli>(steady_clock::now() - start).count();
+
+		// what placing a building costs
+		start = steady_clock::now();
+		pf.update(t, size / 2, size / 2, 5, 5);
+		double up = duration<double, std::milli>(steady_clock::now() - start).count();
+
+		printf("map %ux%u: %zu entrances, graph built in %.2f ms, updated in %.3f ms\n", size, size, pf.node_count(), ms, up);
+	}
+
+	std::pair<float, float> random_land() {
+		std::uniform_real_distribution<float> pos(0, (float)size);
+
+		for (;;) {
+			float x = pos(rng), y = pos(rng);
+			if (t.passable((unsigned)x, (unsigned)y))
+				return std::make_pair(x, y);
+		}
+	}
+
+	/** Split units in \a groups groups that all move from one spot to another. */
+	void order(unsigned groups) {
+		std::normal_distribution<float> spread(0, 3);
+
+		for (unsigned g = 0, i = 0; g < groups; ++g) {
+			auto [x0, y0] = random_land();
+			auto [x1, y1] = random_land();
+
+			for (unsigned end = (g + 1) * units / groups; i < end; ++i)
+				pf.request(IdPoolRef(i, 0), x0 + spread(rng), y0 + spread(rng), x1 + spread(rng), y1 + spread(rng));
+		}
+	}
+
+	void run(const char *name, unsigned groups) {
+		using namespace std::chrono;
+
+		pf.paths.clear();
+		pf.expanded = pf.cache_hits = pf.cache_misses = 0;
+
+		order(groups);
+
+		unsigned ticks = 0;
+		double total = 0, worst = 0;
+
+		for (; std::any_of(pf.paths.begin(), pf.paths.end(), [](auto &kv) { return kv.second.pending; }); ++ticks) {
+			auto start = steady_clock::now();
+			pf.process(budget);
+			double ms = duration<double, std::milli>(steady_clock::now() - start).count();
+
+			total += ms;
+			worst = std::max(worst, ms);
+		}
+
+		size_t found = std::count_if(pf.paths.begin(), pf.paths.end(), [](auto &kv) { return !kv.second.pts.empty(); });
+		uint64_t lookups = pf.cache_hits + pf.cache_misses;
+
+		printf("%-10s %5u units %4u groups: %4u ticks, %8.2f ms total, %6.2f ms worst tick, %5.1f us/path, %7.0f nodes/path, %3.0f%% cache hits, %zu reachable\n",
+			name, units, groups, ticks, total, worst, 1000 * total / units, (double)pf.expanded / units,
+			lookups ? 100.0 * pf.cache_hits / lookups : 0.0, found);
+	}
+};
+
+BENCH_RUN(Pathfinder_Move) {
+	PathfinderBench b;
+	b.setup();
+	b.run("grouped", bench_arg("groups", 8));
+	b.run("scattered", bench_arg("units", 400));
+}
+
+}
@@ -0,0 +1,82 @@
+#include "bench.hpp"
+
+#include "../src/server.hpp"
+
+#include <algorithm>
+#include <cstdio>
+
+namespace aoe {
+
+/**
+ * Headless replayer. Plays a recorded game as fast as possible, e.g. to profile a heavy
+ * late game or to check that the simulation still ends up with the same state hashes.
+ */
+class ReplayBench final {
+	NullServer srv;
+	World w;
+	Replay r;
+	std::string path;
+public:
+	ReplayBench() : srv(), w(), r(), path(bench_str("replay", "last.replay")) {}
+
+	bool setup() {
+		try {
+			r.load(path);
+		} catch (std::runtime_error &e) {
+			printf("skipped: %s\n", e.what());
+			return false;
+		}
+
+		w.tick_threads = bench_arg("threads", w.tick_threads);
+		w.start_lockstep(srv, r.scn);
+		return true;
+	}
+
+	void run() {
+		using namespace std::chrono;
+
+		std::vector<NetStateHash> hashes;
+		double worst = 0;
+		size_t frames = 0;
+
+		auto start = steady_clock::now();
+
+		for (const LockstepFrame &f : r.frames) {
+			auto t0 = steady_clock::now();
+			w.step_lockstep(f, hashes);
+			double ms = duration<double, std::milli>(steady_clock::now() - t0).count();
+
+			// frames without inputs can span many ticks
+			if (f.steps)
+				worst = std::max(worst, ms / f.steps);
+
+			++frames;
+			FrameMark;
+		}
+
+		double elapsed = duration<double>(steady_clock::now() - start).count();
+		size_t checked = std::min(hashes.size(), r.hashes.size()), bad = 0;
+
+		for (size_t i = 0; i < checked; ++i) {
+			if (hashes[i].tick != r.hashes[i].tick || hashes[i].hash != r.hashes[i].hash) {
+				if (!bad)
+					printf("diverged at tick %u\n", (unsigned)r.hashes[i].tick);
+				++bad;
+			}
+		}
+
+		uint32_t ticks = w.tick_count();
+
+		printf("%s: map %ux%u, %zu players, %zu entities, %u threads\n", path.c_str(), w.scn.width, w.scn.height, w.player_list().size(), w.entity_pool().size(), w.tick_threads);
+		printf("%zu frames, %u ticks in %.3f s: %.1f ticks/s, %.3f ms/tick in the slowest frame\n", frames, (unsigned)ticks, elapsed, ticks / elapsed, worst);
+		printf("state hashes: %zu/%zu match\n", checked - bad, r.hashes.size());
+	}
+};
+
+BENCH_RUN(Replay) {
+	ReplayBench b;
+	if (b.setup())
+		b.run();
+}
+
+}
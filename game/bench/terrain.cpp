@@ -0,0 +1,125 @@
+#include "bench.hpp"
+
+#include "../src/world/terrain.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+
+#include <ctpl_stl.hpp>
+
+namespace aoe {
+
+/**
+ * Generate maps of several sizes and report how long it takes on one and on all threads, how much
+ * memory the terrain needs and what it costs the client to copy it after a change, like
+ * GameView::try_read does.
+ */
+BENCH_RUN(Terrain_Generate) {
+	using namespace std::chrono;
+
+	unsigned runs = bench_arg("runs", 3);
+	unsigned only = bench_arg("size", 0);
+	unsigned threads = bench_arg("threads", std::max(1u, std::thread::hardware_concurrency()));
+	ctpl::thread_pool tp(threads);
+
+	printf("%u threads\n", threads);
+	printf("%-10s %12s %12s %12s %10s %14s %14s\n", "map", "generate ms", "parallel ms", "memory KB", "bytes/tile", "full copy us", "1 chunk us");
+
+	for (unsigned size : { 250u, 512u, 1024u }) {
+		if (only && size != only)
+			continue;
+
+		Terrain t;
+		double gen = 0, par = 0;
+
+		for (unsigned i = 0; i < runs; ++i) {
+			auto start = steady_clock::now();
+			t.resize(size, size, i + 1, 8, false, TerrainType::normal);
+			t.generate();
+			double ms = duration<double, std::milli>(steady_clock::now() - start).count();
+			gen = i ? std::min(gen, ms) : ms;
+
+			start = steady_clock::now();
+			t.resize(size, size, i + 1, 8, false, TerrainType::normal);
+			t.generate(&tp);
+			ms = duration<double, std::milli>(steady_clock::now() - start).count();
+			par = i ? std::min(par, ms) : ms;
+		}
+
+		Terrain copy;
+		std::vector<tile_t> tiles(1, Terrain::tile_id(TileType::water, 0));
+		std::vector<uint8_t> hmap(1, 0);
+
+		auto start = steady_clock::now();
+		copy = t;
+		double full = duration<double, std::micro>(steady_clock::now() - start).count();
+
+		t.set(tiles, hmap, size / 2, size / 2, 1, 1);
+
+		start = steady_clock::now();
+		copy.sync(t);
+		double one = duration<double, std::micro>(steady_clock::now() - start).count();
+
+		bench_keep(copy.version());
+
+		printf("%4ux%-5u %12.2f %12.2f %12zu %10.2f %14.1f %14.1f\n", size, size, gen, par, t.memory() / 1024,
+			(double)t.memory() / ((size_t)size * size), full, one);
+	}
+}
+
+
+/**
+ * Paint strokes with a 3x3 brush on generated maps, as the scenario editor does once per frame,
+ * and compare it with generating the whole map again.
+ */
+BENCH_RUN(Terrain_Paint) {
+	using namespace std::chrono;
+
+	unsigned strokes = bench_arg("strokes", 500);
+	unsigned only = bench_arg("size", 0);
+	const TileType types[] = { TileType::water, TileType::desert, TileType::grass };
+
+	printf("%-10s %12s %12s %12s\n", "map", "generate ms", "paint us", "worst us");
+
+	for (unsigned size : { 250u, 512u, 1024u }) {
+		if (only && size != only)
+			continue;
+
+		Terrain t;
+		srand(size);
+		t.resize(size, size, 1, 8, false, TerrainType::normal);
+
+		auto start = steady_clock::now();
+		t.generate();
+		double gen = duration<double, std::milli>(steady_clock::now() - start).count();
+
+		double total = 0, worst = 0;
+		std::vector<TilePaint> lst;
+
+		for (unsigned i = 0; i < strokes; ++i) {
+			// a few tiles of mouse movement per frame
+			int x = rand() % size, y = rand() % size;
+			TileType type = types[rand() % 3];
+
+			lst.clear();
+
+			for (unsigned step = 0; step < 4; ++step, ++x)
+				for (int ty = std::max(0, y - 1); ty <= std::min<int>(size - 1, y + 1); ++ty)
+					for (int tx = std::max(0, x - 1); tx <= std::min<int>(size - 1, x + 1); ++tx)
+						lst.emplace_back(tx, ty, type);
+
+			start = steady_clock::now();
+			bench_keep(t.paint(lst));
+			double us = duration<double, std::micro>(steady_clock::now() - start).count();
+
+			total += us;
+			worst = std::max(worst, us);
+		}
+
+		printf("%4ux%-5u %12.2f %12.1f %12.1f\n", size, size, gen, total / std::max(1u, strokes), worst);
+	}
+}
+
+}
@@ -0,0 +1,145 @@
+#include "bench.hpp"
+
+#include "../src/server.hpp"
+
+#include <cstdio>
+#include <random>
+
+namespace aoe {
+
+class BenchPhase final {
+public:
+	const char *name;
+	std::chrono::steady_clock::duration time;
+	uint64_t allocs;
+
+	BenchPhase(const char *name) : name(name), time(0), allocs(0) {}
+
+	template<typename F> void run(F fn) {
+		uint64_t a = bench_allocs();
+		auto start = std::chrono::steady_clock::now();
+
+		fn();
+
+		time += std::chrono::steady_clock::now() - start;
+		allocs += bench_allocs() - a;
+	}
+};
+
+/**
+ * Load generator for the server simulation. Builds a world with lots of units and
+ * runs the same steps as World::eventloop as fast as possible, with the host giving orders every tick.
+ * With lockstep=1 it is played as a lockstep game instead, which sends no snapshots.
+ */
+class WorldBench final {
+	NullServer srv; // so only the simulation itself is measured
+	World w;
+	std::mt19937 rng;
+	std::vector<IdPoolRef> units;
+	unsigned size, players, unit_count, ticks, orders;
+	bool lockstep;
+public:
+	WorldBench()
+		: srv(), w(), rng(1), units()
+		, size(bench_arg("size", 250))
+		, players(bench_arg("players", 8))
+		, unit_count(bench_arg("units", 4000))
+		, ticks(bench_arg("ticks", 1000))
+		, orders(bench_arg("orders", 50))
+		, lockstep(bench_arg("lockstep", 0) != 0) {}
+
+	void setup() {
+		ScenarioSettings scn;
+		scn.width = scn.height = size;
+
+		for (unsigned i = 1; i <= players; ++i)
+			scn.players.emplace_back("", 0, i, scn.res);
+
+		w.tick_threads = bench_arg("threads", w.tick_threads);
+
+		if (lockstep) {
+			w.start_lockstep(srv, scn);
+		} else {
+			w.scn.players = scn.players; // not copied by load_scn
+			w.load_scn(scn);
+			w.start_headless(srv);
+		}
+
+		size = w.scn.width; // may have been clamped
+
+		std::uniform_real_distribution<float> pos(1, size - 1);
+
+		for (unsigned i = 0; i < unit_count; ++i) {
+			unsigned pid = first_player_idx + i % players;
+			units.emplace_back(w.add_unit(EntityType::melee1, pid, pos(rng), pos(rng), 0));
+		}
+	}
+
+	/** Let random units move somewhere or attack someone, just like players would. */
+	template<typename F> void issue_orders(F add) {
+		std::uniform_int_distribution<size_t> pick(0, units.size() - 1);
+		std::uniform_int_distribution<uint32_t> pos(1, size - 1);
+
+		for (unsigned i = 0; i < orders; ++i) {
+			IdPoolRef ref = units[pick(rng)];
+
+			if (i % 2)
+				add(EntityTask(ref, pos(rng), pos(rng)));
+			else
+				add(EntityTask(EntityTaskType::infer, ref, units[pick(rng)]));
+		}
+	}
+
+	void run() {
+		using namespace std::chrono;
+
+		BenchPhase step("step");
+		std::vector<NetStateHash> hashes;
+		unsigned n = 0;
+
+		auto start = steady_clock::now();
+
+		for (; n < ticks; ++n) {
+			uint32_t t = w.tick_count();
+
+			if (lockstep) {
+				LockstepFrame f(t, 1);
+				issue_orders([&f](const EntityTask &task) { f.inputs.emplace_back(invalid_ref, WorldEventType::entity_task, task); });
+				step.run([&] { w.step_lockstep(f, hashes); });
+			} else {
+				issue_orders([this](const EntityTask &task) { w.add_event(invalid_ref, WorldEventType::entity_task, task); });
+				step.run([this] { w.step(1); });
+			}
+
+			// game over
+			if (w.tick_count() == t)
+				break;
+		}
+
+		double elapsed = duration<double>(steady_clock::now() - start).count();
+		const TickStats &ts = w.stats();
+
+		printf("map %ux%u, %u players, %zu entities, %u threads, %s\n", size, size, players, w.entity_pool().size(), w.tick_threads, lockstep ? "lockstep" : "snapshots");
+		printf("%u ticks in %.3f s: %.1f ticks/s, %.1f allocs/tick\n", n, elapsed, n / elapsed, n ? (double)step.allocs / n : 0);
+		printf("%-16s %12s %12s\n", "phase", "total ms", "us/tick");
+
+		std::pair<const char*, double> phases[] = {
+			{ "pump_events", ts.pump_time },
+			{ "tick_entities", ts.entities_time },
+			{ "tick_particles", ts.particles_time },
+			{ "tick_players", ts.players_time },
+			{ "push_events", ts.push_time },
+		};
+
+		for (auto [name, s] : phases)
+			printf("%-16s %12.2f %12.2f\n", name, s * 1000, n ? s * 1e6 / n : 0);
+	}
+};
+
+BENCH_RUN(World_Tick) {
+	WorldBench b;
+	b.setup();
+	b.run();
+}
+
+}
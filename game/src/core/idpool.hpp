@@ -1,7 +1,7 @@
 #pragma once
 
 #include <memory>
-#include <unordered_map>
+#include <vector>
 #include <deque>
 #include <utility>
 #include <stdexcept>
@@ -20,42 +20,73 @@ typedef std::pair<RefCounter, RefCounter> IdPoolRef;
 
 static constexpr const IdPoolRef invalid_ref{ 0, 0 };
 
+/**
+ * Generational slot map. Values are stored contiguously and are looked up by
+ * ref.first (id) in a sparse slot table, while ref.second (mod) is used to
+ * reject stale refs whose id has been recycled.
+ *
+ * NOTE refs are stable, but pointers and iterators are not: emplace may
+ * reallocate and erasing moves the last value into the erased spot.
+ */
 template<typename T> class IdPool final {
-	struct RefHash {
-		template<class T1, class T2> std::size_t operator()(const std::pair<T1, T2> &p) const {
-			size_t h = std::hash<T1>{}(p.first);
-			hash_combine(h, p.second);
-			return h;
-		}
+	struct Slot final {
+		RefCounter mod;
+		size_t pos; // index in values or npos if unused
+
+		Slot() : mod(0), pos(npos) {}
 	};
-	std::unordered_map<IdPoolRef, T, RefHash> values;
+
+	static constexpr size_t npos = (size_t)-1;
+
+	std::vector<std::pair<IdPoolRef, T>> values;
+	std::vector<Slot> slots; // slot 0 is reserved to keep invalid_ref invalid
 	std::deque<RefCounter> next;
 	RefCounter mod;
 public:
-	IdPool() : values(), next(), mod(0) {}
+	typedef typename decltype(values)::iterator iterator;
+	typedef typename decltype(values)::const_iterator const_iterator;
 
-	template<class... Args>	auto emplace(Args&&... val) {
-		RefCounter id = !next.empty() ? next.back() : mod;
-		if (!id)
-			id = 1;
+	IdPool() : values(), slots(1), next(), mod(0) {}
 
-		auto ins = values.emplace(std::piecewise_construct, std::forward_as_tuple(id, mod), std::forward_as_tuple(std::make_pair<>(id, mod), val...));
+	template<class... Args>	auto emplace(Args&&... val) {
+		RefCounter id;
 
-		++mod;
-		if (!next.empty())
+		if (!next.empty()) {
+			id = next.back();
 			next.pop_back();
+		} else {
+			id = (RefCounter)slots.size();
+			slots.emplace_back();
+		}
 
-		return ins;
+		IdPoolRef ref(id, mod++);
+		Slot &s = slots[id];
+
+		s.mod = ref.second;
+		s.pos = values.size();
+
+		values.emplace_back(std::piecewise_construct, std::forward_as_tuple(ref), std::forward_as_tuple(ref, val...));
+
+		return std::make_pair(values.begin() + s.pos, true);
 	}
 
 	// access
 	T *try_get(const IdPoolRef &r) noexcept {
-		auto it = values.find(r);
-		return it != values.end() ? &it->second : nullptr;
+		size_t pos = find(r);
+		return pos != npos ? &values[pos].second : nullptr;
+	}
+
+	const T *try_get(const IdPoolRef &r) const noexcept {
+		size_t pos = find(r);
+		return pos != npos ? &values[pos].second : nullptr;
 	}
 
 	T &at(const IdPoolRef &r) {
-		return values.at(r);
+		size_t pos = find(r);
+		if (pos == npos)
+			throw std::out_of_range("idpool: bad ref");
+
+		return values[pos].second;
 	}
 
 	bool try_invalidate(const IdPoolRef &r) noexcept {
@@ -68,39 +99,66 @@ public:
 	}
 
 	// iterators
-	auto begin() noexcept { return values.begin(); }
-	const auto begin() const noexcept { return values.begin(); }
+	iterator begin() noexcept { return values.begin(); }
+	const_iterator begin() const noexcept { return values.begin(); }
 
 	size_t erase(const IdPoolRef &r) {
-		size_t n = values.erase(r);
-		if (n)
-			next.emplace_back(r.first);
-		return n;
-	}
+		size_t pos = find(r);
+		if (pos == npos)
+			return 0;
 
-	auto erase(typename decltype(values)::iterator it) {
-		RefCounter id = it->first.first;
-		auto i = values.erase(it);
-		next.emplace_back(id);
-		return i;
+		remove(pos);
+		return 1;
 	}
 
-	auto erase(typename decltype(values)::const_iterator it) {
-		RefCounter id = it->first.first;
-		auto i = values.erase(it);
-		next.emplace_back(id);
-		return i;
+	/** Erase value at \a it. Returns iterator to the value that has taken its place. */
+	iterator erase(const_iterator it) {
+		size_t pos = it - values.cbegin();
+		remove(pos);
+		return values.begin() + pos;
 	}
 
-	auto end() noexcept { return values.end(); }
-	const auto end() const noexcept { return values.end(); }
+	iterator end() noexcept { return values.end(); }
+	const_iterator end() const noexcept { return values.end(); }
 
 	// state
-	constexpr size_t size() const noexcept { return values.size(); }
+	size_t size() const noexcept { return values.size(); }
+
+	/** Position of \a r in iteration order or size() if \a r is stale. */
+	size_t index(const IdPoolRef &r) const noexcept {
+		size_t pos = find(r);
+		return pos != npos ? pos : values.size();
+	}
 
 	void clear() {
 		values.clear();
+		slots.clear();
+		slots.emplace_back();
 		next.clear();
 		// XXX should we also set mod to zero?
 	}
+private:
+	size_t find(const IdPoolRef &r) const noexcept {
+		if (r.first >= slots.size())
+			return npos;
+
+		const Slot &s = slots[r.first];
+		return s.pos != npos && s.mod == r.second ? s.pos : npos;
+	}
+
+	void remove(size_t pos) {
+		RefCounter id = values[pos].first.first;
+		size_t last = values.size() - 1;
+
+		// move last value in the gap to keep values dense
+		if (pos != last) {
+			values[pos] = std::move(values[last]);
+			slots[values[pos].first.first].pos = pos;
+		}
+
+		values.pop_back();
+
+		slots[id].pos = npos;
+		next.emplace_back(id);
+	}
 };
@@ -0,0 +1,139 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <utility>
+#include <vector>
+
+namespace aoe {
+
+/** How often producers found the queue full and how far behind the consumer has been. */
+class MpscStats final {
+public:
+	uint64_t drained, full;
+	size_t peak; // most items taken in one drain
+
+	MpscStats() : drained(0), full(0), peak(0) {}
+};
+
+/**
+ * Bounded lock-free multi-producer single-consumer queue. Every slot has a sequence number that tells
+ * whether it is free for the producer that claims its position or ready for the consumer, so producers
+ * only contend on one compare-and-swap and never wait for each other or for the consumer.
+ * See Dmitry Vyukov's bounded MPMC queue, of which this is the single consumer half.
+ */
+template<typename T> class MpscQueue final {
+	struct Cell final {
+		std::atomic<size_t> seq;
+		alignas(T) unsigned char data[sizeof(T)];
+	};
+
+	std::unique_ptr<Cell[]> cells;
+	size_t mask;
+	// keep producer and consumer positions on separate cache lines
+	alignas(64) std::atomic<size_t> tail; // next position to claim by producers
+	alignas(64) size_t head; // next position to read, only touched by the consumer
+	std::atomic<uint64_t> full;
+	uint64_t drained;
+	size_t peak;
+public:
+	/** Room for \a capacity items, rounded up to a power of two. */
+	MpscQueue(size_t capacity) : cells(), mask(0), tail(0), head(0), full(0), drained(0), peak(0) {
+		size_t n = 1;
+		while (n < capacity)
+			n <<= 1;
+
+		cells.reset(new Cell[n]);
+		mask = n - 1;
+
+		for (size_t i = 0; i < n; ++i)
+			cells[i].seq.store(i, std::memory_order_relaxed);
+	}
+
+	MpscQueue(const MpscQueue&) = delete;
+	MpscQueue &operator=(const MpscQueue&) = delete;
+
+	~MpscQueue() {
+		for (; cells[head & mask].seq.load(std::memory_order_acquire) == head + 1; ++head)
+			item(cells[head & mask])->~T();
+	}
+
+	size_t capacity() const noexcept { return mask + 1; }
+
+	/** Construct an item in place. Returns false if the queue is full. Safe to call from any thread. */
+	template<class... Args> bool try_emplace(Args&&... args) {
+		size_t pos = tail.load(std::memory_order_relaxed);
+		Cell *c;
+
+		for (;;) {
+			c = &cells[pos & mask];
+			size_t seq = c->seq.load(std::memory_order_acquire);
+			intptr_t dif = (intptr_t)seq - (intptr_t)pos;
+
+			if (dif == 0) {
+				if (tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+					break;
+			} else if (dif < 0) {
+				// the consumer hasn't read this slot yet since the last round
+				full.fetch_add(1, std::memory_order_relaxed);
+				return false;
+			} else {
+				pos = tail.load(std::memory_order_relaxed);
+			}
+		}
+
+		new (c->data) T(std::forward<Args>(args)...);
+		c->seq.store(pos + 1, std::memory_order_release);
+		return true;
+	}
+
+	/** Whether try_emplace would find room right now. Only a promise if no other producer gets in between. */
+	bool has_room() const noexcept {
+		size_t pos = tail.load(std::memory_order_relaxed);
+		return (intptr_t)cells[pos & mask].seq.load(std::memory_order_acquire) - (intptr_t)pos >= 0;
+	}
+
+	/** Move all items that are ready to \a out. Returns the number of items moved. Only one thread may drain. */
+	size_t drain(std::vector<T> &out) {
+		size_t n = 0;
+
+		for (;; ++n, ++head) {
+			Cell &c = cells[head & mask];
+			if (c.seq.load(std::memory_order_acquire) != head + 1)
+				break;
+
+			T *v = item(c);
+			out.emplace_back(std::move(*v));
+			v->~T();
+
+			// free for the producer that claims this slot in the next round
+			c.seq.store(head + mask + 1, std::memory_order_release);
+		}
+
+		drained += n;
+		if (n > peak)
+			peak = n;
+
+		return n;
+	}
+
+	/** Only the consumer may call this. */
+	MpscStats stats() const noexcept {
+		MpscStats s;
+
+		s.drained = drained;
+		s.full = full.load(std::memory_order_relaxed);
+		s.peak = peak;
+
+		return s;
+	}
+private:
+	static T *item(Cell &c) noexcept {
+		return std::launder(reinterpret_cast<T*>(c.data));
+	}
+};
+
+}
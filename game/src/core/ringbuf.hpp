@@ -0,0 +1,125 @@
+#pragma once
+
+#include <minmax.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+namespace aoe {
+
+/**
+ * Byte FIFO backed by one contiguous power of two sized buffer.
+ * Unlike std::deque, data can be received into and sent from it directly using write_span and read_span.
+ */
+class RingBuffer final {
+	std::vector<uint8_t> buf;
+	size_t head, count; // head is the read position
+public:
+	RingBuffer(size_t capacity=0) : buf(), head(0), count(0) {
+		reserve(capacity);
+	}
+
+	size_t size() const noexcept { return count; }
+	bool empty() const noexcept { return !count; }
+	size_t capacity() const noexcept { return buf.size(); }
+
+	uint8_t operator[](size_t pos) const noexcept { return buf[(head + pos) & (buf.size() - 1)]; }
+	uint8_t front() const noexcept { return buf[head]; }
+
+	/** Make sure at least \a n more bytes fit without reallocating. */
+	void reserve(size_t n) {
+		if (count + n <= buf.size())
+			return;
+
+		size_t cap = 64;
+		while (cap < count + n)
+			cap <<= 1;
+
+		std::vector<uint8_t> nbuf(cap);
+		peek(nbuf.data(), count);
+
+		buf.swap(nbuf);
+		head = 0;
+	}
+
+	/** Contiguous readable data at the front. This is less than size() if the data wraps around. */
+	std::pair<const uint8_t*, size_t> read_span() const noexcept {
+		if (!count)
+			return std::make_pair(nullptr, (size_t)0);
+
+		return std::make_pair(buf.data() + head, std::min(count, buf.size() - head));
+	}
+
+	/** Contiguous free space after the back. Grows the buffer if less than \a min bytes are free. Call commit after writing. */
+	std::pair<uint8_t*, size_t> write_span(size_t min=1) {
+		reserve(min);
+
+		size_t tail = (head + count) & (buf.size() - 1);
+		size_t n = tail >= head && count != buf.size() ? buf.size() - tail : head - tail;
+
+		// the free space may be split in two. make sure we can fit min bytes in one piece
+		if (n < min) {
+			reserve(buf.size() - count + 1);
+			tail = head + count;
+			n = buf.size() - tail;
+		}
+
+		return std::make_pair(buf.data() + tail, n);
+	}
+
+	/** Append \a n bytes that have been written to the span returned by write_span. */
+	void commit(size_t n) noexcept {
+		count += n;
+	}
+
+	/** Remove \a n bytes from the front. */
+	void consume(size_t n) noexcept {
+		if (n >= count) {
+			head = count = 0;
+			return;
+		}
+
+		head = (head + n) & (buf.size() - 1);
+		count -= n;
+	}
+
+	/** Copy \a n bytes starting at \a offset to \a dst without removing them. */
+	void peek(void *dst, size_t n, size_t offset=0) const noexcept {
+		if (!n)
+			return;
+
+		size_t start = (head + offset) & (buf.size() - 1);
+		size_t first = std::min(n, buf.size() - start);
+
+		memcpy(dst, buf.data() + start, first);
+		memcpy((uint8_t*)dst + first, buf.data(), n - first);
+	}
+
+	void push_back(const void *ptr, size_t n) {
+		reserve(n);
+
+		size_t tail = (head + count) & (buf.size() - 1);
+		size_t first = std::min(n, buf.size() - tail);
+
+		memcpy(buf.data() + tail, ptr, first);
+		memcpy(buf.data(), (const uint8_t*)ptr + first, n - first);
+
+		count += n;
+	}
+
+	void emplace_back(uint8_t v) { push_back(&v, 1); }
+	void pop_front() noexcept { consume(1); }
+
+	void clear() noexcept { head = count = 0; }
+
+	void swap(RingBuffer &other) noexcept {
+		buf.swap(other.buf);
+		std::swap(head, other.head);
+		std::swap(count, other.count);
+	}
+};
+
+}
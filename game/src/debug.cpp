@@ -10,8 +10,8 @@ namespace aoe {
 using namespace ui;
 
 static ImU8 read_incoming(const ImU8 *ptr, size_t off) {
-	std::deque<uint8_t> &data = *((std::deque<uint8_t>*)(void*)ptr);
-	return data.at(off);
+	const RingBuffer &data = *((const RingBuffer*)(const void*)ptr);
+	return data[off];
 }
 
 void Debug::show_texture_map() {
@@ -57,6 +57,8 @@ ScenarioSettings sp_scn;
 
 MenuState next_menu_state = MenuState::init;
 
+static const char *replay_path = "last.replay"; // overwritten by every hosted game
+
 Engine::Engine()
 	: net(), show_demo(false), show_debug(false), font_scaling(true)
 	, connection_mode(0), connection_port(32768), connection_host("")
@@ -75,7 +77,7 @@ Engine::Engine()
 	, m_gl(nullptr), assets(), assets_good(false)
 	, show_chat(false), m_show_achievements(false), show_timeline(false), show_diplomacy(false)
 	, vbo(0), vsync_mode(0), vsync_idx(0)
-	, cam_x(0), cam_y(0), gv(), tw(0), th(0), cv()
+	, cam_x(0), cam_y(0), cam_dirty(true), gv(), tw(0), th(0), cv()
 	, player_tbl_y(0), ui()
 	, texture1(0), tex1(nullptr)
 {
@@ -151,6 +153,7 @@ void Engine::show_general_settings() {
 
 	chkbox("Play chat taunts", sfx.play_taunts);
 	chkbox("Autostart", cfg.autostart);
+	chkbox("Record hosted games", cfg.record_replay);
 	chkbox("UI scaling", font_scaling);
 }
 
@@ -515,11 +518,17 @@ void Engine::start_server(uint16_t port) {
 				lock lk(m);
 				// there should be either no server or an inactive one
 				assert(!server || !server->active());
-				server.reset(new Server);
+				Server *srv = new Server;
+				if (cfg.record_replay)
+					srv->record(replay_path);
+
+				srv->timing(cfg.tick_rate, cfg.snapshot_rate, cfg.max_catchup);
+
+				server.reset(srv);
 			}
 
 			std::thread t2([this](uint16_t port) {
-				((Server*)server.get())->mainloop(port, 1);
+				((Server*)server.get())->mainloop(port, net_protocol);
 			}, port);
 			t2.detach();
 
@@ -623,6 +632,7 @@ void Engine::set_game_data() {
 
 void Engine::cam_reset() {
 	cam_x = cam_y = 0.0f;
+	cam_dirty = true;
 }
 
 void Engine::goto_menu(MenuState state) {
@@ -719,8 +729,17 @@ void Engine::idle_game() {
 		if (client) {
 			IClient *ic = client.get();
 
-			if (cam_move)
-				ic->cam_move(cam_x - io.DisplaySize.x / 2, cam_y - io.DisplaySize.y / 2, io.DisplaySize.x, io.DisplaySize.y);
+			if ((cam_move || cam_dirty) && tw && th) {
+				// convert screen to tile bounds, so the server knows which entities we can see
+				float left = cam_x - io.DisplaySize.x / 2, right = cam_x + io.DisplaySize.x / 2;
+				float top = cam_y - io.DisplaySize.y / 2, bottom = cam_y + io.DisplaySize.y / 2;
+
+				float x0 = std::max(0.0f, left / tw + top / th), x1 = std::max(0.0f, right / tw + bottom / th);
+				float y0 = std::max(0.0f, left / tw - bottom / th), y1 = std::max(0.0f, right / tw - top / th);
+
+				ic->cam_move(x0, y0, x1 - x0 + 1, y1 - y0 + 1);
+				cam_dirty = false;
+			}
 
 			gv.try_read(ic->g);
 		}
@@ -33,8 +33,11 @@ class Config final {
 	Engine &e;
 public:
 	std::string path, game_dir, username;
-	bool autostart;
+	bool autostart, record_replay;
 	double music_volume, sfx_volume;
+	// timing of the games we host, see World::tick_rate
+	double tick_rate, snapshot_rate;
+	unsigned max_catchup;
 
 	static constexpr uint32_t magic = 0x06ce09f6;
 
@@ -136,6 +139,7 @@ private:
 	int vsync_mode, vsync_idx;
 
 	float cam_x, cam_y;
+	bool cam_dirty; // camera has to be sent to server
 	static constexpr float cam_speed = 400.0f;
 
 	GameView gv;
@@ -0,0 +1,281 @@
+#include "assets.hpp"
+
+#include "file_io.hpp"
+
+#include <cstdio>
+#include <fstream>
+
+#include <tracy/Tracy.hpp>
+
+namespace aoe {
+
+using namespace gfx;
+using namespace io;
+
+/*
+ * The cache is only ever read back on the machine that wrote it,
+ * so everything is stored in native byte order. The magic doubles as endianness check.
+ */
+static constexpr uint32_t cache_magic = 0x43454f41; // "AOEC"
+/*
+ * Part of the key, so bump it whenever load_gfx packs anything different: which sprites are loaded,
+ * how they are decoded or recoloured, or how they are laid out. The DRS hashes can't tell.
+ * 2: player colours derived by remapping, atlas converted with a lookup table
+ */
+static constexpr uint32_t cache_version = 2;
+
+class CacheWriter final {
+	std::ofstream out;
+public:
+	CacheWriter(const std::string &path) : out(path, std::ios::binary | std::ios::trunc) {
+		if (!out)
+			throw std::runtime_error(std::string("cannot create asset cache: ") + path);
+	}
+
+	void write(const void *ptr, size_t size) {
+		if (!out.write((const char*)ptr, size))
+			throw std::runtime_error("cannot write asset cache");
+	}
+
+	template<typename T> void put(const T &v) {
+		static_assert(std::is_trivially_copyable_v<T>);
+		write(&v, sizeof v);
+	}
+
+	void put(IdPoolRef ref) {
+		put<uint32_t>(ref.first);
+		put<uint32_t>(ref.second);
+	}
+
+	void close() {
+		out.close();
+		if (!out)
+			throw std::runtime_error("cannot write asset cache");
+	}
+};
+
+class CacheReader final {
+	std::ifstream in;
+	uint64_t left; // bytes that have not been read yet
+public:
+	CacheReader(const std::string &path) : in(path, std::ios::binary | std::ios::ate), left(0) {
+		if (in.is_open()) {
+			left = (uint64_t)in.tellg();
+			in.seekg(0);
+		}
+	}
+
+	bool is_open() const { return in.is_open(); }
+	uint64_t remaining() const noexcept { return left; }
+
+	void read(void *ptr, size_t size) {
+		if (size > left || !in.read((char*)ptr, size))
+			throw std::runtime_error("asset cache truncated");
+
+		left -= size;
+	}
+
+	template<typename T> T get() {
+		static_assert(std::is_trivially_copyable_v<T>);
+		T v;
+		read(&v, sizeof v);
+		return v;
+	}
+
+	IdPoolRef get_ref() {
+		uint32_t first = get<uint32_t>(), second = get<uint32_t>();
+		return IdPoolRef(first, second);
+	}
+
+	/** Read an element count and make sure that many elements of at least \a size bytes can follow, so a corrupt count cannot make us allocate too much. */
+	uint32_t get_count(size_t size) {
+		uint32_t n = get<uint32_t>();
+
+		if (n > left / size)
+			throw std::runtime_error("asset cache corrupt");
+
+		return n;
+	}
+};
+
+/** Hash contents of \a path using 64-bit FNV-1a. */
+static uint64_t file_hash(const std::string &path, uint64_t h) {
+	ZoneScoped;
+	CI_fstream cf(path.c_str());
+
+	off_t end = 0;
+	cf.seek(end, SEEK_END);
+	off_t beg = 0;
+	cf.seek(beg, SEEK_SET);
+
+	std::vector<uint8_t> buf(1 << 16);
+
+	for (off_t left = end - beg; left > 0;) {
+		int n = (int)std::min<off_t>(left, buf.size());
+		cf.read(buf.data(), n);
+
+		for (int i = 0; i < n; ++i) {
+			h ^= buf[i];
+			h *= UINT64_C(0x100000001b3);
+		}
+
+		left -= n;
+	}
+
+	return h;
+}
+
+uint64_t Assets::gfx_hash(int size) {
+	ZoneScoped;
+	uint64_t h = UINT64_C(0xcbf29ce484222325);
+
+	h = file_hash(path + "/data/Interfac.drs", h);
+	h = file_hash(path + "/data/Border.drs", h);
+	h = file_hash(path + "/data/Terrain.drs", h);
+	h = file_hash(path + "/data/graphics.drs", h);
+
+	// the packed layout depends on the maximum texture size
+	return h ^ (uint64_t)size << 32 ^ cache_version;
+}
+
+bool Assets::load_cache(const std::string &fname, uint64_t key) {
+	ZoneScoped;
+	CacheReader in(fname);
+
+	if (!in.is_open())
+		return false;
+
+	try {
+		if (in.get<uint32_t>() != cache_magic || in.get<uint32_t>() != cache_version || in.get<uint64_t>() != key)
+			return false;
+
+		for (uint32_t n = in.get_count(4 + sizeof(BackgroundColors)); n; --n) {
+			DrsId id = (DrsId)in.get<uint32_t>();
+			bkg_cols[id] = in.get<BackgroundColors>();
+		}
+
+		for (uint32_t n = in.get_count(4 + 8); n; --n) {
+			DrsId id = (DrsId)in.get<uint32_t>();
+			drs_ids[id] = in.get_ref();
+		}
+
+		for (uint32_t n = in.get_count(4 + 1 + 4); n; --n) {
+			DrsId id = (DrsId)in.get<uint32_t>();
+			ImageSet &s = drs_gifs[id];
+
+			s.dynamic = in.get<uint8_t>() != 0;
+			s.imgs.resize(in.get_count(8));
+
+			for (IdPoolRef &ref : s.imgs)
+				ref = in.get_ref();
+		}
+
+		for (uint32_t n = in.get_count(8 + sizeof(SDL_Rect) + 2 * 4 + 4 * sizeof(GLfloat) + 4); n; --n) {
+			IdPoolRef ref = in.get_ref();
+			SDL_Rect bnds = in.get<SDL_Rect>();
+			int hotspot_x = in.get<int32_t>(), hotspot_y = in.get<int32_t>();
+			GLfloat s0 = in.get<GLfloat>(), t0 = in.get<GLfloat>(), s1 = in.get<GLfloat>(), t1 = in.get<GLfloat>();
+
+			std::vector<std::pair<int, int>> mask(in.get_count(2 * 4));
+			for (auto &m : mask) {
+				m.first = in.get<int32_t>();
+				m.second = in.get<int32_t>();
+			}
+
+			ts_ui.imgs.emplace(ref, bnds, nullptr, mask, hotspot_x, hotspot_y, s0, t0, s1, t1);
+		}
+
+		int w = in.get<int32_t>(), h = in.get<int32_t>();
+		if (w < 0 || h < 0 || (uint64_t)w * h > in.remaining() / 4)
+			throw std::runtime_error("asset cache corrupt");
+
+		ts_ui.surf.reset(SDL_CreateRGBSurfaceWithFormat(0, w, h, 32, SDL_PIXELFORMAT_RGBA32));
+		if (!ts_ui.surf)
+			throw std::runtime_error("cannot create tileset surface");
+
+		// read straight into the surface: this is the only copy before it gets uploaded
+		for (int y = 0; y < h; ++y)
+			in.read((uint8_t*)ts_ui.surf->pixels + y * ts_ui.surf->pitch, 4 * w);
+
+		return true;
+	} catch (std::exception &e) {
+		fprintf(stderr, "%s: ignoring %s: %s\n", __func__, fname.c_str(), e.what());
+
+		bkg_cols.clear();
+		drs_ids.clear();
+		drs_gifs.clear();
+		ts_ui = Tileset();
+
+		return false;
+	}
+}
+
+void Assets::save_cache(const std::string &fname, uint64_t key) {
+	ZoneScoped;
+	std::string tmp(fname + ".tmp");
+
+	try {
+		CacheWriter out(tmp);
+
+		out.put(cache_magic);
+		out.put(cache_version);
+		out.put(key);
+
+		out.put<uint32_t>(bkg_cols.size());
+		for (auto &kv : bkg_cols) {
+			out.put<uint32_t>((uint32_t)kv.first);
+			out.put(kv.second);
+		}
+
+		out.put<uint32_t>(drs_ids.size());
+		for (auto &kv : drs_ids) {
+			out.put<uint32_t>((uint32_t)kv.first);
+			out.put(kv.second);
+		}
+
+		out.put<uint32_t>(drs_gifs.size());
+		for (auto &kv : drs_gifs) {
+			out.put<uint32_t>((uint32_t)kv.first);
+			out.put<uint8_t>(kv.second.dynamic);
+			out.put<uint32_t>(kv.second.imgs.size());
+
+			for (IdPoolRef ref : kv.second.imgs)
+				out.put(ref);
+		}
+
+		out.put<uint32_t>(ts_ui.imgs.size());
+		for (const ImageRef &r : ts_ui.imgs) {
+			out.put(r.ref);
+			out.put(r.bnds);
+			out.put<int32_t>(r.hotspot_x);
+			out.put<int32_t>(r.hotspot_y);
+			out.put(r.s0); out.put(r.t0); out.put(r.s1); out.put(r.t1);
+
+			out.put<uint32_t>(r.mask.size());
+			for (auto &m : r.mask) {
+				out.put<int32_t>(m.first);
+				out.put<int32_t>(m.second);
+			}
+		}
+
+		SDL_Surface *surf = ts_ui.surf.get();
+		out.put<int32_t>(surf->w);
+		out.put<int32_t>(surf->h);
+
+		for (int y = 0; y < surf->h; ++y)
+			out.write((const uint8_t*)surf->pixels + y * surf->pitch, 4 * surf->w);
+
+		out.close();
+	} catch (std::runtime_error &e) {
+		// not fatal: we just have to do all the work again next time
+		fprintf(stderr, "%s: %s\n", __func__, e.what());
+		std::remove(tmp.c_str());
+		return;
+	}
+
+	std::remove(fname.c_str());
+	if (std::rename(tmp.c_str(), fname.c_str()))
+		perror(fname.c_str());
+}
+
+}
@@ -6,6 +6,7 @@
 #include "../legacy/strings.hpp"
 
 #include <algorithm>
+#include <thread>
 
 #pragma clang diagnostic ignored "-Wmacro-redefined"
 
@@ -62,28 +63,41 @@ IdPoolRef ImageSet::try_at(unsigned color, unsigned index) const {
 	return imgs[((color % MAX_PLAYERS) * image_count + index % image_count) % imgs.size()];
 }
 
-void Animation::load(io::DRS &drs, const SDL_Palette *pal, io::DrsId id) {
+void Animation::load(io::DRS &drs, const SDL_Palette *pal, io::DrsId id, ctpl::thread_pool &tp) {
+	ZoneScoped;
 	Slp slp(drs.open_slp((DrsId)id));
 
-	images.reset(new Image[all_count = image_count = slp.frames.size()]);
-	dynamic = false;
+	image_count = slp.frames.size();
 
-	for (unsigned i = 0; i < image_count; ++i) {
-		if (images[i].load(pal, slp, i, 0, id)) {
-			dynamic = true;
-			break;
-		}
-	}
+	// decode every frame once and remember where the player colours are
+	std::unique_ptr<Image[]> frames(new Image[image_count]);
+	std::vector<std::vector<uint32_t>> player_px(image_count);
+	std::unique_ptr<bool[]> frame_dynamic(new bool[image_count]());
 
-	if (!dynamic)
+	parallel_for(tp, image_count, [&](size_t i) {
+		frame_dynamic[i] = frames[i].load(pal, slp, i, 0, id, &player_px[i]);
+	});
+
+	dynamic = std::any_of(frame_dynamic.get(), frame_dynamic.get() + image_count, [](bool b) { return b; });
+
+	if (!dynamic) {
+		images = std::move(frames);
+		all_count = image_count;
 		return;
+	}
 
-	// restart parsing as we need one for every player
+	// derive the other players by remapping the player colours instead of decoding everything again
 	images.reset(new Image[all_count = image_count * MAX_PLAYERS]);
 
-	for (unsigned p = 0; p < MAX_PLAYERS; ++p)
-		for (unsigned i = 0; i < image_count; ++i)
-			images[p * image_count + i].load(pal, slp, i, p, id);
+	for (unsigned i = 0; i < image_count; ++i)
+		images[i] = std::move(frames[i]);
+
+	parallel_for(tp, all_count - image_count, [&](size_t j) {
+		size_t i = j % image_count;
+		unsigned p = 1 + j / image_count;
+
+		images[p * image_count + i].recolor(pal, images[i], player_px[i], 0, p);
+	});
 }
 
 Image &Animation::subimage(unsigned index, unsigned player) {
@@ -104,10 +118,30 @@ Assets::Assets(Engine &eng, const std::string &path)
 	load_audio(eng, info);
 }
 
+Assets::Assets(const std::string &path)
+	: drs_gifs(), path(path), drs_ids(), bkg_cols(), ts_ui(), gif_cursors() {}
+
+static const char *gfx_cache_path = "assets.cache";
+
 void Assets::load_gfx(Engine &eng, UI_TaskInfo &info) {
 	ZoneScoped;
 
 	DRS drs_ui(path + "/data/Interfac.drs");
+	ctpl::thread_pool tp(std::max(1u, std::thread::hardware_concurrency()));
+
+	GLint size = std::min(5120, eng.gl().max_texture_size);
+	uint64_t key = gfx_hash(size);
+
+	if (load_cache(gfx_cache_path, key)) {
+		info.next("Loading cached graphics");
+
+		// cursors are also needed as separate surfaces
+		auto pal = drs_ui.open_pal(DrsId::pal_default);
+		gif_cursors.load(drs_ui, pal.get(), DrsId::gif_cursors, tp);
+
+		load_ui_sfx(eng, drs_ui);
+		return;
+	}
 
 	Background bkg_main, bkg_singleplayer, bkg_multiplayer, bkg_editor_menu, bkg_victory, bkg_defeat, bkg_mission, bkg_achievements;
 	gfx::ImagePacker p;
@@ -141,16 +175,16 @@ void Assets::load_gfx(Engine &eng, UI_TaskInfo &info) {
 	{
 		ZoneScopedN("Loading user interface");
 
-		gif_menu_btn_small0.load(drs_ui, pal.get(), DrsId::gif_menu_btn_small0);
-		gif_menu_btn_medium0.load(drs_ui, pal.get(), DrsId::gif_menu_btn_medium0);
-		gif_menubar0.load(drs_ui, pal.get(), DrsId::gif_menubar0);
+		gif_menu_btn_small0.load(drs_ui, pal.get(), DrsId::gif_menu_btn_small0, tp);
+		gif_menu_btn_medium0.load(drs_ui, pal.get(), DrsId::gif_menu_btn_medium0, tp);
+		gif_menubar0.load(drs_ui, pal.get(), DrsId::gif_menubar0, tp);
 		auto slp = drs_ui.open_slp(DrsId::img_dialog0);
 		img_dialog0.load(pal.get(), slp, 0, 0, DrsId::img_dialog0);
-		gif_cursors.load(drs_ui, pal.get(), DrsId::gif_cursors);
+		gif_cursors.load(drs_ui, pal.get(), DrsId::gif_cursors, tp);
 		slp = drs_ui.open_slp(DrsId::img_editor);
 		img_dialog_editor.load(pal.get(), slp, 0, 0, DrsId::img_editor);
 
-#define load_gif(id) id.load(drs_ui, pal.get(), DrsId::id)
+#define load_gif(id) id.load(drs_ui, pal.get(), DrsId::id, tp)
 		load_gif(gif_building_icons);
 		load_gif(gif_task_icons);
 		load_gif(gif_unit_icons);
@@ -167,16 +201,16 @@ void Assets::load_gfx(Engine &eng, UI_TaskInfo &info) {
 
 		DRS drs_border(path + "/data/Border.drs");
 
-		trn_water_desert.load(drs_border, pal.get(), DrsId::trn_water_desert);
-		trn_desert_overlay.load(drs_border, pal.get(), DrsId::trn_desert_overlay);
-		trn_water_overlay.load(drs_border, pal.get(), DrsId::trn_water_overlay);
+		trn_water_desert.load(drs_border, pal.get(), DrsId::trn_water_desert, tp);
+		trn_desert_overlay.load(drs_border, pal.get(), DrsId::trn_desert_overlay, tp);
+		trn_water_overlay.load(drs_border, pal.get(), DrsId::trn_water_overlay, tp);
 
 		DRS drs_terrain(path + "/data/Terrain.drs");
 
-		trn_desert.load(drs_terrain, pal.get(), DrsId::trn_desert);
-		trn_grass.load(drs_terrain, pal.get(), DrsId::trn_grass);
-		trn_water.load(drs_terrain, pal.get(), DrsId::trn_water);
-		trn_deepwater.load(drs_terrain, pal.get(), DrsId::trn_deepwater);
+		trn_desert.load(drs_terrain, pal.get(), DrsId::trn_desert, tp);
+		trn_grass.load(drs_terrain, pal.get(), DrsId::trn_grass, tp);
+		trn_water.load(drs_terrain, pal.get(), DrsId::trn_water, tp);
+		trn_deepwater.load(drs_terrain, pal.get(), DrsId::trn_deepwater, tp);
 	}
 
 	Animation bld_town_center, bld_town_center_player, bld_barracks, bld_barracks_player;
@@ -200,12 +234,12 @@ void Assets::load_gfx(Engine &eng, UI_TaskInfo &info) {
 
 		DRS drs_graphics(path + "/data/graphics.drs"); // NOTE official installer uses lowercase g in graphics
 
-		bld_town_center.load(drs_graphics, pal.get(), DrsId::bld_town_center);
-		bld_town_center_player.load(drs_graphics, pal.get(), DrsId::bld_town_center_player);
+		bld_town_center.load(drs_graphics, pal.get(), DrsId::bld_town_center, tp);
+		bld_town_center_player.load(drs_graphics, pal.get(), DrsId::bld_town_center_player, tp);
 
-		bld_barracks.load(drs_graphics, pal.get(), DrsId::bld_barracks);
+		bld_barracks.load(drs_graphics, pal.get(), DrsId::bld_barracks, tp);
 
-#define load_gif(id) id.load(drs_graphics, pal.get(), DrsId::id)
+#define load_gif(id) id.load(drs_graphics, pal.get(), DrsId::id, tp)
 		load_gif(gif_bld_fire1);
 		load_gif(gif_bld_fire2);
 		load_gif(gif_bld_fire3);
@@ -387,10 +421,14 @@ void Assets::load_gfx(Engine &eng, UI_TaskInfo &info) {
 #undef gif
 
 		// pack images
-		GLint size = std::min(5120, eng.gl().max_texture_size);
-		ts_ui = p.collect(size, size);
+		ts_ui = p.collect(size, size, tp);
 	}
 
+	save_cache(gfx_cache_path, key);
+	load_ui_sfx(eng, drs_ui);
+}
+
+void Assets::load_ui_sfx(Engine &eng, DRS &drs_ui) {
 #define sfx(id) eng.sfx.load_sfx(SfxId:: id, drs_ui.open_wav(DrsId:: sfx_ ## id))
 	sfx(ui_click);
 	sfx(hud_click);
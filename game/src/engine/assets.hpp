@@ -38,7 +38,8 @@ public:
 
 	Animation() : images(), image_count(0), all_count(0), dynamic(false) {}
 
-	void load(io::DRS&, const SDL_Palette*, io::DrsId);
+	/** Load all frames of \a id. Frames are decoded on \a tp and player coloured variants are derived from the first one. */
+	void load(io::DRS&, const SDL_Palette*, io::DrsId, ctpl::thread_pool &tp);
 
 	gfx::Image &subimage(unsigned index, unsigned player);
 };
@@ -55,16 +56,26 @@ public:
 	Animation gif_cursors;
 
 	Assets(Engine &e, const std::string &path);
+	/** Empty set of assets for \a path. Nothing is loaded until load_cache is called. */
+	explicit Assets(const std::string &path);
 
 	const gfx::ImageRef &at(io::DrsId) const;
 	const gfx::ImageRef &at(IdPoolRef) const;
 	const ImageSet &anim_at(io::DrsId) const;
+
+	// on-disk cache of everything load_gfx packs into ts_ui. see asset_cache.cpp
+	/** Load graphics from \a fname if it was written for \a key. Returns false and leaves everything empty if it is missing, stale or damaged. */
+	bool load_cache(const std::string &fname, uint64_t key);
+	void save_cache(const std::string &fname, uint64_t key);
 private:
 	void load_gfx(Engine&, UI_TaskInfo&);
+	void load_ui_sfx(Engine&, io::DRS&);
 	void load_audio(Engine&, UI_TaskInfo&);
 	void load_str(Engine&, UI_TaskInfo&);
 
 	void add_gifs(gfx::ImagePacker &p, Animation&, io::DrsId);
+
+	uint64_t gfx_hash(int size);
 };
 
 }
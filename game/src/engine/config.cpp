@@ -24,7 +24,8 @@ Config::Config(Engine &e, const std::string &s)
 	game_dir(),
 #endif
 	username()
-	, autostart(false), music_volume(0.3), sfx_volume(0.7)
+	, autostart(false), record_replay(false), music_volume(0.3), sfx_volume(0.7)
+	, tick_rate(DEFAULT_TICKS_PER_SECOND), snapshot_rate(DEFAULT_TICKS_PER_SECOND), max_catchup(World::max_catchup_default)
 {
 }
 
@@ -37,7 +38,10 @@ void Config::reset() {
 	path.clear();
 	game_dir.clear();
 	autostart = false;
+	record_replay = false;
 	music_volume = sfx_volume = SDL_MIX_MAXVOLUME;
+	tick_rate = snapshot_rate = DEFAULT_TICKS_PER_SECOND;
+	max_catchup = World::max_catchup_default;
 }
 
 ipStatus Config::load(const std::string &path) {
@@ -57,6 +61,7 @@ ipStatus Config::load(const std::string &path) {
 #endif
 
 	autostart = ini.get_or_default("", "autostart", false);
+	record_replay = ini.get_or_default("", "record_replay", false);
 	ini.try_get("", "username", username);
 
 
@@ -81,6 +86,14 @@ ipStatus Config::load(const std::string &path) {
 	fnt_load("title_pt", copper2);
 	fnt_load("heading_pt", copper);
 
+	section = "server";
+
+	ini.try_clamp(section, "tick_rate", tick_rate, 1, 240);
+	ini.try_clamp(section, "snapshot_rate", snapshot_rate, 1, 240);
+
+	if (ini.try_clamp(section, "max_catchup", v, 1, 60) == ipStatus::ok)
+		max_catchup = (unsigned)v;
+
 	return ipStatus::ok;
 }
 
@@ -90,6 +103,7 @@ void Config::save(const std::string &path) {
 
 	ini.add_cache("legacy", "game_directory", game_dir);
 	ini.add_cache("", "autostart", autostart);
+	ini.add_cache("", "record_replay", record_replay);
 	ini.add_cache("", "username", username);
 
 	const char *section = "audio";
@@ -115,6 +129,12 @@ void Config::save(const std::string &path) {
 	ini.add_cache(section, "heading_pt", fnt.copper.pt, 1);
 	ini.add_cache(section, "heading_path", fnt.copper.path);
 
+	section = "server";
+
+	ini.add_cache(section, "tick_rate", tick_rate, 1);
+	ini.add_cache(section, "snapshot_rate", snapshot_rate, 1);
+	ini.add_cache(section, "max_catchup", (double)max_catchup);
+
 	ini.write_file(path.c_str());
 }
 
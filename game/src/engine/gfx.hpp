@@ -4,8 +4,10 @@
 #include <vector>
 
 #include <map>
+#include <future>
 
 #include <idpool.hpp>
+#include <ctpl_stl.hpp>
 
 #include "../legacy/legacy.hpp"
 
@@ -30,6 +32,27 @@ typedef std::unique_ptr<SDL_Surface, decltype(&SDL_FreeSurface)> Surface;
 
 void glchk(const char *file, const char *func, int lno);
 
+/** Run \a fn(i) for all i in [0, n) on \a tp and wait until all of them are done. Rethrows the first exception. */
+template<typename F> void parallel_for(ctpl::thread_pool &tp, size_t n, F fn) {
+	size_t chunks = std::min<size_t>(n, 4 * std::max(1, tp.size()));
+	std::vector<std::future<void>> jobs;
+
+	for (size_t i = 0; i < chunks; ++i) {
+		size_t from = i * n / chunks, to = (i + 1) * n / chunks;
+		jobs.emplace_back(tp.push([&fn, from, to](int) {
+			for (size_t j = from; j < to; ++j)
+				fn(j);
+		}));
+	}
+
+	// jobs refer to fn, so all of them must be finished before we can bail out
+	for (std::future<void> &f : jobs)
+		f.wait();
+
+	for (std::future<void> &f : jobs)
+		f.get();
+}
+
 class Image final {
 public:
 	Surface surface;
@@ -40,7 +63,15 @@ public:
 	Image(const Image&) = delete;
 	Image(Image&&) = default;
 
-	bool load(const SDL_Palette *pal, const io::Slp &slp, unsigned index, unsigned player, io::DrsId id);
+	Image &operator=(Image&&) = default;
+
+	/**
+	 * Decode frame \a index from \a slp. If \a player_px is provided, the offsets of all player coloured pixels are stored in it.
+	 * Returns whether the image contains any player coloured pixels.
+	 */
+	bool load(const SDL_Palette *pal, const io::Slp &slp, unsigned index, unsigned player, io::DrsId id, std::vector<uint32_t> *player_px=nullptr);
+	/** Copy \a src, which has been loaded for \a src_player, and remap all \a player_px to the colours of \a player. */
+	void recolor(const SDL_Palette *pal, const Image &src, const std::vector<uint32_t> &player_px, unsigned src_player, unsigned player);
 };
 
 class ImageRef final {
@@ -86,7 +117,7 @@ public:
 	IdPoolRef add_img(int hotspot_x, int hotspot_y, SDL_Surface *surf);
 	IdPoolRef add_img(int hotspot_x, int hotspot_y, SDL_Surface *surf, const std::vector<std::pair<int,int>> &mask);
 
-	Tileset collect(int w, int h);
+	Tileset collect(int w, int h, ctpl::thread_pool &tp);
 };
 
 /** Helper for safer, more convenient and more consistent OpenGL api. */
@@ -1,6 +1,7 @@
 #include "gfx.hpp"
 
 #include <climits>
+#include <cstring>
 
 #define STB_RECT_PACK_IMPLEMENTATION
 #include "stb_rect_pack.h"
@@ -24,6 +25,48 @@ ImageRef::ImageRef(IdPoolRef ref, const SDL_Rect &bnds, SDL_Surface *surf, const
 
 ImagePacker::ImagePacker() : images() {}
 
+/** Convert \a src to RGBA32 and copy it to \a dst at \a bnds. */
+static void copy_image(SDL_Surface *dst, const SDL_Rect &bnds, SDL_Surface *src) {
+	uint32_t *pixels1 = (uint32_t*)dst->pixels;
+	int p1 = dst->pitch >> 2;
+
+	Uint32 key;
+
+	// NOTE SDL_ConvertSurfaceFormat may temporarily modify the palette, which all our paletted images share,
+	// so do it ourselves for those. this is also a lot faster.
+	if (src->format->format == SDL_PIXELFORMAT_INDEX8) {
+		const SDL_Color *cols = src->format->palette->colors;
+		bool has_key = SDL_GetColorKey(src, &key) == 0;
+		uint32_t lut[256];
+
+		for (unsigned i = 0; i < 256; ++i) {
+			SDL_Color c = cols[i];
+			if (has_key && i == key)
+				c.a = SDL_ALPHA_TRANSPARENT;
+
+			memcpy(&lut[i], &c, sizeof c); // RGBA32 is r, g, b, a in memory
+		}
+
+		const uint8_t *pixels0 = (const uint8_t*)src->pixels;
+
+		for (int y0 = 0, y1 = bnds.y; y0 < src->h; ++y0, ++y1)
+			for (int x = 0; x < src->w; ++x)
+				pixels1[y1 * p1 + bnds.x + x] = lut[pixels0[y0 * src->pitch + x]];
+
+		return;
+	}
+
+	std::unique_ptr<SDL_Surface, decltype(&SDL_FreeSurface)> tmp(SDL_ConvertSurfaceFormat(src, SDL_PIXELFORMAT_RGBA32, 0), SDL_FreeSurface);
+	if (!tmp)
+		throw std::runtime_error("cannot convert image");
+
+	const uint32_t *pixels0 = (const uint32_t*)tmp->pixels;
+	int p0 = tmp->pitch >> 2;
+
+	for (int y0 = 0, y1 = bnds.y, h = tmp->h; y0 < h; ++y0, ++y1)
+		memcpy(&pixels1[y1 * p1 + bnds.x], &pixels0[y0 * p0], 4 * tmp->w);
+}
+
 IdPoolRef ImagePacker::add_img(int hotspot_x, int hotspot_y, SDL_Surface *surf) {
 	std::vector<std::pair<int, int>> m;
 	return add_img(hotspot_x, hotspot_y, surf, m);
@@ -45,7 +88,7 @@ IdPoolRef ImagePacker::add_img(int hotspot_x, int hotspot_y, SDL_Surface *surf,
 	return ins.first->first;
 }
 
-Tileset ImagePacker::collect(int w, int h) {
+Tileset ImagePacker::collect(int w, int h, ctpl::thread_pool &tp) {
 	ZoneScoped;
 
 	if (w < 1 || h < 1)
@@ -117,25 +160,20 @@ Tileset ImagePacker::collect(int w, int h) {
 	{
 		ZoneScopedN("copy");
 		ts.surf.reset(SDL_CreateRGBSurfaceWithFormat(0, w, h, 32, SDL_PIXELFORMAT_RGBA32));
+		if (!ts.surf)
+			throw std::runtime_error("cannot create tileset surface");
 
-		std::unique_ptr<SDL_Surface, decltype(&SDL_FreeSurface)> tmp(nullptr, SDL_FreeSurface);
-
-		// traverse again to copy data to big surface
-		for (const ImageRef &r : ts.imgs) {
-			SDL_Surface *surf = images.at(r.ref).surf;
-			tmp.reset(SDL_ConvertSurfaceFormat(surf, SDL_PIXELFORMAT_RGBA32, 0));
-			if (!tmp)
-				throw std::runtime_error("cannot convert image");
+		std::vector<const ImageRef*> todo;
+		todo.reserve(ts.imgs.size());
 
-			uint32_t *pixels1 = (uint32_t*)ts.surf->pixels;
-			const uint32_t *pixels0 = (const uint32_t*)tmp->pixels;
+		for (const ImageRef &r : ts.imgs)
+			todo.emplace_back(&r);
 
-			int p1 = ts.surf->pitch >> 2, p0 = tmp->pitch >> 2;
-
-			// copy data
-			for (int y0 = 0, y1 = r.bnds.y, h = tmp->h; y0 < h; ++y0, ++y1)
-				memcpy(&pixels1[y1 * p1 + r.bnds.x], &pixels0[y0 * p0], 4 * tmp->w);
-		}
+		// all images end up in different parts of the big surface, so they can be copied concurrently
+		parallel_for(tp, todo.size(), [&](size_t i) {
+			const ImageRef &r = *todo[i];
+			copy_image(ts.surf.get(), r.bnds, images.at(r.ref).surf);
+		});
 	}
 
 	return ts;
@@ -30,6 +30,14 @@ void Tileset::write(GLuint tex) {
 
 	//surf->w = std::min(4096 * 2, surf->w);
 
+	// rows are usually contiguous already, e.g. when loaded from the asset cache
+	if (surf->pitch == 4 * surf->w) {
+		ZoneScopedN("flush");
+		glTexImage2D(GL_TEXTURE_2D, 0, mode, surf->w, surf->h, 0, mode, GL_UNSIGNED_BYTE, surf->pixels);
+		surf.reset();
+		return;
+	}
+
 	std::vector<uint32_t> data;
 	{
 		ZoneScopedN("resize");
@@ -108,9 +108,30 @@ void Game::terrain_set(const std::vector<uint16_t> &tiles, const std::vector<uin
 	modflags |= (unsigned)GameMod::terrain;
 }
 
-void Game::entities_set(std::set<Entity> &&ent) {
+void Game::terrain_paint(const std::vector<TilePaint> &lst) {
+	ZoneScoped;
+	std::lock_guard<std::mutex> lk(m);
+
+	if (t.paint(lst))
+		modflags |= (unsigned)GameMod::terrain;
+}
+
+void Game::entities_set(std::set<Entity> &&ent, const std::set<IdPoolRef> &spawned) {
 	lock lk(m);
-	entities = ent;
+
+	// same as entity_set, so the ui knows who has just died
+	for (const Entity &e : ent) {
+		auto it = entities.find(e);
+		if (it == entities.end() || it->state == e.state)
+			continue;
+
+		if (e.state == EntityState::dying || (e.state == EntityState::decaying && e.is_building()))
+			entities_killed.emplace_back(e);
+	}
+
+	entities = std::move(ent);
+	entities_spawned.insert(spawned.begin(), spawned.end());
+	modflags |= (unsigned)GameMod::entities;
 }
 
 void Game::set_players(const std::vector<PlayerSetting> &lst) {
@@ -178,8 +199,49 @@ void Game::particle_spawn(const Particle &p) {
 }
 
 void Game::entity_update(const EntityView &ev) {
-	EntityView v(ev);
 	std::lock_guard<std::mutex> lk(m);
+	entity_set(ev);
+}
+
+void Game::entity_snapshot(const std::vector<NetEntityDelta> &lst) {
+	std::lock_guard<std::mutex> lk(m);
+
+	for (const NetEntityDelta &d : lst) {
+		auto it = entities.find(d.ev.ref);
+
+		if (d.flags & (unsigned)NetEntityDeltaFlags::leave) {
+			if (it != entities.end())
+				entities.erase(it);
+			continue;
+		}
+
+		if (d.flags & (unsigned)NetEntityDeltaFlags::full) {
+			if (d.flags & (unsigned)NetEntityDeltaFlags::spawn) {
+				entities.emplace(d.ev);
+				entities_spawned.emplace(d.ev.ref);
+			} else if (it == entities.end()) {
+				entities.emplace(d.ev);
+			} else {
+				entity_set(d.ev);
+			}
+			continue;
+		}
+
+		// deltas are relative to the last full record. if we don't have it, there is nothing to patch
+		if (it == entities.end())
+			continue;
+
+		EntityView v(*it);
+		d.apply(v);
+		entity_set(v);
+	}
+
+	modflags |= (unsigned)GameMod::entities;
+}
+
+/** Add or replace entity. NOTE assuming mutex \a m has already been acquired. */
+void Game::entity_set(const EntityView &ev) {
+	EntityView v(ev);
 
 	bool statechange = false;
 	auto it = entities.find(v);
@@ -243,7 +305,7 @@ bool GameView::try_read(Game &g, bool reset) {
 		return false;
 
 	if (g.modflags & (unsigned)GameMod::terrain)
-		t = g.t;
+		t.sync(g.t);
 
 	// TODO only copy what has changed
 	players_died.clear();
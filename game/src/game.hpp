@@ -114,6 +114,7 @@ public:
 
 class GameView;
 struct NetPlayerScore;
+class NetEntityDelta;
 class LocalClient;
 
 enum class GameMod {
@@ -152,6 +153,8 @@ public:
 	void resize(const ScenarioSettings &scn);
 	void terrain_create();
 	void terrain_set(const std::vector<uint16_t> &tiles, const std::vector<uint8_t> &hmap, unsigned x, unsigned y, unsigned w, unsigned h);
+	/** Paint tiles and fix the terrain around them. See Terrain::paint. */
+	void terrain_paint(const std::vector<TilePaint> &lst);
 
 	void set_players(const std::vector<PlayerSetting>&);
 	void set_player_score(unsigned idx, const NetPlayerScore&);
@@ -163,8 +166,11 @@ public:
 	void entity_spawn(const EntityView &ev);
 	bool entity_kill(IdPoolRef);
 	void entity_update(const EntityView &ev);
+	/** Apply all records from an entity snapshot at once. */
+	void entity_snapshot(const std::vector<NetEntityDelta>&);
 
-	void entities_set(std::set<Entity> &&ent);
+	/** Replace all entities. Used by lockstep games, where we tick the world ourselves. */
+	void entities_set(std::set<Entity> &&ent, const std::set<IdPoolRef> &spawned);
 
 	void particle_spawn(const Particle &p);
 
@@ -175,6 +181,7 @@ public:
 	PlayerView pv(unsigned);
 private:
 	void imgtick(unsigned n);
+	void entity_set(const EntityView &ev);
 };
 
 class GameView final {
@@ -2,6 +2,8 @@
 
 #include <cassert>
 
+#include <cstring>
+#include <mutex>
 #include <vector>
 
 #include "../engine/endian.h"
@@ -14,33 +16,41 @@
 
 #pragma clang diagnostic ignored "-Wswitch"
 
-// don't ask me why, but windows needs this and including the correct header does not seem to help
-#if _WIN32
-int ::rand(void);
-#endif
-
 namespace aoe {
 
 namespace gfx {
 
 using namespace aoe::io;
 
+// SDL palette reference counting is not thread safe and images may be loaded concurrently
+static std::mutex pal_lock;
+
+static void set_palette(SDL_Surface *surface, const SDL_Palette *pal) {
+	std::lock_guard<std::mutex> lk(pal_lock);
+
+	if (SDL_SetSurfacePalette(surface, (SDL_Palette*)pal))
+		throw std::runtime_error(std::string("Could not set Slp palette: ") + SDL_GetError());
+}
+
+/** Offset in the palette of the player colours for \a player. */
+static unsigned player_color(unsigned player) {
+	assert(player < MAX_PLAYERS);
+	return 0x10 * (player ? player : 10);
+}
+
 static unsigned cmd_or_next(const std::vector<uint8_t> &data, uint32_t &cmdpos, unsigned n)
 {
 	unsigned v = data.at(cmdpos) >> n;
 	return v ? v : data.at(++cmdpos);
 }
 
-bool Image::load(const SDL_Palette *pal, const Slp &slp, unsigned index, unsigned player, io::DrsId id) {
+bool Image::load(const SDL_Palette *pal, const Slp &slp, unsigned index, unsigned player, io::DrsId id, std::vector<uint32_t> *player_px) {
 	ZoneScoped;
 	const SlpFrame &frame = slp.frames.at(index);
+	unsigned col = player_color(player);
 
-	assert(player < MAX_PLAYERS);
-
-	if (!player)
-		player = 9;
-	else
-		--player;
+	if (player_px)
+		player_px->clear();
 
 	hotspot_x = frame.hotspot_x;
 	hotspot_y = frame.hotspot_y;
@@ -52,13 +62,12 @@ bool Image::load(const SDL_Palette *pal, const Slp &slp, unsigned index, unsigne
 	// load pixel data
 	unsigned char *pixels = (unsigned char*)surface->pixels;
 
-	if (SDL_SetSurfacePalette(surface.get(), (SDL_Palette*)pal))
-		throw std::runtime_error(std::string("Could not set Slp palette: ") + SDL_GetError());
+	set_palette(surface.get(), pal);
 
 	if (surface->format->format != SDL_PIXELFORMAT_INDEX8)
 		throw std::runtime_error(std::string("Unexpected image format: ") + SDL_GetPixelFormatName(surface->format->format));
 
-	uint32_t cmdpos = 0;
+	uint32_t cmdpos = 0, garbage = index;
 	const std::vector<uint8_t> &cmd = frame.cmd;
 	unsigned maxerr = 5;
 	bool bail_out = false, dynamic = false, rectangular = true;
@@ -84,7 +93,7 @@ bool Image::load(const SDL_Palette *pal, const Slp &slp, unsigned index, unsigne
 
 		// fill row with garbage so any funny bytes will be visible immediately
 		for (int x = e.left_space, w = x + line_size, p = surface->pitch; x < w; ++x)
-			pixels[y * p + x] = rand();
+			pixels[y * p + x] = (garbage = garbage * 1103515245 + 12345) >> 16;
 
 		for (int i = e.left_space, x = i, w = x + line_size, p = surface->pitch; i <= w; ++i, ++cmdpos) {
 			unsigned char bc = cmd.at(cmdpos);
@@ -99,8 +108,11 @@ bool Image::load(const SDL_Palette *pal, const Slp &slp, unsigned index, unsigne
 			case 0x0a:
 				count = cmd_or_next(cmd, cmdpos, 4);
 
-				for (++cmdpos; count; --count)
-					pixels[y * p + x++] = cmd.at(cmdpos) + 0x10 * (player + 1);
+				for (++cmdpos; count; --count) {
+					if (player_px)
+						player_px->emplace_back(y * p + x);
+					pixels[y * p + x++] = cmd.at(cmdpos) + col;
+				}
 
 				dynamic = true;
 				break;
@@ -116,8 +128,11 @@ bool Image::load(const SDL_Palette *pal, const Slp &slp, unsigned index, unsigne
 			case 0x06:
 				count = cmd_or_next(cmd, cmdpos, 4);
 
-				for (; count; --count)
-					pixels[y * p + x++] = cmd.at(++cmdpos) + 0x10 * (player + 1);
+				for (; count; --count) {
+					if (player_px)
+						player_px->emplace_back(y * p + x);
+					pixels[y * p + x++] = cmd.at(++cmdpos) + col;
+				}
 
 				dynamic = true;
 				break;
@@ -209,6 +224,36 @@ bool Image::load(const SDL_Palette *pal, const Slp &slp, unsigned index, unsigne
 	return dynamic;
 }
 
+void Image::recolor(const SDL_Palette *pal, const Image &src, const std::vector<uint32_t> &player_px, unsigned src_player, unsigned player) {
+	ZoneScoped;
+	SDL_Surface *s = src.surface.get();
+
+	hotspot_x = src.hotspot_x;
+	hotspot_y = src.hotspot_y;
+	mask = src.mask;
+
+	surface.reset(SDL_CreateRGBSurface(0, s->w, s->h, 8, 0, 0, 0, 0));
+	if (!surface.get())
+		throw std::runtime_error(std::string("Could not create Slp surface: ") + SDL_GetError());
+
+	set_palette(surface.get(), pal);
+
+	if (surface->pitch != s->pitch)
+		throw std::runtime_error("Unexpected image pitch");
+
+	unsigned char *pixels = (unsigned char*)surface->pixels;
+	memcpy(pixels, s->pixels, (size_t)s->pitch * s->h);
+
+	// NOTE wraps around just like in load
+	unsigned char delta = player_color(player) - player_color(src_player);
+
+	for (uint32_t pos : player_px)
+		pixels[pos] += delta;
+
+	if (SDL_SetColorKey(surface.get(), SDL_TRUE, 0))
+		fprintf(stderr, "Could not set transparency: %s\n", SDL_GetError());
+}
+
 }
 
 }
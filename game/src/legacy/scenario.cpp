@@ -2,6 +2,7 @@
 
 #include <cstddef>
 #include <cassert>
+#include <cstdlib>
 #include <fstream>
 
 #include "../engine/endian.h"
@@ -492,8 +493,9 @@ std::string Scenario::str(size_t &pos, size_t max) const {
 
 // TODO extract scenarioeditor functions to separate file
 void ScenarioEditor::create_map(Game &g) {
-	map_width  = std::clamp(map_gen_width , 0, UINT16_MAX + 1);
-	map_height = std::clamp(map_gen_height, 0, UINT16_MAX + 1);
+	// same limits as the world, so whatever we make can be played
+	map_width  = std::clamp(map_gen_width , (int)Terrain::min_size, (int)Terrain::max_size);
+	map_height = std::clamp(map_gen_height, (int)Terrain::min_size, (int)Terrain::max_size);
 
 	ScenarioSettings scn;
 	scn.width = map_width;
@@ -503,6 +505,47 @@ void ScenarioEditor::create_map(Game &g) {
 	g.terrain_create();
 }
 
+static const TileType brush_types[] = { TileType::desert, TileType::grass, TileType::water, TileType::deepwater };
+
+void ScenarioEditor::paint(int x, int y) {
+	TileType t = brush_types[std::clamp(brush_type, 0, (int)(sizeof(brush_types) / sizeof(brush_types[0])) - 1)];
+	int size = std::max(1, brush_size);
+	int x0 = x - (size - 1) / 2, y0 = y - (size - 1) / 2;
+
+	for (int ty = std::max(0, y0); ty < y0 + size; ++ty)
+		for (int tx = std::max(0, x0); tx < x0 + size; ++tx)
+			stroke.emplace_back(tx, ty, t);
+}
+
+void ScenarioEditor::brush_to(int x, int y) {
+	if (!brush_down) {
+		brush_down = true;
+		paint(x, y);
+	} else if (x != brush_x || y != brush_y) {
+		// the mouse can go over several tiles in one frame
+		int dx = x - brush_x, dy = y - brush_y;
+		int n = std::max(std::abs(dx), std::abs(dy));
+
+		for (int i = 1; i <= n; ++i)
+			paint(brush_x + dx * i / n, brush_y + dy * i / n);
+	}
+
+	brush_x = x;
+	brush_y = y;
+}
+
+void ScenarioEditor::brush_up() {
+	brush_down = false;
+}
+
+void ScenarioEditor::flush_brush(Game &g) {
+	if (stroke.empty())
+		return;
+
+	g.terrain_paint(stroke);
+	stroke.clear();
+}
+
 void ScenarioEditor::load(const io::Scenario &scn) {
 	map_gen_width  = map_width  = scn.w;
 	map_gen_height = map_height = scn.h;
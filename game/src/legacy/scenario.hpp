@@ -7,6 +7,7 @@
 #include <stdexcept>
 
 #include "../world/entity.hpp"
+#include "../world/terrain.hpp"
 
 namespace aoe {
 
@@ -68,14 +69,32 @@ public:
 
 	int map_width, map_height;
 
+	int brush_type, brush_size;
+
 	static constexpr unsigned version = 1;
 
 	void create_map(Game &g);
 
+	/** Paint at (\a x, \a y) with the brush. Tiles skipped since the last position are painted as well. */
+	void brush_to(int x, int y);
+	/** End the stroke, e.g. when the mouse button is released. */
+	void brush_up();
+	/**
+	 * Apply everything painted since the last flush in one go. Call it once per frame, so a stroke
+	 * costs one Terrain::paint per frame however many tiles the brush went over.
+	 */
+	void flush_brush(Game &g);
+
 	void load(const std::string &path);
 	void save(const std::string &path);
 
 	void load(const io::Scenario&);
+private:
+	std::vector<TilePaint> stroke;
+	int brush_x, brush_y;
+	bool brush_down;
+
+	void paint(int x, int y);
 };
 
 }
\ No newline at end of file
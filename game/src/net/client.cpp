@@ -142,10 +142,10 @@ void LocalClient::entity_kill(IdPoolRef ref) {
 Client::Client(const std::string &username)
 	: IClient()
 	, s(), port(0), starting(false), peers()
-	, sendbuf(), initial_username(username), gamespeed(0) {}
+	, sendbuf(), initial_username(username), gamespeed(0), lockstep() {}
 
 void Client::mainloop() {
-	send_protocol(1);
+	send_protocol(net_protocol);
 
 	try {
 		starting = false;
@@ -217,9 +217,15 @@ void Client::mainloop() {
 				case NetPkgType::entity_mod:
 					entitymod(pkg.get_entity_mod());
 					break;
+				case NetPkgType::entity_snapshot:
+					entitymod(pkg.get_entity_snapshot());
+					break;
 				case NetPkgType::gameticks:
 					gameticks(pkg.get_gameticks());
 					break;
+				case NetPkgType::lockstep_frame:
+					lockstep_frame(pkg.get_lockstep_frame());
+					break;
 				case NetPkgType::gamespeed_control:
 					gamespeed_control(pkg.get_gamespeed());
 					break;
@@ -364,6 +370,16 @@ void Client::playermod(const NetPlayerControl &ctl) {
 
 			break;
 		}
+		case NetPlayerControlType::set_type: {
+			auto p = std::get<std::pair<uint16_t, uint16_t>>(ctl.data);
+
+			unsigned pos = p.first;
+
+			if (pos < scn.players.size())
+				scn.players[pos].type = (PlayerType)p.second;
+
+			break;
+		}
 		case NetPlayerControlType::set_score: {
 			auto p = std::get<NetPlayerScore>(ctl.data);
 			g.set_player_score(p.playerid, p);
@@ -382,6 +398,9 @@ void Client::start_game() {
 
 	g.set_players(scn.players);
 
+	if (scn.lockstep)
+		lockstep_start();
+
 	puts("start game");
 	if (eng)
 		eng->trigger_async_flags(EngineAsyncTask::multiplayer_started);
@@ -540,6 +559,9 @@ void Client::set_scn_vars(const ScenarioSettings &scn) {
 	this->scn.popcap = scn.popcap;
 	this->scn.age = scn.age;
 	this->scn.villagers = scn.villagers;
+	// lockstep games need these to create the same world as the server
+	this->scn.seed = scn.seed;
+	this->scn.lockstep = scn.lockstep;
 
 	this->scn.res = scn.res;
 	this->modflags |= (unsigned)ClientModFlags::scn;
@@ -28,4 +28,9 @@ void Client::entitymod(const NetEntityMod &em) {
 	}
 }
 
+void Client::entitymod(const std::vector<NetEntityDelta> &lst) {
+	std::lock_guard<std::mutex> lk(m);
+	g.entity_snapshot(lst);
+}
+
 }
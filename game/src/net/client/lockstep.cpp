@@ -0,0 +1,40 @@
+#include "../../server.hpp"
+
+namespace aoe {
+
+void Client::lockstep_start() {
+	ZoneScoped;
+	ScenarioSettings scn;
+	{
+		lock lk(m);
+		scn = this->scn;
+	}
+
+	lockstep.reset(new LockstepWorld());
+	lockstep->w.start_lockstep(lockstep->s, scn);
+	lockstep->w.sync_lockstep(g);
+}
+
+void Client::lockstep_frame(const LockstepFrame &f) {
+	ZoneScoped;
+	if (!lockstep)
+		throw std::runtime_error("lockstep frame without lockstep game");
+
+	std::vector<NetStateHash> hashes;
+	lockstep->w.step_lockstep(f, hashes);
+
+	if (f.steps)
+		g.tick(f.steps);
+
+	lockstep->w.sync_lockstep(g);
+
+	// let the server check we are still in sync
+	NetPkg pkg;
+
+	for (const NetStateHash &h : hashes) {
+		pkg.set_state_hash(h);
+		send(pkg);
+	}
+}
+
+}
@@ -608,7 +608,7 @@ void TcpSocket::recv_fully(void *ptr, int len) {
 	throw std::runtime_error(std::string("tcp: recv_fully failed: ") + std::to_string(in) + (in == 1 ? " byte read out of " : " bytes read out of ") + std::to_string(len));
 }
 
-ServerSocket::ServerSocket() : s(), h(INVALID_HANDLE_VALUE), port(0), events(), peers(), peer_host(INVALID_SOCKET), peer_ev_lock(), data_lock(), m_pending(), data_in(), data_out(), recvbuf(), sendbuf(), running(false), step(false), poll_us(50u * 1000ull), closing(), send_pending(), id(std::this_thread::get_id()), m_ctl(), ctl(nullptr) {}
+ServerSocket::ServerSocket() : s(), h(INVALID_HANDLE_VALUE), port(0), events(), peers(), peer_host(INVALID_SOCKET), peer_ev_lock(), data_lock(), m_pending(), data_in(), data_out(), recvbuf(0), sendbuf(0), running(false), step(false), poll_us(50u * 1000ull), closing(), stalled(), send_pending(), id(std::this_thread::get_id()), m_ctl(), ctl(nullptr) {}
 
 ServerSocket::~ServerSocket() { stop(); }
 
@@ -787,8 +787,30 @@ bool ServerSocket::io_step(int idx) {
 bool ServerSocket::recv_step(const Peer &p, SOCKET s) {
 	ZoneScoped;
 
+	std::unique_lock<std::mutex> lk(data_lock);
+	// NOTE data_in is only modified from the mainloop thread, so in and the spans stay valid while unlocked
+	RingBuffer &in = data_in.try_emplace(s).first->second;
+
 	while (1) {
-		int count = ::recv(s, recvbuf.data(), recvbuf.size(), 0);
+		bool stall = false;
+
+		// whatever is left from when we stalled goes first
+		if (!process_step(p, s, in, stall))
+			return false;
+
+		// leave the rest in the socket until the controller can take more
+		if (stall) {
+			stalled.emplace(s);
+			return true;
+		}
+
+		// receive directly into the peer's queue
+		auto span = in.write_span(recvbuf);
+
+		// don't keep other threads waiting on the lock while the kernel copies
+		lk.unlock();
+
+		int count = ::recv(s, (char*)span.first, (int)span.second, 0);
 		if (count < 0) {
 #if _WIN32
 			int r = WSAGetLastError();
@@ -815,40 +837,67 @@ bool ServerSocket::recv_step(const Peer &p, SOCKET s) {
 		}
 
 		step = true;
-		std::unique_lock<std::mutex> lk(data_lock);
+		lk.lock();
+		in.commit(count);
+	}
+}
 
-		auto ins = data_in.try_emplace(s);
-		auto it = ins.first;
-		for (int i = 0; i < count; ++i)
-			it->second.emplace_back(recvbuf[i]);
+/** Process all complete packets in \a in. Sets \a stall if the controller can't take any more for now. Returns false to drop the peer. */
+bool ServerSocket::process_step(const Peer &p, SOCKET s, RingBuffer &in, bool &stall) {
+	std::lock_guard<std::mutex> lkctl(m_ctl);
+	int processed = 0;
 
-		std::unique_lock<std::mutex> lkctl(m_ctl);
-		int processed = 0;
+	while ((processed = ctl->proper_packet(*this, in)) > 0) {
+		if (!ctl->can_process(*this, p)) {
+			stall = true;
+			return true;
+		}
 
-		while ((processed = ctl->proper_packet(*this, it->second)) > 0) {
-			bool keep_alive = false;
+		bool keep_alive = false;
 
-			try {
-				auto outs = data_out.try_emplace(s);
-				auto out = outs.first;
+		try {
+			RingBuffer &out = data_out.try_emplace(s, sendbuf).first->second;
+			keep_alive = ctl->process_packet(*this, p, in, out, processed);
+		} catch (const std::exception &e) {
+			fprintf(stderr, "%s: failed to process for (%s,%s): %s\n", __func__, p.host.c_str(), p.server.c_str(), e.what());
+		}
 
-				keep_alive = ctl->process_packet(*this, p, it->second, out->second, processed);
-			} catch (const std::exception &e) {
-				fprintf(stderr, "%s: failed to process for (%s,%s): %s\n", __func__, p.host.c_str(), p.server.c_str(), e.what());
-			}
+		if (!keep_alive)
+			return false;
+	}
 
-			if (!keep_alive)
-				return false;
-		}
+	// remove bytes if asked to do so
+	if (processed < 0)
+		in.consume((size_t)-(long long)processed);
 
-		lkctl.unlock();
+	return true;
+}
 
-		// remove bytes if asked to do so
-		for (; processed < 0 && !it->second.empty(); ++processed)
-			it->second.pop_front();
+/** Read from stalled peers again. Returns false if the host has to be dropped. */
+bool ServerSocket::resume_step() {
+	ZoneScoped;
 
-		lk.unlock();
+	if (stalled.empty())
+		return true;
+
+	std::lock_guard<std::mutex> lk(peer_ev_lock);
+
+	// recv_step puts them back if they still have to wait
+	std::set<SOCKET> retry;
+	retry.swap(stalled);
+
+	for (SOCKET s : retry) {
+		auto it = peers.find(s);
+		if (it == peers.end() || (recv_step(it->second, s) && send_step(s)))
+			continue;
+
+		if (s == peer_host)
+			return false;
+
+		closing.emplace_back(s);
 	}
+
+	return true;
 }
 
 bool ServerSocket::send_step(SOCKET s) {
@@ -859,19 +908,17 @@ bool ServerSocket::send_step(SOCKET s) {
 	if (it == data_out.end())
 		return true;
 
-	auto &q = it->second;
+	// NOTE data_out is only modified from the mainloop thread, so q and the spans stay valid while unlocked
+	RingBuffer &q = it->second;
 	while (!q.empty()) {
 		//printf("%s: try send %llu bytes to %d\n", __func__, (unsigned long long)q.size(), (int)s);
 		int count;
-		int out = (int)std::min(sendbuf.size(), q.size());
-
-		for (int i = 0; i < out; ++i)
-			sendbuf[i] = q[i];
+		auto span = q.read_span();
 
 		// s may be closed after this unlock, but this way, we give a brief moment for other threads to kick in
 		lk.unlock();
 
-		count = ::send(s, sendbuf.data(), out, 0);
+		count = ::send(s, (const char*)span.first, (int)span.second, 0);
 		if (count < 0) {
 #if _WIN32
 			int r = WSAGetLastError();
@@ -898,7 +945,7 @@ bool ServerSocket::send_step(SOCKET s) {
 		step = true;
 		lk.lock();
 		// remove data from queue
-		q.erase(q.begin(), q.begin() + count);
+		q.consume(count);
 	}
 
 	return true;
@@ -924,10 +971,11 @@ void ServerSocket::reset(ServerSocketController &ctl, unsigned recvbuf, unsigned
 	data_in.clear();
 	data_out.clear();
 
-	this->recvbuf.resize(recvbuf);
-	this->sendbuf.resize(sendbuf);
+	this->recvbuf = recvbuf;
+	this->sendbuf = sendbuf;
 
 	closing.clear();
+	stalled.clear();
 	id = std::this_thread::get_id();
 
 	std::lock_guard<std::mutex> lks(m_pending);
@@ -952,6 +1000,7 @@ void ServerSocket::reduce_peers() {
 		::close(sock);
 		data_out.erase(sock);
 		send_pending.erase(sock);
+		stalled.erase(sock);
 	}
 
 	slk.unlock();
@@ -1000,14 +1049,9 @@ void ServerSocket::queue_out(const Peer &p, const void *ptr, int len) {
 
 	auto it = send_pending.find(sock);
 	if (it == send_pending.end())
-		it = send_pending.try_emplace(sock).first;
-
-	std::deque<uint8_t> &out = it->second;
-
-	const uint8_t *src = (const uint8_t*)ptr;
+		it = send_pending.try_emplace(sock, sendbuf).first;
 
-	for (int i = 0; i < len; ++i)
-		out.emplace_back(src[i]);
+	it->second.push_back(ptr, len);
 }
 
 void ServerSocket::send(const Peer &p, const void *ptr, int len) {
@@ -1044,9 +1088,8 @@ void ServerSocket::flush_queue() {
 		return;
 
 	for (auto it = send_pending.begin(); it != send_pending.end();) {
-		auto kv = *it;
-		SOCKET sock = kv.first;
-		auto q = kv.second;
+		SOCKET sock = it->first;
+		RingBuffer &q = it->second;
 
 		// remove if nothing to send anymore
 		if (q.empty()) {
@@ -1058,7 +1101,7 @@ void ServerSocket::flush_queue() {
 		std::unique_lock<std::mutex> lk(data_lock);
 
 		auto it2 = data_out.find(sock);
-		std::deque<uint8_t> *q2 = nullptr;
+		RingBuffer *q2 = nullptr;
 
 		if (it2 == data_out.end()) {
 			// no data_out item: use queue from send_pending
@@ -1075,7 +1118,7 @@ void ServerSocket::flush_queue() {
 		}
 
 		// prepare to send
-		std::swap(*q2, q);
+		q2->swap(q);
 		it = send_pending.erase(it);
 
 		lk.unlock();
@@ -1111,13 +1154,19 @@ int ServerSocket::mainloop(uint16_t port, int backlog, ServerSocketController &c
 	// send queue is flushed periodically regardless of incoming traffic.
 	const int poll_ms = poll_us ? std::max(1, (int)(poll_us / 1000)) : -1;
 
-	for (int nfds; (nfds = epoll_wait(h, events.data(), events.size(), poll_ms)) >= 0; step = false) {
+	// stalled peers have to be retried soon, as they won't get another event for the data that is already waiting
+	for (int nfds; (nfds = epoll_wait(h, events.data(), events.size(), stalled.empty() ? poll_ms : 1)) >= 0; step = false) {
 		for (int i = 0; i < nfds; ++i)
 			if (!event_step(i)) {
 				stop();
 				return 0;
 			}
 
+		if (!resume_step()) {
+			stop();
+			return 0;
+		}
+
 		reduce_peers();
 		flush_queue();
 
@@ -5,9 +5,9 @@
 #include <stdexcept>
 
 #include <atomic>
-#include <deque>
 #include <vector>
 #include <map>
+#include <set>
 #include <mutex>
 #include <thread>
 #include <string>
@@ -35,6 +35,7 @@
 
 #include "../debug.hpp"
 #include <ctpl_stl.hpp>
+#include <ringbuf.hpp>
 
 namespace aoe {
 
@@ -189,7 +190,13 @@ public:
 	 *   returns a positive number to indicate at least one packet has been received.
 	 *   returns a negative number to drop the first X bytes in the queue. E.g.: -3 indicates 3 bytes have to be removed
 	 */
-	virtual int proper_packet(ServerSocket &s, const std::deque<uint8_t>&) = 0;
+	virtual int proper_packet(ServerSocket &s, const RingBuffer&) = 0;
+
+	/*
+	 * whether process_packet can take another packet from this peer right now.
+	 *   if not, the peer is not read from until it can, so its data backs up in the socket instead of being dropped.
+	 */
+	virtual bool can_process(ServerSocket &s, const Peer &p) { return true; }
 
 	/*
 	 * process received packet that's considered valid according to proper_packet reading from in and sending any response to out
@@ -197,7 +204,7 @@ public:
 	 *   processed is the value that was returned by proper_packet. processed will always be positive.
 	 *   return false if you want to drop the connected client. true to keep it open.
 	 */
-	virtual bool process_packet(ServerSocket &s, const Peer &p, std::deque<uint8_t> &in, std::deque<uint8_t> &out, int processed) = 0;
+	virtual bool process_packet(ServerSocket &s, const Peer &p, RingBuffer &in, RingBuffer &out, int processed) = 0;
 };
 
 // TODO check if properly multi thread-safe: should work for open, stop, close and parts of mainloop
@@ -209,13 +216,14 @@ class ServerSocket final {
 	std::map<SOCKET, Peer> peers;
 	SOCKET peer_host;
 	std::mutex peer_ev_lock, data_lock, m_pending;
-	std::map<SOCKET, std::deque<uint8_t>> data_in, data_out;
-	std::vector<char> recvbuf, sendbuf;
+	std::map<SOCKET, RingBuffer> data_in, data_out;
+	unsigned recvbuf, sendbuf; // minimum free space for receiving and initial capacity for sending
 	std::atomic<bool> running;
 	bool step;
 	std::atomic<unsigned long long> poll_us;
 	std::vector<SOCKET> closing;
-	std::map<SOCKET, std::deque<uint8_t>> send_pending;
+	std::set<SOCKET> stalled; // peers we stopped reading from, see ServerSocketController::can_process
+	std::map<SOCKET, RingBuffer> send_pending;
 	std::atomic<std::thread::id> id;
 
 	std::mutex m_ctl;
@@ -237,13 +245,13 @@ public:
 	 * NOTE: on Windows, this will call WSAStartup (just once) when the epoll library starts up.
 	 *
 	 * arguments:
-	 * int (*proper_packet)(const std::deque<uint8_t>&):
+	 * int (*proper_packet)(const RingBuffer&):
 	 *   determines whether the packet received so far is complete
 	 *   returns 0 if it needs more data
 	 *   returns a positive number to indicate at least one packet has been received.
 	 *   returns a negative number to drop the first X bytes in the queue. E.g.: -3 indicates 3 bytes have to be removed
 	 * 
-	 * bool (*process_packet)(std::deque<uint8_t> &in, std::deque<uint8_t> &out, int arg):
+	 * bool (*process_packet)(RingBuffer &in, RingBuffer &out, int arg):
 	 *   process received packet that's considered valid according to proper_packet reading from in and sending any response to out
 	 *   the received data is in in, the data to be sent can be put in out.
 	 *   arg is the value that was returned by proper_packet. arg will always be positive.
@@ -272,6 +280,8 @@ private:
 	bool io_step(int idx);
 
 	bool recv_step(const Peer &p, SOCKET s);
+	bool process_step(const Peer &p, SOCKET s, RingBuffer &in, bool &stall);
+	bool resume_step();
 	bool send_step(SOCKET s);
 
 	bool event_step(int idx);
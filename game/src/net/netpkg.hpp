@@ -1,4 +1,5 @@
 #include "net.hpp"
+#include "schema.hpp"
 
 #include <variant>
 #include <vector>
@@ -12,6 +13,8 @@
 namespace aoe {
 
 class PkgWriter;
+class WorldEvent;
+class LockstepFrame;
 
 typedef std::variant<uint64_t, std::string> netarg;
 typedef std::vector<netarg> netargs;
@@ -38,7 +41,7 @@ public:
 	NetPkg() : hdr(0, 0, false), data(), args() {}
 	NetPkg(uint16_t type, uint16_t payload) : hdr(type, payload), data(), args() {}
 	/** munch as much data we need and check if valid. throws if invalid or not enough data. */
-	NetPkg(std::deque<uint8_t> &q);
+	NetPkg(RingBuffer &q);
 
 	void set_protocol(uint16_t version);
 	uint16_t protocol_version();
@@ -65,6 +68,7 @@ public:
 	void set_player_name(uint16_t, const std::string&);
 	void set_player_died(uint16_t); // server to client
 	void set_player_score(uint16_t, const PlayerAchievements&); // server to client
+	void set_player_type(uint16_t, PlayerType); // server to client
 	NetPlayerControl get_player_control();
 
 	void set_incoming(IdPoolRef);
@@ -98,7 +102,11 @@ public:
 	void entity_move(IdPoolRef, float x, float y);
 	void entity_task(IdPoolRef, IdPoolRef, EntityTaskType type=EntityTaskType::infer);
 	void entity_train(IdPoolRef, EntityType);
-	NetEntityMod get_entity_mod();
+	NetEntityMod get_entity_mod() const;
+
+	/** Pack as many records from \a lst as possible starting at \a offset. Returns number of records packed. */
+	size_t set_entity_snapshot(const std::vector<NetEntityDelta> &lst, size_t offset=0);
+	std::vector<NetEntityDelta> get_entity_snapshot();
 
 	void particle_spawn(const Particle &p);
 	Particle get_particle();
@@ -109,12 +117,19 @@ public:
 	NetGamespeedControl get_gamespeed();
 	void set_gamespeed(NetGamespeedType type, uint8_t speed);
 
+	/** Pack as many inputs from \a inputs as possible starting at \a offset. Returns number of inputs packed. */
+	size_t set_lockstep_frame(uint32_t tick, unsigned steps, const std::vector<WorldEvent> &inputs, size_t offset=0); // server to client
+	LockstepFrame get_lockstep_frame();
+
+	void set_state_hash(const NetStateHash&); // client to server
+	NetStateHash get_state_hash();
+
 	NetPkgType type();
 
 	void ntoh();
 	void hton();
 
-	void write(std::deque<uint8_t> &q);
+	void write(RingBuffer &q);
 	void write(std::vector<uint8_t> &q);
 
 	size_t size() const noexcept {
@@ -128,6 +143,8 @@ private:
 	void playermod2(NetPlayerControlType, uint16_t, uint16_t);
 
 	void chktype(NetPkgType type);
+	/** Same as chktype, but leaves the header alone. */
+	void chktype(NetPkgType type) const;
 
 	unsigned read(NetPkgType, const std::string &fmt);
 	unsigned read(const std::string &fmt, netargs &args, unsigned offset=0);
@@ -136,6 +153,22 @@ private:
 	void clear();
 	netArgsStatus writef(const char *fmt, ...);
 
+	/** Append \a v using layout \a S. */
+	template<typename S, typename C> void put(const C &v) {
+		size_t n = data.size();
+		data.resize(n + S::size);
+		S::write(data.data() + n, v);
+	}
+
+	/** Read \a v using layout \a S at \a pos and advance \a pos. */
+	template<typename S, typename C> void get(C &v, unsigned &pos) const {
+		if (data.size() < pos + S::size)
+			throw std::runtime_error("corrupt data");
+
+		S::read(data.data() + pos, v);
+		pos += S::size;
+	}
+
 	int8_t i8(unsigned pos) const;
 	uint8_t u8(unsigned pos) const;
 	uint16_t u16(unsigned pos) const;
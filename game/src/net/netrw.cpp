@@ -2,6 +2,7 @@
 
 #include <except.hpp>
 #include <string>
+#include <utility>
 
 #include <climits>
 
@@ -9,8 +10,14 @@ namespace aoe {
 
 void NetPkg::chktype(NetPkgType type) {
 	ntoh();
+	std::as_const(*this).chktype(type);
+}
+
+void NetPkg::chktype(NetPkgType type) const {
+	NetPkgHdr h(hdr);
+	h.ntoh();
 
-	if ((NetPkgType)hdr.type == type)
+	if ((NetPkgType)h.type == type)
 		return;
 
 	switch (type) {
@@ -18,8 +25,18 @@ void NetPkg::chktype(NetPkgType type) {
 		throw std::runtime_error("not a protocol network packet");
 	case NetPkgType::entity_mod:
 		throw std::runtime_error("not an entity control packet");
+	case NetPkgType::entity_snapshot:
+		throw std::runtime_error("not an entity snapshot packet");
+	case NetPkgType::lockstep_frame:
+		throw std::runtime_error("not a lockstep frame packet");
+	case NetPkgType::state_hash:
+		throw std::runtime_error("not a state hash packet");
 	case NetPkgType::cam_set:
 		throw std::runtime_error("not a camera set packet");
+	case NetPkgType::particle_mod:
+		throw std::runtime_error("not a particle control packet");
+	case NetPkgType::gameticks:
+		throw std::runtime_error("not a gameticks packet");
 	case NetPkgType::set_username:
 		throw std::runtime_error("not a username packet");
 	case NetPkgType::chat_text:
@@ -49,24 +49,19 @@ void NetPkg::hton() {
 	hdr.hton();
 }
 
-void NetPkg::write(std::deque<uint8_t> &q) {
+void NetPkg::write(RingBuffer &q) {
 	hton();
 
 	static_assert(NetPkgHdr::size == 4);
 
-	union hdr {
-		uint16_t v[2];
-		uint8_t b[4];
-	} data;
+	uint16_t v[2];
 
-	data.v[0] = this->hdr.type;
-	data.v[1] = this->hdr.payload;
-
-	for (unsigned i = 0; i < NetPkgHdr::size; ++i)
-		q.emplace_back(data.b[i]);
+	v[0] = this->hdr.type;
+	v[1] = this->hdr.payload;
 
-	for (unsigned i = 0; i < this->data.size(); ++i)
-		q.emplace_back(this->data[i]);
+	q.reserve(NetPkgHdr::size + this->data.size());
+	q.push_back(v, NetPkgHdr::size);
+	q.push_back(this->data.data(), this->data.size());
 }
 
 void NetPkg::write(std::vector<uint8_t> &q) {
@@ -89,24 +84,17 @@ void NetPkg::write(std::vector<uint8_t> &q) {
 		q.emplace_back(this->data[i]);
 }
 
-NetPkg::NetPkg(std::deque<uint8_t> &q) : hdr(0, 0, false), data() {
+NetPkg::NetPkg(RingBuffer &q) : hdr(0, 0, false), data() {
 	if (q.size() < NetPkgHdr::size)
 		throw std::runtime_error("bad pkg hdr");
 
 	// read pkg hdr
-	union hdr {
-		uint16_t v[2];
-		uint8_t b[4];
-	} data;
+	uint16_t v[2];
 
-	static_assert(sizeof(data) == NetPkgHdr::size);
+	static_assert(sizeof(v) == NetPkgHdr::size);
+	q.peek(v, NetPkgHdr::size);
 
-	data.b[0] = q[0];
-	data.b[1] = q[1];
-	data.b[2] = q[2];
-	data.b[3] = q[3];
-
-	this->hdr = NetPkgHdr(data.v[0], data.v[1], false);
+	this->hdr = NetPkgHdr(v[0], v[1], false);
 	unsigned need = ntohs(this->hdr.payload);
 
 	if (q.size() < need + NetPkgHdr::size)
@@ -114,16 +102,13 @@ NetPkg::NetPkg(std::deque<uint8_t> &q) : hdr(0, 0, false), data() {
 
 	// read data
 	this->data.resize(need);
-
-	for (unsigned i = 0; i < need; ++i)
-		this->data[i] = q[i + NetPkgHdr::size];
+	q.peek(this->data.data(), need, NetPkgHdr::size);
 
 	// convert to native ordering
 	ntoh();
 
 	// all good, remove from q
-	for (unsigned i = 0; i < need + NetPkgHdr::size; ++i)
-		q.pop_front();
+	q.consume(need + NetPkgHdr::size);
 }
 
 void NetPkg::set_hdr(NetPkgType type) {
@@ -5,6 +5,9 @@
 
 namespace aoe {
 
+/** Sent by clients when they connect. Bump it whenever a packet layout changes. 2: entity updates no longer carry attack and maxhp. */
+static constexpr uint16_t net_protocol = 2;
+
 enum class NetPkgType {
 	set_protocol,
 	chat_text,
@@ -22,6 +25,9 @@ enum class NetPkgType {
 	particle_mod,
 	gamespeed_control,
 	client_info,
+	entity_snapshot,
+	lockstep_frame,
+	state_hash,
 };
 
 enum NetStartGameType {
@@ -61,6 +67,7 @@ enum class NetPlayerControlType {
 	set_civ,
 	set_team,
 	set_score,
+	set_type,
 };
 
 enum class NetPeerControlType {
@@ -166,11 +173,9 @@ public:
 	1 state
 	1 dx
 	1 dy
-	1 attack
 	2 hp
-	2 maxhp
 	*/
-	static constexpr size_t addsize = minsize + 2 + refsize + 2*4 + 3*2 + 4*1 + 2*2;
+	static constexpr size_t addsize = minsize + 2 + refsize + 2*4 + 3*2 + 3*1 + 1*2;
 	/*
 	2 minsize
 	2 type
@@ -184,6 +189,50 @@ public:
 	NetEntityMod(const EntityTask &t) : type(NetEntityControlType::task), data(t) {}
 };
 
+enum class NetEntityDeltaFlags {
+	full     = 1 << 0, // all fields are present
+	spawn    = 1 << 1, // only valid with full. make all sounds and particles needed for it
+	pos      = 1 << 2, // x, y and angle
+	state    = 1 << 3,
+	hp       = 1 << 4,
+	subimage = 1 << 5,
+	leave    = 1 << 6, // entity is no longer visible to the peer. no fields are present
+};
+
+/**
+ * Entity record in an entity snapshot. Unless flags has full set, only the
+ * fields indicated by flags are valid and the other fields have to be taken
+ * from the last EntityView the peer has received.
+ */
+class NetEntityDelta final {
+public:
+	unsigned flags;
+	EntityView ev;
+
+	/*
+	1 flags
+	2*4 ref
+	*/
+	static constexpr size_t minsize = 1 + refsize;
+	/* same as NetEntityMod::addsize except for the control type */
+	static constexpr size_t fullsize = minsize + 2 + 2*4 + 3*2 + 3*1 + 1*2;
+	/*
+	2*4 x,y
+	2*1 dx,dy
+	2 angle
+	*/
+	static constexpr size_t possize = 2*4 + 2*1 + 2;
+
+	NetEntityDelta(const EntityView &ev, unsigned flags) : flags(flags), ev(ev) {}
+
+	/** Determine what has to be sent if the peer has \a prev and should have \a next. Returns zero if nothing has changed. */
+	static unsigned diff(const EntityView &prev, const EntityView &next) noexcept;
+
+	size_t size() const noexcept;
+	/** Copy all fields indicated by flags to \a dst. */
+	void apply(EntityView &dst) const noexcept;
+};
+
 class NetParticleMod final {
 public:
 	Particle data;
@@ -219,4 +268,15 @@ public:
 	NetGamespeedControl(NetGamespeedType t, uint8_t speed) : type(t), speed(speed) {}
 };
 
+/** World state hash of a lockstep peer after it has ticked \a tick times. */
+class NetStateHash final {
+public:
+	uint32_t tick;
+	uint64_t hash;
+
+	static constexpr size_t size = 4 + 8;
+
+	NetStateHash(uint32_t tick, uint64_t hash) : tick(tick), hash(hash) {}
+};
+
 }
@@ -6,22 +6,24 @@
 
 namespace aoe {
 
+typedef NetSchema<&NetCamSet::x, &NetCamSet::y, &NetCamSet::w, &NetCamSet::h> NetCamSetSchema;
+
+static_assert(NetCamSetSchema::size == NetCamSet::size);
+
 void NetPkg::cam_set(float x, float y, float w, float h) {
 	ZoneScoped;
 	PkgWriter out(*this, NetPkgType::cam_set);
 	clear();
-	writef("4F", x, y, w, h);
+	put<NetCamSetSchema>(NetCamSet((int32_t)x, (int32_t)y, (int32_t)w, (int32_t)h));
 }
 
 NetCamSet NetPkg::get_cam_set() {
 	ZoneScoped;
-	read(NetPkgType::cam_set, "4F");
+	chktype(NetPkgType::cam_set);
 
 	NetCamSet s;
-	s.x = F32(0);
-	s.y = F32(1);
-	s.w = F32(2);
-	s.h = F32(3);
+	unsigned pos = 0;
+	get<NetCamSetSchema>(s, pos);
 
 	return s;
 }
@@ -3,8 +3,37 @@
 #include <cassert>
 #include <except.hpp>
 
+#include "entity_wire.hpp"
+
 namespace aoe {
 
+struct EntityCtlWire final {
+	uint16_t ctl, arg; // arg is the entity type or task type
+};
+
+struct EntityRefWire final {
+	uint32_t first, second;
+};
+
+struct EntityTaskWire final {
+	uint32_t ref1, ref2, a, b; // a, b is either x, y or another ref
+};
+
+struct EntityTrainWire final {
+	uint32_t ref1, ref2;
+	uint16_t type;
+};
+
+typedef NetSchema<&EntityCtlWire::ctl, &EntityCtlWire::arg> EntityCtlSchema;
+typedef NetSchema<&EntityCtlWire::ctl> EntityKillCtlSchema;
+typedef NetSchema<&EntityRefWire::first, &EntityRefWire::second> EntityRefSchema;
+typedef NetSchema<&EntityTaskWire::ref1, &EntityTaskWire::ref2, &EntityTaskWire::a, &EntityTaskWire::b> EntityTaskSchema;
+typedef NetSchema<&EntityTrainWire::ref1, &EntityTrainWire::ref2, &EntityTrainWire::type> EntityTrainSchema;
+
+static_assert(EntityCtlSchema::size + EntityRefSchema::size + EntityBodySchema::size == NetEntityMod::addsize);
+static_assert(EntityKillCtlSchema::size + EntityRefSchema::size == NetEntityMod::killsize);
+static_assert(EntityCtlSchema::size + EntityTaskSchema::size == NetEntityMod::tasksize);
+
 static void refcheck(const IdPoolRef &ref) {
 	if (ref == invalid_ref)
 		throw std::runtime_error("invalid ref");
@@ -33,19 +62,15 @@ void NetPkg::set_entity_update(const Entity &e) {
 }
 
 void NetPkg::entity_add(const EntityView &e, NetEntityControlType type) {
-	static_assert(sizeof(float) <= sizeof(uint32_t));
-
 	refcheck(e.ref);
 	PkgWriter out(*this, NetPkgType::entity_mod);
 
 	clear();
-	writef("2H2I2F", (uint16_t)type, (uint16_t)e.type,
-		e.ref.first, e.ref.second, e.x, e.y);
-	writef("HHHB", (uint16_t)(e.angle * UINT16_MAX / (2 * M_PI)),
-		e.playerid, e.subimage, (uint8_t)e.state);
-	writef("bbBHH",
-		(int8_t)(INT8_MAX * fmodf(e.x, 1)), (int8_t)(INT8_MAX * fmodf(e.y, 1)),
-		e.stats.attack, e.stats.hp, e.stats.maxhp);
+	data.reserve(NetEntityMod::addsize);
+
+	put<EntityCtlSchema>(EntityCtlWire{ (uint16_t)type, (uint16_t)e.type });
+	put<EntityRefSchema>(EntityRefWire{ e.ref.first, e.ref.second });
+	put<EntityBodySchema>(EntityBodyWire(e));
 }
 
 void NetPkg::set_entity_kill(IdPoolRef ref) {
@@ -54,7 +79,8 @@ void NetPkg::set_entity_kill(IdPoolRef ref) {
 	PkgWriter out(*this, NetPkgType::entity_mod);
 
 	clear();
-	writef("H2I", NetEntityControlType::kill, ref.first, ref.second);
+	put<EntityKillCtlSchema>(EntityCtlWire{ (uint16_t)NetEntityControlType::kill, 0 });
+	put<EntityRefSchema>(EntityRefWire{ ref.first, ref.second });
 }
 
 void NetPkg::entity_move(IdPoolRef ref, float x, float y) {
@@ -62,8 +88,8 @@ void NetPkg::entity_move(IdPoolRef ref, float x, float y) {
 	PkgWriter out(*this, NetPkgType::entity_mod);
 
 	clear();
-	writef("2H2I2F", NetEntityControlType::task, EntityTaskType::move,
-		ref.first, ref.second, x, y);
+	put<EntityCtlSchema>(EntityCtlWire{ (uint16_t)NetEntityControlType::task, (uint16_t)EntityTaskType::move });
+	put<EntityTaskSchema>(EntityTaskWire{ ref.first, ref.second, (uint32_t)(int32_t)x, (uint32_t)(int32_t)y });
 }
 
 void NetPkg::entity_task(IdPoolRef r1, IdPoolRef r2, EntityTaskType type) {
@@ -73,7 +99,8 @@ void NetPkg::entity_task(IdPoolRef r1, IdPoolRef r2, EntityTaskType type) {
 	PkgWriter out(*this, NetPkgType::entity_mod);
 
 	clear();
-	writef("2H4I", NetEntityControlType::task, type, r1.first, r1.second, r2.first, r2.second);
+	put<EntityCtlSchema>(EntityCtlWire{ (uint16_t)NetEntityControlType::task, (uint16_t)type });
+	put<EntityTaskSchema>(EntityTaskWire{ r1.first, r1.second, r2.first, r2.second });
 }
 
 void NetPkg::entity_train(IdPoolRef src, EntityType type) {
@@ -82,85 +109,68 @@ void NetPkg::entity_train(IdPoolRef src, EntityType type) {
 	PkgWriter out(*this, NetPkgType::entity_mod);
 
 	clear();
-	writef("2H2IH",
-		NetEntityControlType::task,
-		EntityTaskType::train_unit,
-		src.first, src.second, type); // TODO add more info to message when technologies are supported
+	put<EntityCtlSchema>(EntityCtlWire{ (uint16_t)NetEntityControlType::task, (uint16_t)EntityTaskType::train_unit });
+	put<EntityTrainSchema>(EntityTrainWire{ src.first, src.second, (uint16_t)type }); // TODO add more info to message when technologies are supported
 }
 
-NetEntityMod NetPkg::get_entity_mod() {
+NetEntityMod NetPkg::get_entity_mod() const {
 	ZoneScoped;
-	unsigned pos = read(NetPkgType::entity_mod, "H");
-	NetEntityControlType type = (NetEntityControlType)u16(0);
+	chktype(NetPkgType::entity_mod);
+
+	unsigned pos = 0;
+	EntityCtlWire ctl;
+	get<EntityKillCtlSchema>(ctl, pos);
+	NetEntityControlType type = (NetEntityControlType)ctl.ctl;
 
 	switch (type) {
 	case NetEntityControlType::add:
 	case NetEntityControlType::spawn:
 	case NetEntityControlType::update: {
-		EntityView ev;
-		args.clear();
-
-		pos += read("H2I2FHHHBbbBHH", args, pos);
-
-		ev.type = (EntityType)u16(0);
-		ev.ref.first = u32(1); ev.ref.second = u32(2);
-		ev.x = F32(3); ev.y = F32(4);
-
-		ev.angle = u16(5) * (2 * M_PI) / UINT16_MAX;
-		ev.playerid = u16(6);
-		ev.subimage = u16(7);
-
-		ev.state = (EntityState)u8(8);
-		int8_t dx = i8(9), dy = i8(10);
+		pos = 0;
+		get<EntityCtlSchema>(ctl, pos);
 
-		if (dx || dy) {
-			ev.x += dx / (float)INT8_MAX;
-			ev.y += dy / (float)INT8_MAX;
-		}
+		EntityRefWire ref;
+		EntityBodyWire body;
+		get<EntityRefSchema>(ref, pos);
+		get<EntityBodySchema>(body, pos);
 
-		ev.stats.attack = u8(11);
-		ev.stats.hp     = u16(12);
-		ev.stats.maxhp  = u16(13);
+		EntityView ev;
+		ev.type = (EntityType)ctl.arg;
+		ev.ref.first = ref.first; ev.ref.second = ref.second;
+		body.to_view(ev);
 
 		return NetEntityMod(ev, type);
 	}
 	case NetEntityControlType::kill: {
-		IdPoolRef ref;
-		args.clear();
-
-		pos += read("2I", args, pos);
-		ref.first  = u32(0);
-		ref.second = u32(1);
+		EntityRefWire ref;
+		get<EntityRefSchema>(ref, pos);
 
-		return NetEntityMod(ref);
+		return NetEntityMod(IdPoolRef(ref.first, ref.second));
 	}
 	case NetEntityControlType::task: {
-		args.clear();
-		pos += read("H", args, pos);
-		EntityTaskType type = (EntityTaskType)u16(0);
+		pos = 0;
+		get<EntityCtlSchema>(ctl, pos);
+		EntityTaskType type = (EntityTaskType)ctl.arg;
 
 		switch (type) {
 			case EntityTaskType::move: {
-				pos += read("4I", args, pos);
+				EntityTaskWire t;
+				get<EntityTaskSchema>(t, pos);
 
-				return NetEntityMod(EntityTask(IdPoolRef(u32(1), u32(2)), u32(3), u32(4)));
+				return NetEntityMod(EntityTask(IdPoolRef(t.ref1, t.ref2), t.a, t.b));
 			}
 			case EntityTaskType::attack:
 			case EntityTaskType::infer: {
-				pos += read("4I", args, pos);
+				EntityTaskWire t;
+				get<EntityTaskSchema>(t, pos);
 
-				return NetEntityMod(EntityTask(type, IdPoolRef(u32(1), u32(2)), IdPoolRef(u32(3), u32(4))));
+				return NetEntityMod(EntityTask(type, IdPoolRef(t.ref1, t.ref2), IdPoolRef(t.a, t.b)));
 			}
 			case EntityTaskType::train_unit: {
-				pos += read("2IH", args, pos);
-
-				IdPoolRef src;
-				src.first  = u32(1);
-				src.second = u32(2);
-
-				EntityType train = (EntityType)u16(3);
+				EntityTrainWire t;
+				get<EntityTrainSchema>(t, pos);
 
-				return NetEntityMod(EntityTask(src, train));
+				return NetEntityMod(EntityTask(IdPoolRef(t.ref1, t.ref2), (EntityType)t.type));
 			}
 			default:
 				break;
@@ -0,0 +1,236 @@
+#include "../../server.hpp"
+
+#include <cassert>
+#include <cmath>
+#include <except.hpp>
+
+#include "entity_wire.hpp"
+
+namespace aoe {
+
+// compare positions as they are sent over the wire, so jitter we can't send anyway doesn't mark the entity as changed
+static int32_t pos_hi(float v) {
+	return (int32_t)v;
+}
+
+static int8_t pos_lo(float v) {
+	return (int8_t)(INT8_MAX * fmodf(v, 1));
+}
+
+static uint16_t angle16(float angle) {
+	return (uint16_t)(angle * UINT16_MAX / (2 * M_PI));
+}
+
+unsigned NetEntityDelta::diff(const EntityView &prev, const EntityView &next) noexcept {
+	// anything that isn't covered by the delta flags requires a full update
+	if (prev.type != next.type || prev.playerid != next.playerid)
+		return (unsigned)NetEntityDeltaFlags::full;
+
+	unsigned flags = 0;
+
+	if (pos_hi(prev.x) != pos_hi(next.x) || pos_lo(prev.x) != pos_lo(next.x)
+		|| pos_hi(prev.y) != pos_hi(next.y) || pos_lo(prev.y) != pos_lo(next.y)
+		|| angle16(prev.angle) != angle16(next.angle))
+	{
+		flags |= (unsigned)NetEntityDeltaFlags::pos;
+	}
+
+	if (prev.state != next.state)
+		flags |= (unsigned)NetEntityDeltaFlags::state;
+
+	if (prev.hp != next.hp)
+		flags |= (unsigned)NetEntityDeltaFlags::hp;
+
+	if (prev.subimage != next.subimage)
+		flags |= (unsigned)NetEntityDeltaFlags::subimage;
+
+	return flags;
+}
+
+size_t NetEntityDelta::size() const noexcept {
+	if (flags & (unsigned)NetEntityDeltaFlags::full)
+		return fullsize;
+
+	if (flags & (unsigned)NetEntityDeltaFlags::leave)
+		return minsize;
+
+	size_t n = minsize;
+
+	if (flags & (unsigned)NetEntityDeltaFlags::pos)
+		n += possize;
+	if (flags & (unsigned)NetEntityDeltaFlags::state)
+		n += 1;
+	if (flags & (unsigned)NetEntityDeltaFlags::hp)
+		n += 2;
+	if (flags & (unsigned)NetEntityDeltaFlags::subimage)
+		n += 2;
+
+	return n;
+}
+
+void NetEntityDelta::apply(EntityView &dst) const noexcept {
+	if (flags & (unsigned)NetEntityDeltaFlags::full) {
+		dst = ev;
+		return;
+	}
+
+	if (flags & (unsigned)NetEntityDeltaFlags::pos) {
+		dst.x = ev.x;
+		dst.y = ev.y;
+		dst.angle = ev.angle;
+	}
+
+	if (flags & (unsigned)NetEntityDeltaFlags::state)
+		dst.state = ev.state;
+
+	if (flags & (unsigned)NetEntityDeltaFlags::hp)
+		dst.hp = ev.hp;
+
+	if (flags & (unsigned)NetEntityDeltaFlags::subimage)
+		dst.subimage = ev.subimage;
+}
+
+struct SnapshotRecordWire final {
+	uint8_t flags;
+	uint32_t ref1, ref2;
+};
+
+struct SnapshotPosWire final {
+	int32_t x, y;
+	int8_t dx, dy;
+	uint16_t angle;
+};
+
+struct SnapshotFieldWire final {
+	uint8_t state;
+	uint16_t hp, subimage, type;
+};
+
+typedef NetSchema<&SnapshotRecordWire::flags, &SnapshotRecordWire::ref1, &SnapshotRecordWire::ref2> SnapshotRecordSchema;
+typedef NetSchema<&SnapshotPosWire::x, &SnapshotPosWire::y, &SnapshotPosWire::dx, &SnapshotPosWire::dy, &SnapshotPosWire::angle> SnapshotPosSchema;
+typedef NetSchema<&SnapshotFieldWire::state> SnapshotStateSchema;
+typedef NetSchema<&SnapshotFieldWire::hp> SnapshotHpSchema;
+typedef NetSchema<&SnapshotFieldWire::subimage> SnapshotSubimageSchema;
+typedef NetSchema<&SnapshotFieldWire::type> SnapshotTypeSchema;
+
+static_assert(SnapshotRecordSchema::size == NetEntityDelta::minsize);
+static_assert(SnapshotRecordSchema::size + SnapshotTypeSchema::size + EntityBodySchema::size == NetEntityDelta::fullsize);
+static_assert(SnapshotPosSchema::size == NetEntityDelta::possize);
+
+size_t NetPkg::set_entity_snapshot(const std::vector<NetEntityDelta> &lst, size_t offset) {
+	ZoneScoped;
+	PkgWriter out(*this, NetPkgType::entity_snapshot);
+
+	clear();
+
+	size_t count = 0, payload = sizeof(uint16_t);
+
+	for (size_t i = offset; i < lst.size() && count < UINT16_MAX; ++i, ++count) {
+		size_t n = lst[i].size();
+		if (payload + n > max_payload)
+			break;
+
+		payload += n;
+	}
+
+	data.reserve(payload);
+	writef("H", (uint16_t)count);
+
+	for (size_t i = offset; i < offset + count; ++i) {
+		const NetEntityDelta &d = lst[i];
+		const EntityView &e = d.ev;
+
+		put<SnapshotRecordSchema>(SnapshotRecordWire{ (uint8_t)d.flags, e.ref.first, e.ref.second });
+
+		if (d.flags & (unsigned)NetEntityDeltaFlags::leave)
+			continue;
+
+		if (d.flags & (unsigned)NetEntityDeltaFlags::full) {
+			put<SnapshotTypeSchema>(SnapshotFieldWire{ 0, 0, 0, (uint16_t)e.type });
+			put<EntityBodySchema>(EntityBodyWire(e));
+			continue;
+		}
+
+		if (d.flags & (unsigned)NetEntityDeltaFlags::pos)
+			put<SnapshotPosSchema>(SnapshotPosWire{ pos_hi(e.x), pos_hi(e.y), pos_lo(e.x), pos_lo(e.y), angle16(e.angle) });
+
+		if (d.flags & (unsigned)NetEntityDeltaFlags::state)
+			put<SnapshotStateSchema>(SnapshotFieldWire{ (uint8_t)e.state, 0, 0, 0 });
+
+		if (d.flags & (unsigned)NetEntityDeltaFlags::hp)
+			put<SnapshotHpSchema>(SnapshotFieldWire{ 0, (uint16_t)e.hp, 0, 0 });
+
+		if (d.flags & (unsigned)NetEntityDeltaFlags::subimage)
+			put<SnapshotSubimageSchema>(SnapshotFieldWire{ 0, 0, (uint16_t)e.subimage, 0 });
+	}
+
+	return count;
+}
+
+std::vector<NetEntityDelta> NetPkg::get_entity_snapshot() {
+	ZoneScoped;
+	unsigned pos = read(NetPkgType::entity_snapshot, "H");
+	unsigned count = u16(0);
+
+	std::vector<NetEntityDelta> lst;
+	lst.reserve(count);
+
+	for (unsigned i = 0; i < count; ++i) {
+		EntityView ev;
+		SnapshotRecordWire rec;
+		SnapshotFieldWire f;
+
+		get<SnapshotRecordSchema>(rec, pos);
+
+		unsigned flags = rec.flags;
+		ev.ref.first = rec.ref1; ev.ref.second = rec.ref2;
+
+		if (flags & (unsigned)NetEntityDeltaFlags::leave) {
+			lst.emplace_back(ev, flags);
+			continue;
+		}
+
+		if (flags & (unsigned)NetEntityDeltaFlags::full) {
+			EntityBodyWire body;
+
+			get<SnapshotTypeSchema>(f, pos);
+			get<EntityBodySchema>(body, pos);
+
+			ev.type = (EntityType)f.type;
+			body.to_view(ev);
+
+			lst.emplace_back(ev, flags);
+			continue;
+		}
+
+		if (flags & (unsigned)NetEntityDeltaFlags::pos) {
+			SnapshotPosWire p;
+			get<SnapshotPosSchema>(p, pos);
+
+			ev.x = p.x + p.dx / (float)INT8_MAX;
+			ev.y = p.y + p.dy / (float)INT8_MAX;
+			ev.angle = p.angle * (2 * M_PI) / UINT16_MAX;
+		}
+
+		if (flags & (unsigned)NetEntityDeltaFlags::state) {
+			get<SnapshotStateSchema>(f, pos);
+			ev.state = (EntityState)f.state;
+		}
+
+		if (flags & (unsigned)NetEntityDeltaFlags::hp) {
+			get<SnapshotHpSchema>(f, pos);
+			ev.hp = f.hp;
+		}
+
+		if (flags & (unsigned)NetEntityDeltaFlags::subimage) {
+			get<SnapshotSubimageSchema>(f, pos);
+			ev.subimage = f.subimage;
+		}
+
+		lst.emplace_back(ev, flags);
+	}
+
+	return lst;
+}
+
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "../schema.hpp"
+
+#include <cmath>
+
+namespace aoe {
+
+/**
+ * Wire format for all EntityView fields except type and ref. Used by entity_mod and entity_snapshot.
+ * Everything that follows from the type, like maxhp and attack, is looked up in entity_info by the peer.
+ */
+struct EntityBodyWire final {
+	int32_t x, y;
+	uint16_t angle, playerid, subimage;
+	uint8_t state;
+	int8_t dx, dy; // fractional part of x, y
+	uint16_t hp;
+
+	EntityBodyWire() = default;
+
+	EntityBodyWire(const EntityView &e)
+		: x((int32_t)e.x), y((int32_t)e.y)
+		, angle((uint16_t)(e.angle * UINT16_MAX / (2 * M_PI))), playerid(e.playerid), subimage(e.subimage)
+		, state((uint8_t)e.state)
+		, dx((int8_t)(INT8_MAX * fmodf(e.x, 1))), dy((int8_t)(INT8_MAX * fmodf(e.y, 1)))
+		, hp(e.hp) {}
+
+	void to_view(EntityView &ev) const noexcept {
+		ev.x = x + dx / (float)INT8_MAX;
+		ev.y = y + dy / (float)INT8_MAX;
+
+		ev.angle = angle * (2 * M_PI) / UINT16_MAX;
+		ev.playerid = playerid;
+		ev.subimage = subimage;
+		ev.state = (EntityState)state;
+		ev.hp = hp;
+	}
+};
+
+typedef NetSchema<
+	&EntityBodyWire::x, &EntityBodyWire::y,
+	&EntityBodyWire::angle, &EntityBodyWire::playerid, &EntityBodyWire::subimage,
+	&EntityBodyWire::state, &EntityBodyWire::dx, &EntityBodyWire::dy,
+	&EntityBodyWire::hp
+> EntityBodySchema;
+
+static_assert(EntityBodySchema::size == 2*4 + 3*2 + 3*1 + 1*2);
+
+}
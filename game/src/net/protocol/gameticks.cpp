@@ -6,17 +6,21 @@
 
 namespace aoe {
 
+struct GameticksWire final {
+	uint16_t n;
+};
+
+typedef NetSchema<&GameticksWire::n> GameticksSchema;
+
 uint16_t NetPkg::get_gameticks() {
 	ZoneScoped;
-	ntoh();
-
-	if ((NetPkgType)hdr.type != NetPkgType::gameticks)
-		throw std::runtime_error("not a gameticks packet");
+	chktype(NetPkgType::gameticks);
 
-	args.clear();
-	read("H", args);
+	GameticksWire w;
+	unsigned pos = 0;
+	get<GameticksSchema>(w, pos);
 
-	return u16(0);
+	return w.n;
 }
 
 void NetPkg::set_gameticks(unsigned n) {
@@ -25,7 +29,7 @@ void NetPkg::set_gameticks(unsigned n) {
 
 	PkgWriter out(*this, NetPkgType::gameticks);
 	clear();
-	writef("H", n);
+	put<GameticksSchema>(GameticksWire{ (uint16_t)n });
 }
 
 }
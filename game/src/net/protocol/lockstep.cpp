@@ -0,0 +1,153 @@
+#include "../../server.hpp"
+
+#include <cassert>
+#include <except.hpp>
+
+namespace aoe {
+
+struct LockstepFrameWire final {
+	uint32_t tick;
+	uint16_t steps, count;
+};
+
+struct LockstepInputWire final {
+	uint8_t type, task; // WorldEventType and EntityTaskType
+	uint32_t src1, src2, ref1, ref2, a, b; // a, b is either x, y or another ref
+	uint16_t info_type, info_value;
+};
+
+struct StateHashWire final {
+	uint32_t tick;
+	uint64_t hash;
+};
+
+typedef NetSchema<&LockstepFrameWire::tick, &LockstepFrameWire::steps, &LockstepFrameWire::count> LockstepFrameSchema;
+typedef NetSchema<
+	&LockstepInputWire::type, &LockstepInputWire::task,
+	&LockstepInputWire::src1, &LockstepInputWire::src2, &LockstepInputWire::ref1, &LockstepInputWire::ref2,
+	&LockstepInputWire::a, &LockstepInputWire::b,
+	&LockstepInputWire::info_type, &LockstepInputWire::info_value
+> LockstepInputSchema;
+typedef NetSchema<&StateHashWire::tick, &StateHashWire::hash> StateHashSchema;
+
+static_assert(StateHashSchema::size == NetStateHash::size);
+
+static LockstepInputWire input_wire(const WorldEvent &ev) {
+	LockstepInputWire w{ (uint8_t)ev.type, 0, ev.src.first, ev.src.second, 0, 0, 0, 0, 0, 0 };
+
+	switch (ev.type) {
+	case WorldEventType::entity_kill: {
+		IdPoolRef ref = std::get<IdPoolRef>(ev.data);
+		w.ref1 = ref.first; w.ref2 = ref.second;
+		break;
+	}
+	case WorldEventType::entity_task: {
+		const EntityTask &t = std::get<EntityTask>(ev.data);
+
+		w.task = (uint8_t)t.type;
+		w.ref1 = t.ref1.first; w.ref2 = t.ref1.second;
+
+		if (t.type == EntityTaskType::move) {
+			w.a = t.x; w.b = t.y;
+		} else {
+			w.a = t.ref2.first; w.b = t.ref2.second;
+		}
+
+		w.info_type = t.info_type; w.info_value = t.info_value;
+		break;
+	}
+	default:
+		throw std::runtime_error("bad lockstep input type");
+	}
+
+	return w;
+}
+
+static WorldEvent input_event(const LockstepInputWire &w) {
+	IdPoolRef src(w.src1, w.src2), ref(w.ref1, w.ref2);
+
+	switch ((WorldEventType)w.type) {
+	case WorldEventType::entity_kill:
+		return WorldEvent(src, WorldEventType::entity_kill, ref);
+	case WorldEventType::entity_task: {
+		if (w.task > (uint8_t)EntityTaskType::train_unit)
+			throw std::runtime_error("bad lockstep entity task type");
+
+		EntityTask t((EntityTaskType)w.task, ref, invalid_ref);
+
+		if (t.type == EntityTaskType::move) {
+			t.x = w.a; t.y = w.b;
+		} else {
+			t.ref2 = IdPoolRef(w.a, w.b);
+		}
+
+		t.info_type = w.info_type; t.info_value = w.info_value;
+
+		return WorldEvent(src, WorldEventType::entity_task, t);
+	}
+	default:
+		throw std::runtime_error("bad lockstep input type");
+	}
+}
+
+size_t NetPkg::set_lockstep_frame(uint32_t tick, unsigned steps, const std::vector<WorldEvent> &inputs, size_t offset) {
+	ZoneScoped;
+	assert(steps <= UINT16_MAX);
+	PkgWriter out(*this, NetPkgType::lockstep_frame);
+
+	clear();
+
+	size_t count = std::min(inputs.size() - offset, (max_payload - LockstepFrameSchema::size) / LockstepInputSchema::size);
+
+	// only the last part of a frame may advance the world
+	if (offset + count != inputs.size())
+		steps = 0;
+
+	data.reserve(LockstepFrameSchema::size + count * LockstepInputSchema::size);
+	put<LockstepFrameSchema>(LockstepFrameWire{ tick, (uint16_t)steps, (uint16_t)count });
+
+	for (size_t i = offset; i < offset + count; ++i)
+		put<LockstepInputSchema>(input_wire(inputs[i]));
+
+	return count;
+}
+
+LockstepFrame NetPkg::get_lockstep_frame() {
+	ZoneScoped;
+	chktype(NetPkgType::lockstep_frame);
+
+	unsigned pos = 0;
+	LockstepFrameWire fw;
+	get<LockstepFrameSchema>(fw, pos);
+
+	LockstepFrame f(fw.tick, fw.steps);
+	f.inputs.reserve(fw.count);
+
+	for (unsigned i = 0; i < fw.count; ++i) {
+		LockstepInputWire w;
+		get<LockstepInputSchema>(w, pos);
+		f.inputs.emplace_back(input_event(w));
+	}
+
+	return f;
+}
+
+void NetPkg::set_state_hash(const NetStateHash &h) {
+	ZoneScoped;
+	PkgWriter out(*this, NetPkgType::state_hash);
+	clear();
+	put<StateHashSchema>(StateHashWire{ h.tick, h.hash });
+}
+
+NetStateHash NetPkg::get_state_hash() {
+	ZoneScoped;
+	chktype(NetPkgType::state_hash);
+
+	unsigned pos = 0;
+	StateHashWire w;
+	get<StateHashSchema>(w, pos);
+
+	return NetStateHash(w.tick, w.hash);
+}
+
+}
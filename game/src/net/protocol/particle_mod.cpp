@@ -9,38 +9,40 @@
 
 namespace aoe {
 
+struct ParticleWire final {
+	uint32_t ref1, ref2;
+	uint16_t type, subimage;
+	int32_t x, y;
+	int8_t dx, dy; // fractional part of x, y
+};
+
+typedef NetSchema<
+	&ParticleWire::ref1, &ParticleWire::ref2, &ParticleWire::type, &ParticleWire::subimage,
+	&ParticleWire::x, &ParticleWire::y, &ParticleWire::dx, &ParticleWire::dy
+> ParticleSchema;
+
 void NetPkg::particle_spawn(const Particle &p) {
 	PkgWriter out(*this, NetPkgType::particle_mod);
 
 	clear();
-	writef("2IHF", p.ref.first, p.ref.second, p.type, p.subimage);
-	writef("2F2b", p.x, p.y,
-		(int8_t)(INT8_MAX * fmodf(p.x, 1)), (int8_t)(INT8_MAX * fmodf(p.y, 1)));
+	put<ParticleSchema>(ParticleWire{
+		p.ref.first, p.ref.second, (uint16_t)p.type, (uint16_t)p.subimage,
+		(int32_t)p.x, (int32_t)p.y,
+		(int8_t)(INT8_MAX * fmodf(p.x, 1)), (int8_t)(INT8_MAX * fmodf(p.y, 1))
+	});
 }
 
 Particle NetPkg::get_particle() {
-	ntoh();
-
-	if ((NetPkgType)hdr.type != NetPkgType::particle_mod)
-		throw std::runtime_error("not a particle control packet");
+	chktype(NetPkgType::particle_mod);
 
-	args.clear();
+	ParticleWire w;
 	unsigned pos = 0;
+	get<ParticleSchema>(w, pos);
 
-	pos += read("2I2H2I2b", args, pos);
-
-	IdPoolRef ref;
-	ref.first = u32(0); ref.second = u32(1);
-	unsigned type = u16(2), subimage = u16(3);
-	float x = u32(4), y = u32(5);
-	int8_t sx = i8(6), sy = i8(7);
-
-	if (sx || sy) {
-		x += sx / (float)INT8_MAX;
-		y += sy / (float)INT8_MAX;
-	}
+	IdPoolRef ref(w.ref1, w.ref2);
+	float x = w.x + w.dx / (float)INT8_MAX, y = w.y + w.dy / (float)INT8_MAX;
 
-	return Particle(ref, (ParticleType)type, x, y, subimage);
+	return Particle(ref, (ParticleType)w.type, x, y, w.subimage);
 }
 
 }
@@ -68,6 +68,7 @@ NetPlayerControl NetPkg::get_player_control() {
 			return NetPlayerControl(type, u16(1), str(2));
 		case NetPlayerControlType::set_civ:
 		case NetPlayerControlType::set_team:
+		case NetPlayerControlType::set_type:
 			pos += read("2H", args, pos);
 			return NetPlayerControl(type, u16(1), u16(2));
 		case NetPlayerControlType::set_score: {
@@ -104,6 +105,10 @@ void NetPkg::set_player_team(uint16_t idx, uint16_t team) {
 	playermod2(NetPlayerControlType::set_team, idx, team);
 }
 
+void NetPkg::set_player_type(uint16_t idx, PlayerType type) {
+	playermod2(NetPlayerControlType::set_type, idx, (uint16_t)type);
+}
+
 void NetPkg::set_player_name(uint16_t idx, const std::string &s) {
 	PkgWriter out(*this, NetPkgType::playermod);
 	clear();
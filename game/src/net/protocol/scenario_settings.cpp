@@ -16,6 +16,7 @@ void NetPkg::set_scn_vars(const ScenarioSettings &scn) {
 	if (scn.square          ) flags |= 1 << 4;
 	if (scn.wrap            ) flags |= 1 << 5;
 	if (scn.restricted      ) flags |= 1 << 6;
+	if (scn.lockstep        ) flags |= 1 << 7;
 
 	clear();
 	writef("3Ii2I", scn.width, scn.height, scn.popcap, scn.age, scn.seed, scn.villagers);
@@ -41,6 +42,7 @@ ScenarioSettings NetPkg::get_scn_vars() {
 	scn.square           = !!(flags & (1 << 4));
 	scn.wrap             = !!(flags & (1 << 5));
 	scn.restricted       = !!(flags & (1 << 6));
+	scn.lockstep         = !!(flags & (1 << 7));
 
 	return scn;
 }
@@ -5,52 +5,84 @@
 
 #include "../../debug.hpp"
 
+// the implementation is included by legacy/scenario.cpp
+#define MINIZ_HEADER_FILE_ONLY
+#include <miniz.c>
+
 namespace aoe {
 
+typedef NetSchema<&NetTerrainMod::x, &NetTerrainMod::y, &NetTerrainMod::w, &NetTerrainMod::h> NetTerrainModSchema;
+
+static_assert(NetTerrainModSchema::size == NetTerrainMod::possize);
+
+/*
+ * Tiles and heights are deflated, as most of a chunk is usually the same tile at the same height.
+ * The uncompressed size has to fit in a packet as well, so a peer cannot make us allocate a lot.
+ */
+
 void NetPkg::set_terrain_mod(const NetTerrainMod &tm) {
 	ZoneScoped;
 	assert(tm.tiles.size() == tm.hmap.size());
-	size_t tsize = tm.w * tm.h * 2;
+	size_t tsize = tm.w * tm.h * (sizeof(uint16_t) + sizeof(uint8_t));
 
 	if (tsize > max_payload - NetTerrainMod::possize)
 		throw std::runtime_error("terrain mod too big");
 
-	PkgWriter out(*this, NetPkgType::terrainmod);
-	clear();
-	writef("4H", tm.x, tm.y, tm.w, tm.h);
+	std::vector<uint8_t> raw(tsize);
+	uint8_t *dst = raw.data();
 
-	// TODO implement write(int ch, vector)
 	for (uint16_t v : tm.tiles)
-		writef("H", v);
+		net_put(dst, v);
 
 	for (uint8_t h : tm.hmap)
-		writef("B", h);
+		net_put(dst, h);
+
+	PkgWriter out(*this, NetPkgType::terrainmod);
+	clear();
+	put<NetTerrainModSchema>(tm);
+
+	size_t n = data.size();
+	mz_ulong csize = mz_compressBound((mz_ulong)tsize);
+	data.resize(n + csize);
+
+	if (mz_compress2(data.data() + n, &csize, raw.data(), (mz_ulong)tsize, MZ_BEST_SPEED) != MZ_OK)
+		throw std::runtime_error("cannot compress terrain");
+
+	data.resize(n + csize);
+
+	if (data.size() > max_payload)
+		throw std::runtime_error("terrain mod too big");
 }
 
 NetTerrainMod NetPkg::get_terrain_mod() {
 	ZoneScoped;
-	unsigned pos = read(NetPkgType::terrainmod, "4H");
+	chktype(NetPkgType::terrainmod);
+
 	NetTerrainMod tm;
+	unsigned pos = 0;
+	get<NetTerrainModSchema>(tm, pos);
+
+	size_t size = tm.w * tm.h, tsize = size * (sizeof(uint16_t) + sizeof(uint8_t));
+
+	if (tsize > max_payload - NetTerrainMod::possize)
+		throw std::runtime_error("corrupt data");
+
+	std::vector<uint8_t> raw(tsize);
+	mz_ulong len = (mz_ulong)tsize;
 
-	tm.x = u16(0); tm.y = u16(1);
-	tm.w = u16(2); tm.h = u16(3);
+	if (mz_uncompress(raw.data(), &len, data.data() + pos, (mz_ulong)(data.size() - pos)) != MZ_OK || len != tsize)
+		throw std::runtime_error("corrupt data");
 
-	size_t size = tm.w * tm.h;
+	const uint8_t *src = raw.data();
 
-	tm.tiles.clear();
-	tm.hmap.clear();
+	tm.tiles.resize(size);
+	tm.hmap.resize(size);
 
-	for (size_t i = 0; i < size; ++i) {
-		args.clear();
-		pos += read("H", args, pos);
-		tm.tiles.emplace_back(u16(0));
-	}
+	for (size_t i = 0; i < size; ++i)
+		tm.tiles[i] = net_get<uint16_t>(src);
 
-	for (size_t i = 0; i < size; ++i) {
-		args.clear();
-		pos += read("B", args, pos);
-		tm.hmap.emplace_back(u8(0));
-	}
+	for (size_t i = 0; i < size; ++i)
+		tm.hmap[i] = net_get<uint8_t>(src);
 
 	return tm;
 }
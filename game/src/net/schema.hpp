@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+namespace aoe {
+
+/** Store \a v big endian at \a dst and advance \a dst. */
+template<typename T> static inline void net_put(uint8_t *&dst, T v) noexcept {
+	static_assert(std::is_integral_v<T>);
+	typedef std::make_unsigned_t<T> U;
+	U u = (U)v;
+
+	for (size_t i = sizeof(T); i-- > 0;)
+		*dst++ = (uint8_t)(u >> (8 * i));
+}
+
+/** Load big endian value at \a src and advance \a src. */
+template<typename T> static inline T net_get(const uint8_t *&src) noexcept {
+	static_assert(std::is_integral_v<T>);
+	typedef std::make_unsigned_t<T> U;
+	U u = 0;
+
+	for (size_t i = 0; i < sizeof(T); ++i)
+		u = (U)(u << 8 | *src++);
+
+	return (T)u;
+}
+
+template<typename C, typename T> constexpr size_t net_member_size(T C::*) noexcept { return sizeof(T); }
+
+/**
+ * Fixed size packet layout known at compile time. Fields are written in the
+ * order of the member pointers \a M, big endian just like NetPkg::writef.
+ * E.g.: typedef NetSchema<&Foo::a, &Foo::b> FooSchema;
+ */
+template<auto... M> class NetSchema final {
+	template<typename C, typename T> static T member_type(T C::*);
+public:
+	static constexpr size_t size = (net_member_size(M) + ...);
+
+	template<typename C> static void write(uint8_t *dst, const C &v) noexcept {
+		(net_put(dst, v.*M), ...);
+	}
+
+	template<typename C> static void read(const uint8_t *src, C &v) noexcept {
+		((v.*M = net_get<decltype(member_type(M))>(src)), ...);
+	}
+};
+
+}
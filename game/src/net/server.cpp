@@ -6,7 +6,11 @@ namespace aoe {
 
 const Peer *Server::try_peer(IdPoolRef ref) {
 	std::lock_guard<std::mutex> lk(m_peers);
-	Peer p(refs.at(ref).sock, "", "", false);
+	SocketRef *sr = refs.try_get(ref);
+	if (!sr)
+		return nullptr;
+
+	Peer p(sr->sock, "", "", false);
 
 	auto it = peers.find(p);
 	if (it == peers.end())
@@ -20,7 +24,7 @@ ClientInfo &Server::get_ci(IdPoolRef ref) {
 	return peers.at(p);
 }
 
-bool Server::process(const Peer &p, NetPkg &pkg, std::deque<uint8_t> &out) {
+bool Server::process(const Peer &p, NetPkg &pkg, RingBuffer &out) {
 	pkg.ntoh();
 
 	// TODO for broadcasts, check packet on bogus data if reusing pkg
@@ -58,6 +62,9 @@ bool Server::process(const Peer &p, NetPkg &pkg, std::deque<uint8_t> &out) {
 			gamespeed_control(p, spd);
 			break;
 		}
+		case NetPkgType::state_hash:
+			w.add_event(peer2ref(p), WorldEventType::state_hash, pkg.get_state_hash());
+			break;
 		default:
 			fprintf(stderr, "bad type: %u\n", (unsigned)pkg.type());
 			throw "invalid type";
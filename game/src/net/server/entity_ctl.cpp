@@ -4,7 +4,7 @@
 
 namespace aoe {
 
-bool Server::process_entity_mod(const Peer &p, NetEntityMod &em, std::deque<uint8_t> &out) {
+bool Server::process_entity_mod(const Peer &p, NetEntityMod &em, RingBuffer &out) {
 	NetPkg pkg;
 
 	if (!m_running)
@@ -4,7 +4,7 @@
 
 namespace aoe {
 
-bool Server::process_playermod(const Peer &p, NetPlayerControl &ctl, std::deque<uint8_t> &out) {
+bool Server::process_playermod(const Peer &p, NetPlayerControl &ctl, RingBuffer &out) {
 	NetPkg pkg;
 
 	if (m_running) {
@@ -111,7 +111,7 @@ void Server::stopped() {
 	peers.clear();
 }
 
-int Server::proper_packet(ServerSocket &s, const std::deque<uint8_t> &q) {
+int Server::proper_packet(ServerSocket &s, const RingBuffer &q) {
 	if (q.size() < NetPkgHdr::size)
 		return 0;
 
@@ -159,7 +159,7 @@ void Server::send(const Peer &p, NetPkg &pkg) {
 	s.send(p, v.data(), v.size());
 }
 
-bool Server::chk_protocol(const Peer &p, std::deque<uint8_t> &out, NetPkg &in) {
+bool Server::chk_protocol(const Peer &p, RingBuffer &out, NetPkg &in) {
 	uint16_t req = in.protocol_version();
 	printf("%s: (%s,%s) requests protocol %u. answer protocol %u\n", __func__, p.host.c_str(), p.server.c_str(), req, protocol);
 
@@ -170,7 +170,7 @@ bool Server::chk_protocol(const Peer &p, std::deque<uint8_t> &out, NetPkg &in) {
 	return true;
 }
 
-void Server::change_username(const Peer &p, std::deque<uint8_t> &out, const std::string &name) {
+void Server::change_username(const Peer &p, RingBuffer &out, const std::string &name) {
 	auto it = peers.find(p);
 	assert(it != peers.end());
 
@@ -183,7 +183,7 @@ void Server::change_username(const Peer &p, std::deque<uint8_t> &out, const std:
 	broadcast(pkg, p);
 }
 
-bool Server::chk_username(const Peer &p, std::deque<uint8_t> &out, const std::string &name) {
+bool Server::chk_username(const Peer &p, RingBuffer &out, const std::string &name) {
 	std::lock_guard<std::mutex> lk(m_peers);
 
 	auto it = peers.find(p);
@@ -248,7 +248,12 @@ bool Server::set_scn_vars(const Peer &p, ScenarioSettings &scn) {
 	return true;
 }
 
-bool Server::process_packet(ServerSocket &s, const Peer &p, std::deque<uint8_t> &in, std::deque<uint8_t> &out, int processed) {
+/** Anything may end up in the world's event queue, so stop reading from peers while it is full. */
+bool Server::can_process(ServerSocket&, const Peer&) {
+	return w.events_ready();
+}
+
+bool Server::process_packet(ServerSocket &s, const Peer &p, RingBuffer &in, RingBuffer &out, int processed) {
 	NetPkg pkg(in);
 	return process(p, pkg, out);
 }
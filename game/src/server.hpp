@@ -6,8 +6,11 @@
 
 #include "../net/net.hpp"
 
+#include <atomic>
 #include <mutex>
 #include <deque>
+#include <fstream>
+#include <memory>
 #include <vector>
 #include <cstdint>
 #include <thread>
@@ -19,6 +22,7 @@
 #include "debug.hpp"
 
 #include <idpool.hpp>
+#include <mpsc.hpp>
 
 #if _WIN32
 #include <wepoll.h>
@@ -54,52 +58,202 @@ class WorldEvent final {
 public:
 	IdPoolRef src; /** ref to peer that created this event. invalid_ref if from the server itself. */
 	WorldEventType type;
-	std::variant<std::nullopt_t, IdPoolRef, Entity, EventCameraMove, EntityTask, NetGamespeedControl> data;
+	std::variant<std::nullopt_t, IdPoolRef, Entity, EventCameraMove, EntityTask, NetGamespeedControl, NetStateHash> data;
 
 	template<class... Args> WorldEvent(IdPoolRef src, WorldEventType type, Args&&... data) : src(src), type(type), data(data...) {}
 };
 
+/** Inputs every lockstep peer has to apply before tick \a tick. Afterwards, they have to tick \a steps times. */
+class LockstepFrame final {
+public:
+	uint32_t tick;
+	uint16_t steps;
+	std::vector<WorldEvent> inputs; // entity kills and tasks in the order the server has applied them
+
+	LockstepFrame(uint32_t tick, uint16_t steps) : tick(tick), steps(steps), inputs() {}
+};
+
+/**
+ * Recorded game: the final scenario settings and every input in the order the server has applied them.
+ * Feeding the frames to a World created by World::start_lockstep plays the game again.
+ */
+class Replay final {
+public:
+	ScenarioSettings scn;
+	std::vector<LockstepFrame> frames;
+	std::vector<NetStateHash> hashes; // state hash of the server every World::hash_interval ticks
+
+	Replay() : scn(), frames(), hashes() {}
+
+	/** Load replay from \a path. A truncated file is accepted up to the last complete record. */
+	void load(const std::string &path);
+};
+
+/** Writes the replay of a running game. Frames without inputs are merged to keep the file small. */
+class ReplayWriter final {
+	std::ofstream out;
+	std::vector<uint8_t> buf;
+	LockstepFrame pending;
+public:
+	static constexpr uint32_t magic = 0x52454f41; // "AOER"
+	static constexpr uint32_t version = 1;
+
+	ReplayWriter(const std::string &path, const ScenarioSettings &scn);
+	~ReplayWriter();
+
+	void frame(uint32_t tick, unsigned steps, const std::vector<WorldEvent> &inputs);
+	void hash(uint32_t tick, uint64_t hash);
+	void close();
+private:
+	void flush_frame();
+	void put(NetPkg &pkg);
+};
+
 class World;
 
 /* Used for entity to query world info. */
 class WorldView final {
 	World &w;
+	const std::vector<Entity> *frozen; // if set, entities are looked up here instead
 public:
-	WorldView(World &w) : w(w) {}
+	WorldView(World &w, const std::vector<Entity> *frozen=nullptr) : w(w), frozen(frozen) {}
 
 	Entity &at(IdPoolRef);
 	Entity *try_get(IdPoolRef);
-	Entity *try_get_alive(float x, float y, EntityType);
+	/** Find closest alive entity of specified type. Any tree will do if \a type is a tree. */
+	Entity *try_get_alive(float x, float y, EntityType type);
+	/** Waypoints for a moving entity. Entities may only modify their own path while ticking. */
+	Path *try_path(const Entity&);
 	bool try_convert(Entity&, Entity &aggressor);
 	void collect(unsigned player, const Resources &res);
+	void wake(const Entity&);
 };
 
 class IServer;
 class Server;
 
+/** Area of interest of a peer and which entities it currently knows about. */
+class PeerView final {
+public:
+	NetCamSet cam; // in tiles
+	std::map<IdPoolRef, EntityView> entities; // last EntityView sent to peer
+	bool cam_changed;
+	std::vector<uint32_t> chunks; // version of each terrain chunk sent to peer. 0 if it has never been sent
+	uint32_t terrain_version; // Terrain::version when the peer had all chunks
+
+	static constexpr int32_t margin = 4; // extra tiles around the camera
+
+	PeerView() : cam(), entities(), cam_changed(true), chunks(), terrain_version(0) {}
+	PeerView(const NetCamSet &cam) : cam(cam), entities(), cam_changed(true), chunks(), terrain_version(0) {}
+
+	bool can_see(float x, float y) const noexcept {
+		return x >= cam.x - margin && x <= cam.x + cam.w + margin
+			&& y >= cam.y - margin && y <= cam.y + cam.h + margin;
+	}
+
+	/**
+	 * Collect at most \a max chunks of \a t that the peer does not have or that have changed since, closest to the camera first.
+	 * Chunks are returned as cy * t.chunks_w() + cx.
+	 */
+	void stale_chunks(const Terrain &t, std::vector<unsigned> &lst, size_t max);
+};
+
+/** Effects of ticking a range of entities that have to be applied to the world afterwards. */
+class EntityTickBuffer final {
+public:
+	std::vector<IdPoolRef> dirty, died, idle;
+	std::vector<std::pair<IdPoolRef, IdPoolRef>> hits; // attacker, target
+
+	// one row per ticked entity, referring to its slot in World::entities
+	std::vector<uint32_t> slots;
+	std::vector<uint8_t> was_alive, changed, more;
+	// hot fields of these rows for the batched kernels
+	EntityMotion motion;
+	EntityAnim anim;
+
+	EntityTickBuffer() : dirty(), died(), idle(), hits(), slots(), was_alive(), changed(), more(), motion(), anim() {}
+
+	void clear() noexcept {
+		dirty.clear();
+		died.clear();
+		idle.clear();
+		hits.clear();
+
+		slots.clear();
+		was_alive.clear();
+		changed.clear();
+		more.clear();
+		motion.clear();
+		anim.clear();
+	}
+};
+
 class World final {
-	std::mutex m, m_events;
+	std::mutex m;
 	Terrain t;
 	IdPool<Entity> entities;
+	SpatialIndex spatial;
+	Pathfinder paths;
 	std::set<IdPoolRef> dirty_entities, spawned_entities, died_entities, killed_entities;
+	std::set<IdPoolRef> active_entities; // units that have something to do. nothing else is ticked
+	TimerWheel timers; // wakes up entities that are just waiting for something
+	std::vector<EntityTimer> timers_due;
 	IdPool<Particle> particles;
 	std::set<IdPoolRef> spawned_particles;
 	std::vector<Player> players;
 	std::vector<PlayerAchievements> player_achievements;
-	std::deque<WorldEvent> events_in, events_out;
-	std::map<IdPoolRef, NetCamSet> views; // display area for each peer
+	MpscQueue<WorldEvent> events_in; // filled by the network thread, drained by pump_events
+	std::vector<WorldEvent> events_batch;
+	std::atomic<bool> events_draining; // a game is starting or running, so events_in will be pumped and nothing may be dropped
+	std::atomic<uint64_t> events_stalled, events_dropped;
+	std::deque<WorldEvent> events_out;
+	std::map<IdPoolRef, PeerView> views; // display area for each peer
 	std::set<unsigned> resources_out;
 	IServer *s;
 	bool gameover;
+	// parallel entity tick
+	ctpl::thread_pool tp;
+	std::vector<uint32_t> tick_slots; // slots of active_entities in World::entities
+	std::vector<Entity> tick_targets; // state of all targets at the start of the tick, sorted by ref
+	std::vector<EntityTickBuffer> tick_buffers; // one per chunk
+	EntityTickBuffer tick_merged;
+	TickStats tick_stats; // of the running eventloop
+	// lockstep
+	uint32_t ticks; // number of ticks since the game has started
+	Random rng;
+	std::vector<WorldEvent> lockstep_inputs; // inputs applied since the last frame, for lockstep peers and the replay
+	std::unique_ptr<ReplayWriter> replay;
+	std::map<uint32_t, uint64_t> lockstep_hashes; // our state hash for the last few hash_interval ticks
+	std::set<IdPoolRef> desynced; // peers that have reported a different state hash
 	friend WorldView;
 public:
 	ScenarioSettings scn;
 	std::atomic<unsigned> logic_gamespeed;
 	std::atomic<bool> running;
+	std::string replay_path; // record the game to this file if not empty
+	// eventloop timing, only read when it starts. set from the [server] section of the config
+	double tick_rate; // ticks per second at normal game speed. everything is counted in ticks, so this changes how fast the game goes
+	double snapshot_rate; // entity updates per second sent to the peers, regardless of game speed
+	unsigned max_catchup; // most ticks to do at once after a hiccup. the rest are dropped
+	unsigned tick_threads; // workers for tick_entities
 
 	static constexpr double gamespeed_max = 3.0;
 	static constexpr double gamespeed_min = 0.5;
 	static constexpr double gamespeed_step = 0.5;
+	/** Most ticks done in one go when we lag behind. */
+	static constexpr unsigned max_catchup_default = 4;
+	/** Number of events the network thread can queue before it has to wait for the world thread. */
+	static constexpr size_t event_queue_size = 4096;
+	/** Minimum number of entities per worker before tick_entities goes parallel. */
+	static constexpr size_t tick_chunk_min = 256;
+	/** Number of path nodes that may be expanded per tick. Orders that don't fit have to wait for the next tick. */
+	static constexpr uint64_t path_budget = 8000;
+	/** Most terrain chunks sent to a peer per snapshot, so big maps come in bit by bit instead of stalling everything else. */
+	static constexpr size_t terrain_chunks_per_push = 32;
+	/** Number of ticks between state hashes in lockstep games. */
+	static constexpr unsigned hash_interval = DEFAULT_TICKS_PER_SECOND;
+	/** Number of state hashes to keep around for peers that lag behind. */
+	static constexpr size_t hash_history = 64;
 
 	World();
 
@@ -110,9 +264,35 @@ public:
 
 	void eventloop(IServer &s, UI_TaskInfo *info);
 
-	template<class... Args> void add_event(IdPoolRef src, WorldEventType type, Args&&... data) {
-		std::lock_guard<std::mutex> lk(m_events);
-		events_in.emplace_back(src, type, data...);
+	/** Start the game like eventloop does, but leave the ticking to step. For tests and benchmarks. */
+	void start_headless(IServer &s);
+	/** One iteration of the eventloop without the clock: pump the events, tick \a steps times and push a snapshot. */
+	void step(unsigned steps);
+	/** Timings of the eventloop or of the steps so far. */
+	const TickStats &stats() const noexcept { return tick_stats; }
+
+	/**
+	 * Queue event for the world thread. Safe to call from any thread and never blocks.
+	 * Returns false if events_in is full. Check events_ready first, so that only happens when no game is going to pump them.
+	 */
+	template<class... Args> bool add_event(IdPoolRef src, WorldEventType type, Args&&... data) {
+		if (events_in.try_emplace(src, type, data...))
+			return true;
+
+		events_dropped.fetch_add(1, std::memory_order_relaxed);
+		return false;
+	}
+
+	/**
+	 * Whether add_event has room for another event. If not, the caller has to hold on to its input and try again later,
+	 * e.g. the server stops reading from that peer. Only false while a game is starting or running.
+	 */
+	bool events_ready() noexcept {
+		if (!events_draining || events_in.has_room())
+			return true;
+
+		events_stalled.fetch_add(1, std::memory_order_relaxed);
+		return false;
 	}
 
 	int non_gaia_players() const noexcept { return this->players.size() - first_player_idx; }
@@ -120,15 +300,36 @@ public:
 	void create_terrain();
 	void create_players();
 	void create_entities();
+
+	/** Hash everything that affects the outcome of the game. Lockstep peers must end up with the same hash for the same inputs. */
+	uint64_t state_hash() const;
+
+	// read-only state for headless runs, e.g. tests and benchmarks
+	const IdPool<Entity> &entity_pool() const noexcept { return entities; }
+	const std::vector<Player> &player_list() const noexcept { return players; }
+	/** Entities that are ticked. Idle units, resources and buildings are not. */
+	const std::set<IdPoolRef> &busy_entities() const noexcept { return active_entities; }
+	uint32_t tick_count() const noexcept { return ticks; }
+
+	/** Place a unit or resource before or between lockstep frames. Every peer has to do the same to stay in sync. */
+	IdPoolRef add_unit(EntityType t, unsigned player, float x, float y, float angle, EntityState state=EntityState::alive);
+	IdPoolRef add_resource(EntityType t, float x, float y, unsigned subimage);
+
+	/** Create the same world as the server using the final settings it has sent us. */
+	void start_lockstep(IServer &s, const ScenarioSettings &scn);
+	/** Apply \a f and tick. The state hash is appended to \a hashes every hash_interval ticks. */
+	void step_lockstep(const LockstepFrame &f, std::vector<NetStateHash> &hashes);
+	/** Replace all entities in \a g with ours and hand over any new particles. */
+	void sync_lockstep(Game &g);
 private:
 	void startup(UI_TaskInfo *info);
+	void begin_steps(unsigned steps);
 	void send_initial_player_data(unsigned i, PlayerSetting &p);
 	void sanitize_player_settings(Server&);
+	void init_players();
 
 	void add_building(EntityType t, unsigned player, int x, int y);
 	void add_unit(EntityType t, unsigned player, float x, float y);
-	void add_unit(EntityType t, unsigned player, float x, float y, float angle, EntityState state=EntityState::alive);
-	void add_resource(EntityType t, float x, float y, unsigned subimage);
 	void add_berries(float x, float y);
 	void add_gold(float x, float y);
 	void add_stone(float x, float y);
@@ -137,15 +338,27 @@ private:
 	void spawn_unit(EntityType t, unsigned player, float x, float y, float angle);
 	void spawn_particle(ParticleType t, float x, float y);
 
+	/** Tick \a ref until it has nothing left to do. Call this whenever an idle unit gets something to do. */
+	void wake(IdPoolRef ref);
+	/** Stop ticking dying or decaying \a ent and schedule a timer for when its animation is done instead. */
+	void rest(Entity &ent);
+	void fire_timers();
+
 	void tick();
 	void tick_entities();
+	void freeze_targets();
+	void tick_range(size_t from, size_t to, EntityTickBuffer&);
+	void merge_tick();
 	void tick_particles();
 	void tick_players();
 	void pump_events();
 	void push_events();
 
 	void push_entities();
+	void collect_snapshot(IdPoolRef peer, PeerView &v, std::vector<NetEntityDelta> &lst);
+	void push_snapshot(IdPoolRef peer, PeerView &v, std::vector<NetEntityDelta> &lst);
 	void push_particles();
+	void push_terrain();
 	void push_scores();
 	void push_resources();
 
@@ -156,6 +369,8 @@ private:
 	void push_gamespeed_control(WorldEvent&);
 
 	void send_gameticks(unsigned);
+	void send_frame(unsigned steps);
+	void check_state_hash(WorldEvent&);
 
 	bool single_team() const noexcept;
 
@@ -223,27 +438,37 @@ public:
 
 	int mainloop(uint16_t port, uint16_t protocol, bool testing=false);
 
-	bool process(const Peer &p, NetPkg &pkg, std::deque<uint8_t> &out);
+	/** Record the next game to \a path. */
+	void record(const std::string &path) { w.replay_path = path; }
+	/** Timing of the next game, see World::tick_rate. */
+	void timing(double tick_rate, double snapshot_rate, unsigned max_catchup) {
+		w.tick_rate = tick_rate;
+		w.snapshot_rate = snapshot_rate;
+		w.max_catchup = max_catchup;
+	}
+
+	bool process(const Peer &p, NetPkg &pkg, RingBuffer &out);
 
 	bool incoming(ServerSocket &s, const Peer &p) override;
 	void dropped(ServerSocket &s, const Peer &p) override;
 
 	void stopped() override;
 
-	int proper_packet(ServerSocket &s, const std::deque<uint8_t> &q) override;
-	bool process_packet(ServerSocket &s, const Peer &p, std::deque<uint8_t> &in, std::deque<uint8_t> &out, int processed) override;
+	int proper_packet(ServerSocket &s, const RingBuffer &q) override;
+	bool can_process(ServerSocket &s, const Peer &p) override;
+	bool process_packet(ServerSocket &s, const Peer &p, RingBuffer &in, RingBuffer &out, int processed) override;
 
 	bool is_running() const noexcept override { return m_running.load(); }
 private:
-	bool chk_protocol(const Peer &p, std::deque<uint8_t> &out, NetPkg &pkg);
-	bool chk_username(const Peer &p, std::deque<uint8_t> &out, const std::string &name);
+	bool chk_protocol(const Peer &p, RingBuffer &out, NetPkg &pkg);
+	bool chk_username(const Peer &p, RingBuffer &out, const std::string &name);
 
-	void change_username(const Peer &p, std::deque<uint8_t> &out, const std::string &name);
+	void change_username(const Peer &p, RingBuffer &out, const std::string &name);
 	bool set_scn_vars(const Peer &p, ScenarioSettings &scn);
 
 	bool process_clientinfo(const Peer &p, NetPkg &pkg);
-	bool process_playermod(const Peer &p, NetPlayerControl &ctl, std::deque<uint8_t> &out);
-	bool process_entity_mod(const Peer &p, NetEntityMod &em, std::deque<uint8_t> &out);
+	bool process_playermod(const Peer &p, NetPlayerControl &ctl, RingBuffer &out);
+	bool process_entity_mod(const Peer &p, NetEntityMod &em, RingBuffer &out);
 
 	bool cam_set(const Peer &p, NetCamSet &cam);
 
@@ -358,6 +583,28 @@ private:
 	void set_scn_vars(const ScenarioSettings &scn);
 };
 
+/** Accepts and drops everything, for worlds that have no one to send anything to. */
+class NullServer final : public IServer {
+public:
+	NullServer() : IServer() {}
+
+	bool is_running() const noexcept override { return true; }
+	void close() override {}
+	void broadcast(NetPkg&, bool) override {}
+};
+
+/**
+ * Our own copy of the world in lockstep games. Anything it wants to send is dropped:
+ * the server sends the same stuff anyway.
+ */
+class LockstepWorld final {
+public:
+	NullServer s;
+	World w;
+
+	LockstepWorld() : s(), w() {}
+};
+
 class Client final : public IClient {
 	TcpSocket s;
 	std::string host;
@@ -368,6 +615,7 @@ class Client final : public IClient {
 	std::vector<uint8_t> sendbuf;
 	std::string initial_username;
 	uint8_t gamespeed;
+	std::unique_ptr<LockstepWorld> lockstep;
 	friend Debug;
 public:
 	Client(const std::string &username);
@@ -390,11 +638,15 @@ private:
 	void peermod(const NetPeerControl&);
 	void terrainmod(const NetTerrainMod&);
 	void entitymod(const NetEntityMod&);
+	void entitymod(const std::vector<NetEntityDelta>&);
 	void particlemod(NetPkg&);
 	void resource_ctl(NetPkg&);
 	void gameticks(unsigned n);
 	void gamespeed_control(const NetGamespeedControl&);
 
+	void lockstep_start();
+	void lockstep_frame(const LockstepFrame&);
+
 	void set_me(IdPoolRef);
 public:
 	template<typename T> void send(T *ptr, int len=1) {
@@ -792,7 +792,7 @@ void UICache::collect(std::vector<IdPoolRef> &dst, float off_x, float off_y, boo
 	}
 }
 
-const gfx::ImageRef &UICache::imgtile(uint8_t id) {
+const gfx::ImageRef &UICache::imgtile(tile_t id) {
 	TileType type = Terrain::tile_type(id);
 	unsigned subimage = Terrain::tile_img(id);
 
@@ -812,7 +812,7 @@ void UICache::show_selections() {
 			continue;
 
 		// determine entity (i.e. unit or building) size
-		const EntityInfo &i = entity_info.at((unsigned)ent->type);
+		const EntityInfo &i = ent->info();
 		float size = i.size;
 
 		float x = ent->x + 1, y = ent->y;
@@ -893,6 +893,7 @@ void Engine::show_mph_cfg(ui::Frame &f) {
 		f.chkbox("Reveal map", scn.explored);
 		f.chkbox("Full Tech Tree", scn.all_technologies);
 		f.chkbox("Enable cheating", scn.cheating);
+		f.chkbox("Lockstep", scn.lockstep);
 		ImGui::EndDisabled();
 
 		f.fmt("Age: %u", scn.age);
@@ -927,6 +928,7 @@ void Engine::show_mph_cfg(ui::Frame &f) {
 		changed |= f.chkbox("Reveal map", scn.explored);
 		changed |= f.chkbox("Full Tech Tree", scn.all_technologies);
 		changed |= f.chkbox("Enable cheating", scn.cheating);
+		changed |= f.chkbox("Lockstep", scn.lockstep);
 		//if (scn.hosting)
 		//	changed |= f.chkbox("Host makes settings", scn.restricted);
 
@@ -288,7 +288,7 @@ public:
 
 	void str_scream(const char *txt);
 
-	const gfx::ImageRef &imgtile(uint8_t v);
+	const gfx::ImageRef &imgtile(tile_t v);
 
 	void set_scn(io::Scenario&);
 
@@ -297,7 +297,7 @@ public:
 	void show_debug(bool &open);
 private:
 	void play_sfx(SfxId id, int loops=0);
-	void draw_tile(uint8_t id, uint8_t h, int x, int y, const ImVec2 &size, ImU32 col);
+	void draw_tile(tile_t id, uint8_t h, int x, int y, const ImVec2 &size, ImU32 col);
 	void show_terrain();
 	/** Show user selected entities. */
 	void show_selections();
@@ -309,6 +309,8 @@ private:
 	void game_mouse_process();
 	void mouse_left_process();
 	void mouse_right_process();
+	/** Find the tile under (\a mx, \a my) on the screen. */
+	bool find_tile(float mx, float my, int &tx, int &ty);
 
 	bool menu_btn(ImTextureID tex, const Assets &a, const char *lbl, float x, float scale, bool small);
 	bool frame_btn(const BackgroundColors &col, const char *lbl, float x, float y, float w, float h, float scale, bool invert=false);
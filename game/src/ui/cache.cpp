@@ -167,6 +167,40 @@ void UICache::mouse_left_process() {
 		e->sfx.play_sfx(sfx);
 }
 
+bool UICache::find_tile(float mx, float my, int &tx, int &ty) {
+	GameView &gv = e->gv;
+
+	for (VisualTile &vt : display_area) {
+		if (mx >= vt.bnds.x && mx < vt.bnds.x + vt.bnds.w && my >= vt.bnds.y && my < vt.bnds.y + vt.bnds.h) {
+			// get actual image
+			tile_t id = gv.t.tile_at(vt.tx, vt.ty);
+			if (!id)
+				continue;
+
+			const gfx::ImageRef &r = imgtile(id);
+
+			int y = (int)(my - vt.bnds.y);
+
+			// ignore if out of range
+			if (y < 0 || y >= r.mask.size())
+				continue;
+
+			auto row = r.mask.at(y);
+			int x = (int)(mx - vt.bnds.x);
+
+			// ignore if point not on line
+			if (x < row.first || x >= row.second)
+				continue;
+
+			tx = vt.tx;
+			ty = vt.ty;
+			return true;
+		}
+	}
+
+	return false;
+}
+
 void UICache::mouse_right_process() {
 	ZoneScoped;
 
@@ -211,46 +245,20 @@ void UICache::mouse_right_process() {
 	}
 
 	// no entities found to interact with, search tiles
-	for (VisualTile &vt : display_area) {
-		if (mx >= vt.bnds.x && mx < vt.bnds.x + vt.bnds.w && my >= vt.bnds.y && my < vt.bnds.y + vt.bnds.h) {
-			// get actual image
-			uint8_t id = gv.t.tile_at(vt.tx, vt.ty);
-			uint8_t h = gv.t.h_at(vt.tx, vt.ty);
-			if (!id) {
-				// TODO does not work yet :/
-				// unexplored tiles should still be clickable
-				// use dummy id, which may be sligthly inaccurate
-				id = 0;
-				continue;
-			}
+	int tx, ty;
 
-			const gfx::ImageRef &r = imgtile(id);
-
-			int y = (int)(my - vt.bnds.y);
-
-			// ignore if out of range
-			if (y < 0 || y >= r.mask.size())
-				continue;
-
-			auto row = r.mask.at(y);
-			int x = (int)(mx - vt.bnds.x);
-
-			// ignore if point not on line
-			if (x < row.first || x >= row.second)
-				continue;
+	if (!find_tile(mx, my, tx, ty))
+		return;
 
-			// TODO determine precise value, now we always use tile's center
-			//printf("clicked on %d,%d\n", vt.tx, vt.ty);
+	// TODO determine precise value, now we always use tile's center
+	//printf("clicked on %d,%d\n", tx, ty);
 
-			for (IdPoolRef ref : selected) {
-				Entity *ent = e->gv.try_get(ref);
-				if (!ent)
-					continue;
+	for (IdPoolRef ref : selected) {
+		Entity *ent = e->gv.try_get(ref);
+		if (!ent)
+			continue;
 
-				e->client->entity_move(ent->ref, vt.tx, vt.ty);
-			}
-			return;
-		}
+		e->client->entity_move(ent->ref, tx, ty);
 	}
 
 	//printf("nothing selected\n");
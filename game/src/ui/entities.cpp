@@ -100,7 +100,7 @@ void UICache::load_entities() {
 			entities.emplace_back(ent.ref, imgref, x0, y0, tcp.bnds.w, tcp.bnds.h, tcp.s0, tcp.t0, tcp.s1, tcp.t1, tpos.y + 0.1f, ent.xflip);
 
 			// if building is damaged, add fire
-			float hper = (float)ent.stats.hp / ent.stats.maxhp;
+			float hper = (float)ent.hp / ent.maxhp();
 
 			if (hper <= 0.75f) {
 				io::DrsId fid = io::DrsId::gif_bld_fire3;
@@ -1,10 +1,12 @@
 #include "../engine.hpp"
 
+#include <cmath>
+
 namespace aoe {
 
 using namespace ui;
 
-void UICache::draw_tile(uint8_t id, uint8_t h, int x, int y, const ImVec2 &size, ImU32 col) {
+void UICache::draw_tile(tile_t id, uint8_t h, int x, int y, const ImVec2 &size, ImU32 col) {
 	const gfx::ImageRef &img = imgtile(id);
 
 	ImVec2 tpos(e->tilepos(x, y, left, top, h));
@@ -35,11 +37,23 @@ void UICache::show_terrain() {
 
 	display_area.clear();
 
-	for (int y = 0; y < gv.t.h; ++y) {
-		for (int x = 0; x < gv.t.w; ++x) {
+	// only visit the tiles that can be on screen, so large maps don't cost more than small ones.
+	// see Engine::tilepos: x + y runs along the screen x-axis and x - y - h along the screen y-axis
+	float hw = e->tw / 2.0f, hh = e->th / 2.0f;
+	float u0 = -left / hw, u1 = (io.DisplaySize.x - left) / hw;
+	float v0 = -top / hh, v1 = (io.DisplaySize.y - top) / hh + Terrain::max_height;
+	int margin = 2; // tile images stick out a bit around their hotspot
+
+	int xmin = std::max(0, (int)std::floor((u0 + v0) / 2) - margin);
+	int xmax = std::min((int)gv.t.w, (int)std::ceil((u1 + v1) / 2) + margin);
+	int ymin = std::max(0, (int)std::floor((u0 - v1) / 2) - margin);
+	int ymax = std::min((int)gv.t.h, (int)std::ceil((u1 - v0) / 2) + margin);
+
+	for (int y = ymin; y < ymax; ++y) {
+		for (int x = xmin; x < xmax; ++x) {
 			ImU32 col = IM_COL32_WHITE;
 
-			uint16_t id = gv.t.tile_at(x, y);
+			tile_t id = gv.t.tile_at(x, y);
 			uint8_t h = gv.t.h_at(x, y);
 			if (!id) {
 				// draw black tile
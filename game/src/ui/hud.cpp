@@ -29,6 +29,7 @@ void UICache::idle(Engine &e) {
 }
 
 void UICache::idle_editor(Engine &e) {
+	scn_edit.flush_brush(scn_game);
 	e.gv.try_read(scn_game);
 }
 
@@ -211,10 +212,10 @@ void UICache::show_hud_selection(float menubar_left, float top, float menubar_h)
 
 	// TODO determine description
 	// 8, 650 -> 5, 8
-	const EntityInfo &info = entity_info.at((unsigned)ent->type);
+	const EntityInfo &info = ent->info();
 
 	unsigned icon = info.icon;
-	const char *name = info.name.c_str();
+	const char *name = info.name;
 
 	bkg->AddText(ImVec2(menubar_left + 10 * scale, top + 8 * scale), IM_COL32_WHITE, "Egyptian"); // TODO add civ
 	// 664 -> 22
@@ -231,7 +232,7 @@ void UICache::show_hud_selection(float menubar_left, float top, float menubar_h)
 	// HP
 	// 8, 733 -> 8,91
 	unsigned hp = 0;
-	unsigned subimage = std::clamp(25u * (ent->stats.maxhp - ent->stats.hp) / ent->stats.maxhp, 0u, 25u);
+	unsigned subimage = std::clamp(25u * (ent->maxhp() - ent->hp) / ent->maxhp(), 0u, 25u);
 
 	const ImageSet &s_hpbar = a.anim_at(io::DrsId::gif_hpbar);
 	const gfx::ImageRef &hpimg = a.at(s_hpbar.try_at(subimage));
@@ -242,7 +243,7 @@ void UICache::show_hud_selection(float menubar_left, float top, float menubar_h)
 	// 8, 744 -> 8,102
 	char buf[32];
 
-	snprintf(buf, sizeof buf, "%u/%u", ent->stats.hp, ent->stats.maxhp);
+	snprintf(buf, sizeof buf, "%u/%u", ent->hp, ent->maxhp());
 	bkg->AddText(ImVec2(menubar_left + 10 * scale, top + 102 * scale), IM_COL32_WHITE, buf);
 
 	if (e->cv.playerindex != ent->playerid)
@@ -258,7 +259,7 @@ void UICache::show_hud_selection(float menubar_left, float top, float menubar_h)
 
 		switch (info.type) {
 			case EntityType::town_center: {
-				const EntityInfo &i_vil = entity_info.at((unsigned)EntityType::villager);
+				const EntityInfo &i_vil = entity_type_info(EntityType::villager);
 				const gfx::ImageRef &img_vil = a.at(s_units.try_at(ent->playerid, i_vil.icon));
 
 				if (frame_btn(col, "train 1", x0 - 2, y0 - 2, img_vil.bnds.w * scale + 4, img_vil.bnds.h * scale + 4, 1)) {
@@ -271,7 +272,7 @@ void UICache::show_hud_selection(float menubar_left, float top, float menubar_h)
 			}
 			case EntityType::barracks: {
 				// TODO determine image based on age
-				const EntityInfo &i_melee = entity_info.at((unsigned)EntityType::melee1);
+				const EntityInfo &i_melee = entity_type_info(EntityType::melee1);
 				const gfx::ImageRef &img_melee = a.at(s_units.try_at(ent->playerid, i_melee.icon));
 
 				if (frame_btn(col, "train 1", x0 - 2, y0 - 2, img_melee.bnds.w * scale + 4, img_melee.bnds.h * scale + 4, 1)) {
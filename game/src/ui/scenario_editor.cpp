@@ -27,6 +27,9 @@ struct ScnBtn {
 	{"Cinematics", 4, 1},
 };
 
+// same order as the brush types of ScenarioEditor
+static const std::vector<std::string> brush_names{ "desert", "grass", "water", "deep water" };
+
 #define ARRAY_SIZE(a) (sizeof(a) / sizeof(a[0]))
 
 void UICache::show_editor_scenario() {
@@ -76,6 +79,16 @@ void UICache::show_editor_scenario() {
 
 	lst->AddImage(e->tex1, ImVec2(menubar_left, menubar2_top), ImVec2(menubar_right, menubar2_bottom), ImVec2(bkg.s0, t0), ImVec2(bkg.s1, bkg.t1));
 
+	// paint terrain while the left mouse button is down. the stroke is applied in idle_editor
+	if (scn_edit.top_btn_idx == 1 && io.MouseDown[0] && !io.WantCaptureMouse && io.MousePos.y >= menubar_top + 50.0f * scale && io.MousePos.y < menubar2_top) {
+		int tx, ty;
+
+		if (find_tile(io.MousePos.x, io.MousePos.y, tx, ty))
+			scn_edit.brush_to(tx, ty);
+	} else {
+		scn_edit.brush_up();
+	}
+
 	// draw buttons
 	BackgroundColors col;
 
@@ -212,6 +225,10 @@ void UICache::show_editor_scenario() {
 			scn_edit.create_map(scn_game);
 		}
 		break;
+	case 1:
+		ImGui::Combo("brush", scn_edit.brush_type, brush_names);
+		ImGui::InputClamp("brush size", scn_edit.brush_size, 1, 9);
+		break;
 	default:
 		str2(ImVec2(menubar_left + 11 * scale, menubar2_top + 11 * scale), "Work in progress");
 		break;
@@ -34,6 +34,7 @@ void show_scenario_settings(ui::Frame &f, ScenarioSettings &scn) {
 	f.chkbox("Reveal map", scn.explored);
 	f.chkbox("Full Tech Tree", scn.all_technologies);
 	f.chkbox("Enable cheating", scn.cheating);
+	f.chkbox("Lockstep", scn.lockstep);
 
 	f.combo("Age", scn.age, old_lang.age_names);
 	f.scalar("Max pop.", scn.popcap, POPULATION_STEP, min_popcap, max_popcap);
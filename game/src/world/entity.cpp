@@ -11,23 +11,23 @@
 
 namespace aoe {
 
-EntityView::EntityView() : ref(invalid_ref), type(EntityType::town_center), playerid(0), x(0), y(0), angle(0), subimage(0), state(EntityState::alive), xflip(false), stats(entity_info.at((unsigned)type)) {}
+EntityView::EntityView() : ref(invalid_ref), type(EntityType::town_center), playerid(0), x(0), y(0), angle(0), subimage(0), state(EntityState::alive), xflip(false), hp(entity_type_info(type).hp) {}
 
-EntityView::EntityView(const Entity &e) : ref(e.ref), type(e.type), playerid(e.playerid), x(e.x), y(e.y), angle(e.angle), subimage(e.subimage), state(e.state), xflip(e.xflip), stats(e.stats) {}
+EntityView::EntityView(const Entity &e) : ref(e.ref), type(e.type), playerid(e.playerid), x(e.x), y(e.y), angle(e.angle), subimage(e.subimage), state(e.state), xflip(e.xflip), hp(e.hp) {}
 
-Entity::Entity(IdPoolRef ref) : ref(ref), type(EntityType::town_center), playerid(0), x(0), y(0), angle(0), target_ref(invalid_ref), target_x(0), target_y(0), subimage(0), state(EntityState::alive), xflip(false), autotask(false), stats(entity_info.at((unsigned)type)) {}
+Entity::Entity(IdPoolRef ref) : ref(ref), type(EntityType::town_center), playerid(0), x(0), y(0), angle(0), target_ref(invalid_ref), target_x(0), target_y(0), leg_x(0), leg_y(0), leg_dx(0), leg_dy(0), leg_ticks(0), subimage(0), state(EntityState::alive), xflip(false), autotask(false), hp(entity_type_info(type).hp) {}
 
-Entity::Entity(IdPoolRef ref, EntityType type, unsigned playerid, float x, float y, float angle, EntityState state) : ref(ref), type(type), playerid(playerid), x(x), y(y), angle(angle), target_ref(invalid_ref), target_x(0), target_y(0), subimage(0), state(state), xflip(false), autotask(false), stats(entity_info.at((unsigned)type)) {}
+Entity::Entity(IdPoolRef ref, EntityType type, unsigned playerid, float x, float y, float angle, EntityState state) : ref(ref), type(type), playerid(playerid), x(x), y(y), angle(angle), target_ref(invalid_ref), target_x(0), target_y(0), leg_x(0), leg_y(0), leg_dx(0), leg_dy(0), leg_ticks(0), subimage(0), state(state), xflip(false), autotask(false), hp(entity_type_info(type).hp) {}
 
-Entity::Entity(IdPoolRef ref, EntityType type, float x, float y, unsigned subimage) : ref(ref), type(type), playerid(0), x(x), y(y), angle(0), target_ref(invalid_ref), target_x(0), target_y(0), subimage(subimage), state(EntityState::alive), xflip(false), autotask(false), stats(entity_info.at((unsigned)type)) {}
+Entity::Entity(IdPoolRef ref, EntityType type, float x, float y, unsigned subimage) : ref(ref), type(type), playerid(0), x(x), y(y), angle(0), target_ref(invalid_ref), target_x(0), target_y(0), leg_x(0), leg_y(0), leg_dx(0), leg_dy(0), leg_ticks(0), subimage(subimage), state(EntityState::alive), xflip(false), autotask(false), hp(entity_type_info(type).hp) {}
 
-Entity::Entity(const EntityView &ev) : ref(ev.ref), type(ev.type), playerid(ev.playerid), x(ev.x), y(ev.y), angle(ev.angle), target_ref(invalid_ref), target_x(0), target_y(0), subimage(ev.subimage), state(ev.state), xflip(ev.xflip), autotask(false), stats(ev.stats) {}
+Entity::Entity(const EntityView &ev) : ref(ev.ref), type(ev.type), playerid(ev.playerid), x(ev.x), y(ev.y), angle(ev.angle), target_ref(invalid_ref), target_x(0), target_y(0), leg_x(0), leg_y(0), leg_dx(0), leg_dy(0), leg_ticks(0), subimage(ev.subimage), state(ev.state), xflip(ev.xflip), autotask(false), hp(ev.hp) {}
 
 bool Entity::die() noexcept {
 	if (!is_alive())
 		return false;
 
-	stats.hp = 0;
+	hp = 0;
 	// prevent endless dying buildings
 	set_state(is_building() ? EntityState::decaying : EntityState::dying);
 
@@ -47,6 +47,7 @@ bool Entity::set_state(EntityState s) noexcept {
 	EntityState old = state;
 
 	state = s;
+	leg_ticks = 0;
 	reset_anim();
 
 	return old != s;
@@ -57,39 +58,100 @@ bool Entity::try_state(EntityState s) noexcept {
 		return false;
 
 	state = s;
+	leg_ticks = 0;
 	reset_anim();
 
 	return true;
 }
 
-template<typename T> constexpr int signum(T v) {
-	return v > 0 ? 1 : v < 0 ? -1 : 0;
+int64_t Entity::lookat(Fixed x, Fixed y) noexcept {
+	// NOTE this is fine for maps up to 32k tiles: the squares fit easily in 64 bits
+	int64_t dx = (int64_t)x.raw - this->x.raw, dy = (int64_t)y.raw - this->y.raw;
+
+	if (dx || dy)
+		angle = angle_of(dx, dy);
+
+	return (int64_t)isqrt((uint64_t)(dx * dx + dy * dy));
 }
 
-float Entity::lookat(float x, float y) noexcept {
-	float dx = x - this->x, dy = y - this->y;
-	// compute angle and make sure it's always positive
-	angle = fmodf(atan2(dy, dx) + 2 * M_PI, 2 * M_PI);
-	return sqrt(dx * dx + dy * dy);
+/** Which of the 8 directions we are drawn in when facing \a angle. */
+static unsigned face_sector(float angle) noexcept {
+	// note that we have 8 faces, so (2pi)/8 = pi/4. then we need (2pi)/(2*8) to correct for [-a,+a) range.
+	float normface = fmodf(angle + M_PI / 8, 2 * M_PI) / (M_PI / 4);
+	return (unsigned)normface % 8u;
 }
 
-bool Entity::move() noexcept {
-	float distance = lookat(target_x, target_y);
+void Entity::walk(EntityMotion &mv, uint32_t row, Fixed x, Fixed y) noexcept {
+	// only look where to go if we have not been walking there already
+	if (!leg_ticks || leg_x != x || leg_y != y) {
+		int64_t dx = (int64_t)x.raw - this->x.raw, dy = (int64_t)y.raw - this->y.raw;
+		int64_t distance = (int64_t)isqrt((uint64_t)(dx * dx + dy * dy)), speed = info().speed;
+
+		// following a target changes the leg all the time. keep angle unless it looks different
+		if (dx || dy) {
+			float a = angle_of(dx, dy);
+			if (face_sector(a) != face_sector(angle))
+				angle = a;
+		}
 
-	float speed = 0.04f; // TODO determine from entity stats
-	if (distance < speed) {
-		x = target_x;
-		y = target_y;
-		return set_state(target_ref != invalid_ref ? EntityState::attack : EntityState::alive);
+		leg_x = x;
+		leg_y = y;
+
+		if (distance <= speed) {
+			leg_dx = leg_dy = Fixed();
+			leg_ticks = 1;
+		} else {
+			leg_dx = Fixed::from_raw((int32_t)(dx * speed / distance));
+			leg_dy = Fixed::from_raw((int32_t)(dy * speed / distance));
+			leg_ticks = (uint32_t)((distance + speed - 1) / speed);
+		}
 	}
 
-	x += speed * cos(angle);
-	y += speed * sin(angle);
+	mv.add(row, this->x, this->y, leg_x, leg_y, leg_dx, leg_dy, leg_ticks);
+}
 
+/** Walk straight to target. */
+bool Entity::move(EntityMotion &mv, uint32_t row) noexcept {
+	walk(mv, row, target_x, target_y);
 	return true;
 }
 
-bool Entity::attack(WorldView &wv) noexcept {
+/** Walk to target by following our path, if we have any. */
+bool Entity::move(WorldView &wv, EntityMotion &mv, uint32_t row) noexcept {
+	Path *p = wv.try_path(*this);
+	if (!p)
+		return move(mv, row);
+
+	// wait for pathfinder
+	if (p->pending)
+		return false;
+
+	if (p->next < p->pts.size()) {
+		auto [px, py] = p->pts[p->next];
+
+		walk(mv, row, Fixed(px), Fixed(py));
+		return true;
+	}
+
+	// unreachable
+	return set_state(EntityState::alive);
+}
+
+bool Entity::stepped(WorldView &wv, bool arrived) noexcept {
+	if (!arrived)
+		return false;
+
+	Path *p = state == EntityState::moving ? wv.try_path(*this) : nullptr;
+	if (!p)
+		return set_state(target_ref != invalid_ref ? EntityState::attack : EntityState::alive);
+
+	if (++p->next < p->pts.size())
+		return false;
+
+	return set_state(EntityState::alive);
+}
+
+bool Entity::attack(WorldView &wv, EntityMotion &mv, uint32_t row) noexcept {
 	Entity *t = wv.try_get(target_ref);
 	if (!t) {
 		// cannot find target, just move there
@@ -107,22 +169,22 @@ bool Entity::attack(WorldView &wv) noexcept {
 	if (in_range(*t))
 		return try_state(EntityState::attack);
 
-	bool d = try_state(EntityState::attack_follow);
+	try_state(EntityState::attack_follow);
 	target_x = t->x;
 	target_y = t->y;
-	return d |= move();
+	return move(mv, row);
 }
 
-bool Entity::tick(WorldView &wv) noexcept {
+bool Entity::tick(WorldView &wv, EntityMotion &mv, uint32_t row) noexcept {
 	// check we haven't become undead
-	if (!stats.hp)
+	if (!hp)
 		return die();
 
 	switch (state) {
-	case EntityState::moving: return move();
+	case EntityState::moving: return move(wv, mv, row);
 	case EntityState::attack:
 	case EntityState::attack_follow:
-		return attack(wv);
+		return attack(wv, mv, row);
 	}
 
 	return false;
@@ -132,27 +194,20 @@ void Entity::set_type(EntityType type, bool resethp) {
 	if (this->type == type)
 		return;
 
-	stats = entity_info.at((unsigned)type);
-
-	if (resethp) {
-		this->stats = stats;
-	} else {
-		unsigned hp = this->stats.hp;
-
-		this->stats = stats;
-		this->stats.hp = std::clamp(hp, 0u, this->stats.maxhp);
-	}
+	unsigned maxhp = entity_type_info(type).hp;
+	hp = resethp ? maxhp : std::min(hp, maxhp);
 
 	this->type = type;
 }
 
-unsigned Entity::get_atk(const EntityStats &stats) noexcept {
-	return std::min(stats.hp, is_building() ? stats.attack_bld : stats.attack);
+unsigned Entity::get_atk(const Entity &aggressor) noexcept {
+	const EntityInfo &info = aggressor.info();
+	return std::min(aggressor.hp, is_building() ? info.atk_bld : info.atk);
 }
 
 bool Entity::hit(WorldView &wv, Entity &aggressor) noexcept {
 	ZoneScoped;
-	unsigned atk = get_atk(aggressor.stats);
+	unsigned atk = get_atk(aggressor);
 
 	switch (aggressor.type) {
 	case EntityType::priest:
@@ -181,14 +236,14 @@ bool Entity::hit(WorldView &wv, Entity &aggressor) noexcept {
 				// aggressor could be worker_wood1
 				aggressor.set_type(EntityType::worker_wood2);
 
-				atk = get_atk(aggressor.stats);
+				atk = get_atk(aggressor);
 				wv.collect(aggressor.playerid, Resources(atk, 0, 0, 0));
 
 				break;
 			}
 		}
 
-		if (stats.hp <= atk) {
+		if (hp <= atk) {
 			if (is_resource(type)) {
 				if (aggressor.type == EntityType::worker_wood2) {
 					set_type(EntityType::dead_tree1);
@@ -218,7 +273,7 @@ bool Entity::hit(WorldView &wv, Entity &aggressor) noexcept {
 			return die();
 		}
 
-		stats.hp = std::max(stats.hp - atk, 0u);
+		hp = std::max(hp - atk, 0u);
 		break;
 	}
 
@@ -251,10 +306,9 @@ bool Entity::task_move(float x, float y) noexcept {
 	if (!is_alive() || is_building() || is_resource(type))
 		return false;
 
-	// TODO start pathfinding stuff
 	this->target_ref = invalid_ref;
-	this->target_x = x;
-	this->target_y = y;
+	this->target_x = Fixed(x);
+	this->target_y = Fixed(y);
 	this->state = EntityState::moving;
 	autotask = false;
 
@@ -376,10 +430,10 @@ std::optional<SfxId> Entity::sfxtick() noexcept {
 }
 
 bool Entity::in_range(const Entity &e) const noexcept {
-	const EntityInfo &info1 = entity_info.at((unsigned)type);
+	const EntityInfo &info1 = info();
 	float size1 = is_building() ? info1.size / 2 : info1.size / 20;
 
-	const EntityInfo &info2 = entity_info.at((unsigned)e.type);
+	const EntityInfo &info2 = e.info();
 	float size2 = aoe::is_building(e.type) ? info2.size / 2 : info2.size / 20;
 
 	float x1 = x, x2 = e.x, y1 = y, y2 = e.y;
@@ -397,59 +451,92 @@ bool Entity::in_range(const Entity &e) const noexcept {
 	float dx = x2 - x1, dy = y2 - y1;
 	float distance = sqrt(dx * dx + dy * dy);
 
-	// TODO get range, use 0.1f for now
-	return distance < size1 + size2 + 0.05f;// +stats.range;
+	return distance < size1 + size2 + 0.05f + info1.range;
 }
 
-bool Entity::imgtick(unsigned n) noexcept {
-	bool more = true;
-	unsigned mult;
-
+bool Entity::anim_step(unsigned n, AnimStep &a) noexcept {
 	const std::array<unsigned, 8> faces{ 1, 2, 3, 4, 3, 2, 1, 0 };
 
-	// note that we have 8 faces, so (2pi)/8 = pi/4. then we need (2pi)/(2*8) to correct for [-a,+a) range.
-	float normface = fmodf(angle + M_PI / 8, 2 * M_PI) / (M_PI / 4);
-	unsigned uface = (unsigned)normface % 8u;
+	unsigned uface = face_sector(angle);
 
 	unsigned face = faces[uface];
 	xflip = uface < 3;
 
-	if (type >= entity_img_info[0].type && type <= entity_img_info.back().type) {
-		const EntityImgInfo &img = img_info();
+	if (type < entity_img_info[0].type || type > entity_img_info.back().type)
+		return false;
 
-		switch (state) {
-		case EntityState::alive:
-			mult = img.alive;
-			subimage = fmodf(subimage + n * 0.1, mult) + face * mult;
-			break;
-		case EntityState::dying:
-			mult = img.dying;
-			more = (unsigned)fmodf(subimage, mult) != img.ii_dying;
-			subimage = std::min<float>(fmodf(subimage, mult) + n, mult - 1) + face * mult;
-			break;
-		case EntityState::decaying:
-			mult = img.decaying;
-			more = fmodf(subimage, mult) < mult - 0.5;
-			subimage = std::min<float>(fmodf(subimage, mult) + n * 0.002, mult - 1) + face * mult;
-			break;
-		case EntityState::attack:
-			mult = img.attack;
-			more = (unsigned)fmodf(subimage, mult) != img.ii_attack;
-			subimage = fmodf(subimage + n, mult) + face * mult;
-			break;
-		case EntityState::attack_follow:
-			mult = img.attack_follow;
-			subimage = fmodf(subimage + n, mult) + face * mult;
-			break;
-		case EntityState::moving:
-			mult = img.moving;
-			subimage = fmodf(subimage + n, mult) + face * mult;
-			break;
-		}
-	} else if (is_building() && is_alive()) {
-		mult = 20;
-		more = true;
-		float hper = (float)stats.hp / stats.maxhp;
+	const EntityImgInfo &img = img_info();
+	unsigned mult = 1;
+	bool loop = true;
+
+	// loop by default and never run out of frames
+	a.wrap_inc = n;
+	a.clamp_inc = 0;
+	a.lo = a.hi = -1;
+
+	switch (state) {
+	case EntityState::alive:
+		mult = img.alive;
+		a.wrap_inc = n * 0.1f;
+		break;
+	case EntityState::dying:
+		mult = img.dying;
+		loop = false;
+		a.wrap_inc = 0;
+		a.clamp_inc = n;
+		a.lo = img.ii_dying;
+		a.hi = img.ii_dying + 1;
+		break;
+	case EntityState::decaying:
+		mult = img.decaying;
+		loop = false;
+		a.wrap_inc = 0;
+		a.clamp_inc = n * 0.002f;
+		a.lo = mult - 0.5f;
+		a.hi = mult;
+		break;
+	case EntityState::attack:
+		mult = img.attack;
+		a.lo = img.ii_attack;
+		a.hi = img.ii_attack + 1;
+		break;
+	case EntityState::attack_follow:
+		mult = img.attack_follow;
+		break;
+	case EntityState::moving:
+		mult = img.moving;
+		break;
+	}
+
+	a.mult = mult;
+	a.cap = loop ? mult : mult - 1;
+	a.base = face * mult;
+
+	return true;
+}
+
+unsigned Entity::anim_ticks_left() noexcept {
+	AnimStep a;
+
+	if (!anim_step(1, a) || a.clamp_inc <= 0)
+		return 1;
+
+	float r = EntityAnim::wrap(subimage, a.mult);
+	return r >= a.lo ? 1 : (unsigned)ceilf((a.lo - r) / a.clamp_inc) + 1;
+}
+
+bool Entity::imgtick(unsigned n) noexcept {
+	AnimStep a;
+
+	if (anim_step(n, a)) {
+		bool more;
+		subimage = EntityAnim::advance(subimage, a, more);
+		return more;
+	}
+
+	if (is_building() && is_alive()) {
+		unsigned mult = 20;
+		float hper = (float)hp / maxhp();
 		if (hper <= 0.75f)
 			subimage = fmodf(subimage + n, mult);
 	}
@@ -476,7 +563,7 @@ bool Entity::imgtick(unsigned n) noexcept {
 	}
 #endif
 
-	return more;
+	return true;
 }
 
 }
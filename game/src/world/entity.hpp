@@ -6,6 +6,8 @@
 #include "../engine/audio.hpp"
 
 #include "entity_info.hpp"
+#include "fixed.hpp"
+#include "motion.hpp"
 
 namespace aoe {
 
@@ -30,7 +32,7 @@ class Entity;
 class EntityView final {
 public:
 	IdPoolRef ref;
-	EntityType type; // TODO remove this and use stats.type
+	EntityType type; // key into entity_info
 
 	unsigned playerid;
 	float x, y, angle;
@@ -40,10 +42,13 @@ public:
 	EntityState state;
 	bool xflip;
 
-	EntityStats stats;
+	unsigned hp; // everything else comes from entity_info
 
 	EntityView();
 	EntityView(const Entity&);
+
+	const EntityInfo &info() const noexcept { return entity_type_info(type); }
+	unsigned maxhp() const noexcept { return info().hp; }
 };
 class EntityTask final {
 public:
@@ -68,16 +73,21 @@ public:
 	EntityType type;
 
 	unsigned playerid;
-	float x, y, angle;
+	Fixed x, y;
+	float angle; // only used for drawing
 
 	IdPoolRef target_ref; // if == invalid_ref, use target_x,target_y
-	float target_x, target_y;
+	Fixed target_x, target_y;
+
+	// straight line we are walking: step per tick towards (leg_x, leg_y) and number of ticks left
+	Fixed leg_x, leg_y, leg_dx, leg_dy;
+	uint32_t leg_ticks;
 
 	float subimage;
 	EntityState state;
 	bool xflip, autotask;
 
-	EntityStats stats;
+	unsigned hp; // everything else comes from entity_info
 
 	Entity(IdPoolRef ref);
 	Entity(IdPoolRef ref, EntityType type, unsigned playerid, float x, float y, float angle=0.0f, EntityState state=EntityState::alive);
@@ -114,13 +124,19 @@ public:
 		return aoe::is_building(type);
 	}
 
+	const EntityInfo &info() const noexcept { return entity_type_info(type); }
+	unsigned maxhp() const noexcept { return info().hp; }
+
 	bool die() noexcept;
 	void decay() noexcept;
 
-	bool tick(WorldView&) noexcept;
+	/** Run our state machine. If we want to walk, we add ourself as \a row to \a mv. */
+	bool tick(WorldView&, EntityMotion &mv, uint32_t row) noexcept;
+	/** Finish our tick after EntityMotion::step has moved us. */
+	bool stepped(WorldView&, bool arrived) noexcept;
 	bool hit(WorldView&, Entity &aggressor) noexcept;
 
-	unsigned get_atk(const EntityStats &stats) noexcept;
+	unsigned get_atk(const Entity &aggressor) noexcept;
 
 	constexpr bool is_attacking() const noexcept {
 		return state == EntityState::attack || state == EntityState::attack_follow;
@@ -142,16 +158,23 @@ public:
 	const EntityImgInfo &img_info() const;
 
 	bool imgtick(unsigned n) noexcept;
+	/** Determine how imgtick(\a n) would animate us. Returns false if we have no animation. */
+	bool anim_step(unsigned n, AnimStep&) noexcept;
+	/** Number of ticks until an animation that doesn't loop is done. */
+	unsigned anim_ticks_left() noexcept;
 private:
 	void reset_anim() noexcept;
 	bool set_state(EntityState) noexcept;
 	bool try_state(EntityState) noexcept;
-	bool move() noexcept;
-	bool attack(WorldView&) noexcept;
+	bool move(EntityMotion&, uint32_t row) noexcept;
+	bool move(WorldView&, EntityMotion&, uint32_t row) noexcept;
+	bool attack(WorldView&, EntityMotion&, uint32_t row) noexcept;
 	bool in_range(const Entity&) const noexcept;
 
-	/* Compute facing angle and return euclidean distance. */
-	float lookat(float x, float y) noexcept;
+	/* Compute facing angle and return euclidean distance in Fixed::raw units. */
+	int64_t lookat(Fixed x, Fixed y) noexcept;
+	/** Walk in a straight line to (\a x, \a y) and add ourself as \a row to \a mv. */
+	void walk(EntityMotion &mv, uint32_t row, Fixed x, Fixed y) noexcept;
 
 	void set_type(EntityType type, bool resethp=false);
 };
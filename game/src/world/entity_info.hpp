@@ -1,9 +1,12 @@
 #pragma once
 
-#include <vector>
-#include <string>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
 
 #include "../legacy/legacy.hpp"
+#include "fixed.hpp"
 #include "resources.hpp"
 
 namespace aoe {
@@ -60,7 +63,9 @@ static bool constexpr is_tree(EntityType t) {
 	return t >= EntityType::desert_tree1 && t <= EntityType::dead_tree2;
 }
 
-// TODO add is_unit (when needed?)
+static bool constexpr is_unit(EntityType t) {
+	return t >= EntityType::bird1 && t <= EntityType::priest;
+}
 
 enum class EntityIconType {
 	building,
@@ -81,28 +86,146 @@ struct EntityImgInfo final {
 	io::DrsId slp_die, slp_decay, slp_attack, slp_attack_follow, slp_moving, slp_alive;
 };
 
+enum class AttackType {
+	none,
+	melee,
+	pierce,
+};
+
+enum class UnitSpeed {
+	slow,
+	medium,
+	fast,
+};
+
+/** One row of doc/reverse_engineering/unit_stats_aoe.csv. */
+struct UnitStats final {
+	const char *name;
+	unsigned age;
+	unsigned hp, attack;
+	AttackType attack_type;
+	float reload; // seconds
+	unsigned armor_melee, armor_pierce;
+	unsigned los, range, accuracy; // tiles
+	UnitSpeed speed;
+	unsigned train_time; // seconds
+	Resources cost;
+};
+
+/** All units from the original manual. Generated by tools/unit_stats.cmake when building. */
+static constexpr UnitStats unit_stats[] = {
+#include <unit_stats_aoe.inc>
+};
+
+static constexpr bool unit_name_eq(const char *a, const char *b) noexcept {
+	for (; *a && *a == *b; ++a, ++b)
+		;
+	return *a == *b;
+}
+
+/** Look up unit by name. Only meant for compile time, where a missing name won't compile. */
+static constexpr const UnitStats &unit_stats_of(const char *name) {
+	for (const UnitStats &s : unit_stats)
+		if (unit_name_eq(s.name, name))
+			return s;
+
+	throw std::invalid_argument("unknown unit");
+}
+
+/** Distance walked per tick. */
+static constexpr int32_t unit_speed(UnitSpeed s) noexcept {
+	switch (s) {
+	case UnitSpeed::slow: return Fixed(0.03f).raw;
+	case UnitSpeed::fast: return Fixed(0.06f).raw;
+	default: return Fixed(0.04f).raw;
+	}
+}
+
+/** Everything that all entities of a type have in common. Entities only keep what changes, like their hp. */
 struct EntityInfo final {
 	EntityType type;
 	float size;
 	unsigned hp;
 	unsigned atk, atk_bld;
+	float range; // tiles, 0 for melee
+	int32_t speed; // raw Fixed per tick, 0 if it can't move
 	unsigned icon; // unsigned as it can have different types
-	std::string name;
+	const char *name;
 	Resources cost;
 
 	// TODO add upgrade function that copies everything except hp
 };
 
-struct EntityStats final {
-	EntityType type;
-	unsigned hp, maxhp;
-	unsigned attack, attack_bld;
+static constexpr EntityInfo unit_info(EntityType type, float size, unsigned atk, unsigned atk_bld, io::UnitIcon icon, const char *name, const UnitStats &s) {
+	return EntityInfo{ type, size, s.hp, atk, atk_bld, (float)s.range, unit_speed(s.speed), (unsigned)icon, name, s.cost };
+}
 
-	EntityStats(const EntityInfo &i) : type(i.type), hp(i.hp), maxhp(i.hp), attack(i.atk), attack_bld(i.atk_bld) {}
-};
+static constexpr EntityInfo entity_info_of(EntityType type, float size, unsigned hp, unsigned icon, const char *name, Resources cost=Resources()) {
+	return EntityInfo{ type, size, hp, 0, 0, 0, 0, icon, name, cost };
+}
+
+inline constexpr std::array<EntityBldInfo, 2> entity_bld_info {{
+	{EntityType::town_center, io::DrsId::bld_town_center, io::DrsId::bld_town_center_player, io::DrsId::bld_debris},
+	{EntityType::barracks, io::DrsId::bld_barracks, io::DrsId::bld_barracks, io::DrsId::bld_debris},
+}};
+
+inline constexpr std::array<EntityImgInfo, 9> entity_img_info {{
+	// alive, dying, decaying, attack, attack_follow, moving
+	// alive, dying, ii_dying, decaying, ii_decaying, attack, ii_attack, attack_follow, moving
+	// dying, decaying, attack, attack_follow, moving, alive
+	{EntityType::bird1, 12, 12, 0, 12, 12, 0, 12, 12, io::DrsId::gif_bird1, io::DrsId::gif_bird1, io::DrsId::gif_bird1, io::DrsId::gif_bird1, io::DrsId::gif_bird1, io::DrsId::gif_bird1},
+	{EntityType::villager, 6, 10, 10-1, 6, 15, 15-1, 15, 15, io::DrsId::gif_villager_die1, io::DrsId::gif_villager_decay, io::DrsId::gif_villager_attack, io::DrsId::gif_villager_move, io::DrsId::gif_villager_move, io::DrsId::gif_villager_stand},
+	{EntityType::worker_wood1, 6, 10, 10-1, 6, 11, 11-1, 15, 15, io::DrsId::gif_worker_wood_die, io::DrsId::gif_worker_wood_decay, io::DrsId::gif_worker_wood_attack1, io::DrsId::gif_worker_wood_move, io::DrsId::gif_worker_wood_move, io::DrsId::gif_worker_wood_stand},
+	{EntityType::worker_wood2, 6, 10, 10-1, 6, 11, 11-1, 15, 15, io::DrsId::gif_worker_wood_die, io::DrsId::gif_worker_wood_decay, io::DrsId::gif_worker_wood_attack2, io::DrsId::gif_worker_wood_move, io::DrsId::gif_worker_wood_move, io::DrsId::gif_worker_wood_stand},
+	{EntityType::worker_gold, 6, 10, 10-1, 6, 11, 11-1, 15, 15, io::DrsId::gif_worker_miner_die, io::DrsId::gif_worker_miner_decay, io::DrsId::gif_worker_miner_attack, io::DrsId::gif_worker_miner_move, io::DrsId::gif_worker_miner_move, io::DrsId::gif_worker_miner_stand},
+	{EntityType::worker_stone, 6, 10, 10-1, 6, 11, 11-1, 15, 15, io::DrsId::gif_worker_miner_die, io::DrsId::gif_worker_miner_decay, io::DrsId::gif_worker_miner_attack, io::DrsId::gif_worker_miner_move, io::DrsId::gif_worker_miner_move, io::DrsId::gif_worker_miner_stand},
+	{EntityType::worker_berries, 6, 10, 10-1, 6, 27, 19, 15, 15, io::DrsId::gif_villager_die1, io::DrsId::gif_villager_decay, io::DrsId::gif_worker_berries_attack, io::DrsId::gif_villager_move, io::DrsId::gif_villager_move, io::DrsId::gif_villager_stand},
+	{EntityType::melee1, 6, 10, 10-1, 6, 15, 15-1, 15, 15, io::DrsId::gif_melee1_die, io::DrsId::gif_melee1_decay, io::DrsId::gif_melee1_attack, io::DrsId::gif_melee1_move, io::DrsId::gif_melee1_move, io::DrsId::gif_melee1_stand},
+	{EntityType::priest, 10, 10, 10-1, 6, 10, 10-1, 15, 15, io::DrsId::gif_priest_die, io::DrsId::gif_priest_decay, io::DrsId::gif_priest_attack, io::DrsId::gif_priest_move, io::DrsId::gif_priest_move, io::DrsId::gif_priest_stand},
+}};
+
+inline constexpr std::array<EntityInfo, (size_t)EntityType::max> entity_info {{
+	entity_info_of(EntityType::town_center, 3, 600, (unsigned)io::BldIcon::towncenter1, "Town Center", Resources(200, 0, 0, 0)),
+	entity_info_of(EntityType::barracks, 3, 350, (unsigned)io::BldIcon::barracks1, "Barracks", Resources(150, 0, 0, 0)),
+	EntityInfo{ EntityType::bird1, 5, 1, 0, 0, 0, unit_speed(UnitSpeed::medium), (unsigned)io::UnitIcon::villager, "Bird", Resources() },
+	unit_info(EntityType::villager, 5, unit_stats_of("Villager").attack, 1, io::UnitIcon::villager, "Villager", unit_stats_of("Villager")),
+	unit_info(EntityType::worker_wood1, 5, 3, 1, io::UnitIcon::villager, "Lumberjack", unit_stats_of("Villager")), // attacking tree
+	unit_info(EntityType::worker_wood2, 5, 1, 1, io::UnitIcon::villager, "Lumberjack", unit_stats_of("Villager")), // gather wood
+	unit_info(EntityType::worker_gold, 5, 1, 1, io::UnitIcon::villager, "Gold Miner", unit_stats_of("Villager")), // gather gold
+	unit_info(EntityType::worker_stone, 5, 1, 1, io::UnitIcon::villager, "Stone Miner", unit_stats_of("Villager")), // gather stone
+	unit_info(EntityType::worker_berries, 5, 1, 1, io::UnitIcon::villager, "Forager", unit_stats_of("Villager")), // gather food
+	unit_info(EntityType::melee1, 5, unit_stats_of("Clubman").attack, 1, io::UnitIcon::melee1, "Clubman", unit_stats_of("Clubman")),
+	// a priest converts units and does not deal damage while converting
+	unit_info(EntityType::priest, 5, 0, 0, io::UnitIcon::priest, "Priest", unit_stats_of("Priest")),
+	// hp for berries refers to amount of food
+	entity_info_of(EntityType::berries, 8, 150, (unsigned)io::UnitIcon::food, "Berry Bush"),
+	entity_info_of(EntityType::gold, 12, 400, (unsigned)io::UnitIcon::gold, "Gold"),
+	entity_info_of(EntityType::stone, 12, 250, (unsigned)io::UnitIcon::stone, "Stone"),
+	entity_info_of(EntityType::desert_tree1, 5, 25, (unsigned)io::UnitIcon::wood, "Tree - Palm"),
+	entity_info_of(EntityType::desert_tree2, 5, 25, (unsigned)io::UnitIcon::wood, "Tree - Palm"),
+	entity_info_of(EntityType::desert_tree3, 5, 25, (unsigned)io::UnitIcon::wood, "Tree - Palm"),
+	entity_info_of(EntityType::desert_tree4, 5, 25, (unsigned)io::UnitIcon::wood, "Tree - Palm"),
+	entity_info_of(EntityType::grass_tree1, 5, 25, (unsigned)io::UnitIcon::wood, "Tree - Forest"),
+	entity_info_of(EntityType::grass_tree2, 5, 25, (unsigned)io::UnitIcon::wood, "Tree - Forest"),
+	entity_info_of(EntityType::grass_tree3, 5, 25, (unsigned)io::UnitIcon::wood, "Tree - Forest"),
+	entity_info_of(EntityType::grass_tree4, 5, 25, (unsigned)io::UnitIcon::wood, "Tree - Forest"),
+	// hp for tree refers to amount of wood
+	entity_info_of(EntityType::dead_tree1, 5, 40, (unsigned)io::UnitIcon::wood, "Tree"),
+	entity_info_of(EntityType::dead_tree2, 5, 40, (unsigned)io::UnitIcon::wood, "Tree"),
+}};
+
+static constexpr bool entity_info_complete() noexcept {
+	for (size_t i = 0; i < entity_info.size(); ++i)
+		if ((size_t)entity_info[i].type != i)
+			return false;
+
+	return true;
+}
+
+static_assert(entity_info_complete(), "entity_info must have one row for every EntityType in order");
 
-extern const std::vector<EntityInfo> entity_info;
-extern const std::vector<EntityImgInfo> entity_img_info;
-extern const std::vector<EntityBldInfo> entity_bld_info;
+static constexpr const EntityInfo &entity_type_info(EntityType t) noexcept {
+	return entity_info[(unsigned)t];
+}
 
 }
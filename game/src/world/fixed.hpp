@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstdint>
+
+namespace aoe {
+
+/**
+ * 16.16 fixed point number for simulation state. Integer math gives the same results on every
+ * peer, which is not guaranteed for floats when compilers or math libraries differ.
+ * Converts to float implicitly, so drawing and sending it doesn't care. Going the other way has
+ * to be explicit to make sure floats don't sneak back into the simulation by accident.
+ */
+class Fixed final {
+public:
+	int32_t raw;
+
+	static constexpr unsigned frac_bits = 16;
+	static constexpr int32_t one = 1 << frac_bits;
+
+	constexpr Fixed() noexcept : raw(0) {}
+	explicit constexpr Fixed(float v) noexcept : raw((int32_t)((double)v * one + (v < 0 ? -0.5 : 0.5))) {}
+
+	static constexpr Fixed from_raw(int32_t raw) noexcept {
+		Fixed f;
+		f.raw = raw;
+		return f;
+	}
+
+	constexpr operator float() const noexcept { return raw / (float)one; }
+
+	friend constexpr bool operator==(Fixed lhs, Fixed rhs) noexcept { return lhs.raw == rhs.raw; }
+	friend constexpr bool operator!=(Fixed lhs, Fixed rhs) noexcept { return lhs.raw != rhs.raw; }
+	friend constexpr bool operator<(Fixed lhs, Fixed rhs) noexcept { return lhs.raw < rhs.raw; }
+};
+
+/** Integer square root, rounded down. */
+constexpr uint64_t isqrt(uint64_t v) noexcept {
+	uint64_t r = 0;
+
+	for (uint64_t bit = UINT64_C(1) << 62; bit; bit >>= 2) {
+		if (v >= r + bit) {
+			v -= r + bit;
+			r = (r >> 1) + bit;
+		} else {
+			r >>= 1;
+		}
+	}
+
+	return r;
+}
+
+static_assert(isqrt(0) == 0 && isqrt(15) == 3 && isqrt(16) == 4 && isqrt(UINT64_MAX) == UINT32_MAX);
+static_assert(Fixed(1.5f).raw == 3 * Fixed::one / 2 && Fixed(-0.25f).raw == -Fixed::one / 4);
+
+}
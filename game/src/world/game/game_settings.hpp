@@ -52,6 +52,7 @@ public:
 	bool wrap;
 	bool restricted; // allow other players to also change settings
 	bool reorder; // allow to move players up and down in the list
+	bool lockstep; // peers tick the world themselves and only exchange inputs
 	unsigned width, height;
 	unsigned popcap;
 	int age;
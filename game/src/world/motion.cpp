@@ -0,0 +1,153 @@
+#include "motion.hpp"
+
+#include <cmath>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+
+#include <tracy/Tracy.hpp>
+
+namespace aoe {
+
+float angle_of(int64_t dx, int64_t dy) noexcept {
+	int64_t ax = dx < 0 ? -dx : dx, ay = dy < 0 ? -dy : dy;
+	if (!ax && !ay)
+		return 0;
+
+	// reduce to first octant: z = tan(a) in 16.16
+	bool steep = ay > ax;
+	int64_t z = steep ? (ax << 16) / ay : (ay << 16) / ax;
+
+	// atan(z) ~ pi/4 z + 0.273 z (1 - z) in units of 2pi/65536
+	int64_t a = (8192 * z + 2847 * z * (65536 - z) / 65536) >> 16;
+
+	if (steep)
+		a = 16384 - a;
+	if (dx < 0)
+		a = 32768 - a;
+	if (dy < 0)
+		a = 65536 - a;
+
+	return (float)((a & 0xffff) * (2 * M_PI / 65536));
+}
+
+void EntityMotion::clear() noexcept {
+	row.clear();
+	x.clear(); y.clear();
+	wx.clear(); wy.clear();
+	dx.clear(); dy.clear();
+	ticks.clear();
+	arrived.clear();
+}
+
+void EntityMotion::add(uint32_t row, Fixed x, Fixed y, Fixed wx, Fixed wy, Fixed dx, Fixed dy, uint32_t ticks) {
+	this->row.emplace_back(row);
+	this->x.emplace_back(x.raw);
+	this->y.emplace_back(y.raw);
+	this->wx.emplace_back(wx.raw);
+	this->wy.emplace_back(wy.raw);
+	this->dx.emplace_back(dx.raw);
+	this->dy.emplace_back(dy.raw);
+	this->ticks.emplace_back((int32_t)ticks);
+	arrived.emplace_back(0);
+}
+
+/*
+ * All lanes are int32, so SSE2 does 4 and AVX2 does 8 lanes at once. No floats here: peers in
+ * a lockstep game must agree on every bit, whatever instruction set they happen to use.
+ */
+void EntityMotion::step() noexcept {
+	ZoneScoped;
+	size_t n = size(), i = 0;
+	int32_t *x = this->x.data(), *y = this->y.data(), *ticks = this->ticks.data(), *arrived = this->arrived.data();
+	const int32_t *wx = this->wx.data(), *wy = this->wy.data(), *dx = this->dx.data(), *dy = this->dy.data();
+
+#if defined(__AVX2__)
+	const __m256i one = _mm256_set1_epi32(1);
+
+	for (; i + 8 <= n; i += 8) {
+		__m256i t = _mm256_sub_epi32(_mm256_loadu_si256((const __m256i*)(ticks + i)), one);
+		__m256i done = _mm256_cmpgt_epi32(one, t); // t <= 0
+
+		__m256i nx = _mm256_add_epi32(_mm256_loadu_si256((const __m256i*)(x + i)), _mm256_loadu_si256((const __m256i*)(dx + i)));
+		__m256i ny = _mm256_add_epi32(_mm256_loadu_si256((const __m256i*)(y + i)), _mm256_loadu_si256((const __m256i*)(dy + i)));
+
+		nx = _mm256_blendv_epi8(nx, _mm256_loadu_si256((const __m256i*)(wx + i)), done);
+		ny = _mm256_blendv_epi8(ny, _mm256_loadu_si256((const __m256i*)(wy + i)), done);
+
+		_mm256_storeu_si256((__m256i*)(x + i), nx);
+		_mm256_storeu_si256((__m256i*)(y + i), ny);
+		_mm256_storeu_si256((__m256i*)(ticks + i), t);
+		_mm256_storeu_si256((__m256i*)(arrived + i), _mm256_and_si256(done, one));
+	}
+#elif defined(__SSE2__) || defined(_M_X64)
+	const __m128i one = _mm_set1_epi32(1);
+
+	for (; i + 4 <= n; i += 4) {
+		__m128i t = _mm_sub_epi32(_mm_loadu_si128((const __m128i*)(ticks + i)), one);
+		__m128i done = _mm_cmplt_epi32(t, one); // t <= 0
+
+		__m128i nx = _mm_add_epi32(_mm_loadu_si128((const __m128i*)(x + i)), _mm_loadu_si128((const __m128i*)(dx + i)));
+		__m128i ny = _mm_add_epi32(_mm_loadu_si128((const __m128i*)(y + i)), _mm_loadu_si128((const __m128i*)(dy + i)));
+
+		// no blendv in SSE2
+		nx = _mm_or_si128(_mm_andnot_si128(done, nx), _mm_and_si128(done, _mm_loadu_si128((const __m128i*)(wx + i))));
+		ny = _mm_or_si128(_mm_andnot_si128(done, ny), _mm_and_si128(done, _mm_loadu_si128((const __m128i*)(wy + i))));
+
+		_mm_storeu_si128((__m128i*)(x + i), nx);
+		_mm_storeu_si128((__m128i*)(y + i), ny);
+		_mm_storeu_si128((__m128i*)(ticks + i), t);
+		_mm_storeu_si128((__m128i*)(arrived + i), _mm_and_si128(done, one));
+	}
+#endif
+
+	for (; i < n; ++i) {
+		int32_t done = --ticks[i] <= 0;
+
+		x[i] = done ? wx[i] : x[i] + dx[i];
+		y[i] = done ? wy[i] : y[i] + dy[i];
+		arrived[i] = done;
+	}
+}
+
+void EntityAnim::clear() noexcept {
+	row.clear();
+	subimage.clear();
+	base.clear(); mult.clear();
+	wrap_inc.clear(); clamp_inc.clear(); cap.clear();
+	lo.clear(); hi.clear();
+	more.clear();
+}
+
+void EntityAnim::add(uint32_t row, float subimage, const AnimStep &a) {
+	this->row.emplace_back(row);
+	this->subimage.emplace_back(subimage);
+	base.emplace_back(a.base);
+	mult.emplace_back(a.mult);
+	wrap_inc.emplace_back(a.wrap_inc);
+	clamp_inc.emplace_back(a.clamp_inc);
+	cap.emplace_back(a.cap);
+	lo.emplace_back(a.lo);
+	hi.emplace_back(a.hi);
+	more.emplace_back(1);
+}
+
+void EntityAnim::advance() noexcept {
+	ZoneScoped;
+	size_t n = size();
+	float *sub = subimage.data();
+	const float *base = this->base.data(), *mult = this->mult.data(), *wrap_inc = this->wrap_inc.data();
+	const float *clamp_inc = this->clamp_inc.data(), *cap = this->cap.data(), *lo = this->lo.data(), *hi = this->hi.data();
+	int32_t *more = this->more.data();
+
+	for (size_t i = 0; i < n; ++i) {
+		bool m;
+		sub[i] = advance(sub[i], base[i], mult[i], wrap_inc[i], clamp_inc[i], cap[i], lo[i], hi[i], m);
+		more[i] = m;
+	}
+}
+
+}
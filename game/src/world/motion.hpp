@@ -0,0 +1,96 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "fixed.hpp"
+
+namespace aoe {
+
+/** Angle of (\a dx, \a dy) in [0, 2pi) using integer math only, so it is the same on every peer. */
+float angle_of(int64_t dx, int64_t dy) noexcept;
+
+/**
+ * Hot fields of all units that walk this tick, stored as structure of arrays so EntityMotion::step
+ * runs over contiguous arrays. Every lane refers to the tick buffer row of its entity, which
+ * refers to the dense slot in World::entities. Entity stays the authoritative record:
+ * World::tick_range copies the fields in, runs the kernel and copies the results back.
+ *
+ * Units walk in straight legs. Entity::walk determines direction and facing once per leg, so
+ * stepping is just adding the cached step and snapping to the end of the leg when it's done.
+ */
+class EntityMotion final {
+public:
+	std::vector<uint32_t> row;
+	std::vector<int32_t> x, y, wx, wy, dx, dy; // Fixed::raw, walk from (x, y) to (wx, wy) by (dx, dy)
+	std::vector<int32_t> ticks; // left until we are at (wx, wy)
+	std::vector<int32_t> arrived;
+
+	EntityMotion() : row(), x(), y(), wx(), wy(), dx(), dy(), ticks(), arrived() {}
+
+	size_t size() const noexcept { return row.size(); }
+
+	void clear() noexcept;
+	void add(uint32_t row, Fixed x, Fixed y, Fixed wx, Fixed wy, Fixed dx, Fixed dy, uint32_t ticks);
+
+	/** Advance all lanes by one tick. */
+	void step() noexcept;
+};
+
+/** How Entity::imgtick advances subimage in the current state. */
+class AnimStep final {
+public:
+	float base, mult; // first subimage of our face, number of subimages per face
+	float wrap_inc, clamp_inc, cap; // looping animations wrap around, others stop at cap
+	float lo, hi; // the animation is done if the old subimage within the face is in [lo, hi)
+};
+
+/** Animation counterpart of EntityMotion. */
+class EntityAnim final {
+public:
+	std::vector<uint32_t> row;
+	std::vector<float> subimage, base, mult, wrap_inc, clamp_inc, cap, lo, hi;
+	std::vector<int32_t> more; // not uint8_t: char stores may alias the floats and block vectorization
+
+	EntityAnim() : row(), subimage(), base(), mult(), wrap_inc(), clamp_inc(), cap(), lo(), hi(), more() {}
+
+	size_t size() const noexcept { return row.size(); }
+
+	void clear() noexcept;
+	void add(uint32_t row, float subimage, const AnimStep&);
+
+	/** Advance all lanes by one imgtick. */
+	void advance() noexcept;
+
+	/**
+	 * \a v modulo \a m for non-negative \a v. Unlike fmodf, this is just a few float ops
+	 * the compiler can vectorize.
+	 */
+	static float wrap(float v, float m) noexcept {
+		float r = v - (float)(int32_t)(v / m) * m;
+		// fix up rounding errors. no ?: here: gcc won't if-convert float selects under -ftrapping-math
+		int32_t neg = r < 0;
+		r += m * (float)neg;
+		int32_t over = r >= m;
+		return r - m * (float)over;
+	}
+
+	/** Returns new subimage and sets \a more to whether the animation has frames left. */
+	static float advance(float subimage, float base, float mult, float wrap_inc, float clamp_inc, float cap, float lo, float hi, bool &more) noexcept {
+		float r = wrap(subimage, mult);
+		more = (r < lo) | (r >= hi);
+
+		r = wrap(r + wrap_inc, mult);
+		r = std::min(r + clamp_inc, cap);
+
+		return r + base;
+	}
+
+	static float advance(float subimage, const AnimStep &a, bool &more) noexcept {
+		return advance(subimage, a.base, a.mult, a.wrap_inc, a.clamp_inc, a.cap, a.lo, a.hi, more);
+	}
+};
+
+}
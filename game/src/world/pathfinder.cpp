@@ -0,0 +1,596 @@
+#include "pathfinder.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdlib>
+#include <functional>
+#include <queue>
+
+#include <tracy/Tracy.hpp>
+
+namespace aoe {
+
+static constexpr unsigned cost_straight = 10, cost_diagonal = 14;
+
+static const int dirs[8][2] = {
+	{ 1, 0 }, { -1, 0 }, { 0, 1 }, { 0, -1 },
+	{ 1, 1 }, { 1, -1 }, { -1, 1 }, { -1, -1 },
+};
+
+/** Cost estimate on a grid that allows diagonal moves. */
+static unsigned octile(int dx, int dy) {
+	dx = abs(dx);
+	dy = abs(dy);
+	return cost_straight * std::max(dx, dy) + (cost_diagonal - cost_straight) * std::min(dx, dy);
+}
+
+typedef std::priority_queue<std::pair<unsigned, unsigned>, std::vector<std::pair<unsigned, unsigned>>, std::greater<std::pair<unsigned, unsigned>>> OpenList;
+
+Pathfinder::Pathfinder()
+	: pass(), nodes(), cluster_nodes(), node_at(), cache(), free_nodes(), requests(), w(0), h(0), cw(0), ch(0)
+	, lg(), ag(), sdist(), gdist(), tiles(), lparent(), aparent(), lclosed(), aclosed()
+	, paths(), expanded(0), cache_hits(0), cache_misses(0) {}
+
+unsigned Pathfinder::tile(float x, float y) const noexcept {
+	unsigned tx = x > 0 ? std::min((unsigned)x, w - 1) : 0;
+	unsigned ty = y > 0 ? std::min((unsigned)y, h - 1) : 0;
+	return ty * w + tx;
+}
+
+unsigned Pathfinder::cluster(unsigned t) const noexcept {
+	return (t / w / cluster_size) * cw + t % w / cluster_size;
+}
+
+/** Find closest passable tile within one cluster size of \a t. */
+unsigned Pathfinder::snap(unsigned t) const noexcept {
+	if (pass[t])
+		return t;
+
+	int x = t % w, y = t / w;
+
+	for (int r = 1; r <= (int)cluster_size; ++r) {
+		unsigned best = no_path, dbest = UINT_MAX;
+
+		for (int yy = y - r; yy <= y + r; ++yy) {
+			if (yy < 0 || yy >= (int)h)
+				continue;
+
+			// only visit the perimeter of this ring
+			int step = (yy == y - r || yy == y + r) ? 1 : 2 * r;
+
+			for (int xx = x - r; xx <= x + r; xx += step) {
+				if (xx < 0 || xx >= (int)w || !pass[yy * w + xx])
+					continue;
+
+				unsigned d = (xx - x) * (xx - x) + (yy - y) * (yy - y);
+				if (d < dbest) {
+					dbest = d;
+					best = yy * w + xx;
+				}
+			}
+		}
+
+		if (best != no_path)
+			return best;
+	}
+
+	return no_path;
+}
+
+void Pathfinder::reset(const Terrain &t) {
+	ZoneScoped;
+
+	w = t.w;
+	h = t.h;
+	cw = (w + cluster_size - 1) / cluster_size;
+	ch = (h + cluster_size - 1) / cluster_size;
+
+	pass.resize((size_t)w * h);
+
+	for (unsigned y = 0; y < h; ++y)
+		for (unsigned x = 0; x < w; ++x)
+			pass[y * w + x] = t.passable(x, y);
+
+	nodes.clear();
+	free_nodes.clear();
+	cluster_nodes.assign((size_t)cw * ch, std::vector<unsigned>());
+	node_at.assign((size_t)w * h, -1);
+	cache.clear();
+
+	// find entrances between neighbouring clusters
+	for (unsigned cy = 0; cy < ch; ++cy) {
+		for (unsigned cx = 0; cx < cw; ++cx) {
+			if (cx + 1 < cw)
+				add_border(cx, cy, true);
+
+			if (cy + 1 < ch)
+				add_border(cx, cy, false);
+		}
+	}
+
+	// connect all entrances within each cluster
+	for (unsigned c = 0; c < cluster_nodes.size(); ++c)
+		connect(c);
+}
+
+void Pathfinder::update(const Terrain &t, unsigned x, unsigned y, unsigned aw, unsigned ah) {
+	ZoneScoped;
+
+	if (t.w != w || t.h != h) {
+		reset(t);
+		return;
+	}
+
+	if (!aw || !ah || x >= w || y >= h)
+		return;
+
+	unsigned x1 = std::min(w, x + aw), y1 = std::min(h, y + ah);
+
+	for (unsigned yy = y; yy < y1; ++yy)
+		for (unsigned xx = x; xx < x1; ++xx)
+			pass[yy * w + xx] = t.passable(xx, yy);
+
+	// the entrances on all borders of the changed clusters may have moved and with them
+	// the edges of the clusters next to them. rebuild all of them
+	unsigned cx0 = x / cluster_size, cy0 = y / cluster_size;
+	unsigned cx1 = std::min(cw - 1, (x1 - 1) / cluster_size + 1), cy1 = std::min(ch - 1, (y1 - 1) / cluster_size + 1);
+
+	cx0 = cx0 ? cx0 - 1 : 0;
+	cy0 = cy0 ? cy0 - 1 : 0;
+
+	for (unsigned cy = cy0; cy <= cy1; ++cy) {
+		for (unsigned cx = cx0; cx <= cx1; ++cx) {
+			std::vector<unsigned> &lst = cluster_nodes[cy * cw + cx];
+
+			for (unsigned n : lst) {
+				node_at[nodes[n].tile] = -1;
+				nodes[n] = Node(no_path, no_path);
+				free_nodes.emplace_back(n);
+			}
+
+			lst.clear();
+		}
+	}
+
+	// entrances just outside keep their index, but lose their edges into the rebuilt clusters
+	for (unsigned cy = cy0 ? cy0 - 1 : 0; cy <= std::min(ch - 1, cy1 + 1); ++cy) {
+		for (unsigned cx = cx0 ? cx0 - 1 : 0; cx <= std::min(cw - 1, cx1 + 1); ++cx) {
+			if (cx >= cx0 && cx <= cx1 && cy >= cy0 && cy <= cy1)
+				continue;
+
+			for (unsigned n : cluster_nodes[cy * cw + cx]) {
+				std::vector<Edge> &edges = nodes[n].edges;
+				edges.erase(std::remove_if(edges.begin(), edges.end(), [this](const Edge &e) { return nodes[e.to].tile == no_path; }), edges.end());
+			}
+		}
+	}
+
+	for (unsigned cy = cy0; cy <= cy1; ++cy) {
+		for (unsigned cx = cx0; cx <= cx1; ++cx) {
+			if (cx + 1 < cw)
+				add_border(cx, cy, true);
+
+			if (cy + 1 < ch)
+				add_border(cx, cy, false);
+
+			if (cx == cx0 && cx > 0)
+				add_border(cx - 1, cy, true);
+
+			if (cy == cy0 && cy > 0)
+				add_border(cx, cy - 1, false);
+		}
+	}
+
+	for (unsigned cy = cy0; cy <= cy1; ++cy)
+		for (unsigned cx = cx0; cx <= cx1; ++cx)
+			connect(cy * cw + cx);
+
+	cache.clear();
+}
+
+unsigned Pathfinder::add_node(unsigned x, unsigned y) {
+	unsigned t = y * w + x;
+
+	if (node_at[t] >= 0)
+		return node_at[t];
+
+	unsigned n;
+
+	if (free_nodes.empty()) {
+		n = nodes.size();
+		nodes.emplace_back(t, cluster(t));
+	} else {
+		n = free_nodes.back();
+		free_nodes.pop_back();
+		nodes[n] = Node(t, cluster(t));
+	}
+
+	cluster_nodes[nodes[n].cluster].emplace_back(n);
+	node_at[t] = n;
+
+	return n;
+}
+
+/** Add entrances between cluster (\a cx, \a cy) and the one to the right of it or below it. */
+void Pathfinder::add_border(unsigned cx, unsigned cy, bool right) {
+	unsigned x = cx * cluster_size, y = cy * cluster_size;
+
+	if (right)
+		add_entrances(x + cluster_size - 1, y, 0, 1, std::min(cluster_size, h - y), 1, 0);
+	else
+		add_entrances(x, y + cluster_size - 1, 1, 0, std::min(cluster_size, w - x), 0, 1);
+}
+
+/** Connect all entrances within cluster \a c. */
+void Pathfinder::connect(unsigned c) {
+	for (unsigned a : cluster_nodes[c]) {
+		flood(c, nodes[a].tile, sdist);
+
+		for (unsigned b : cluster_nodes[c])
+			if (b != a && sdist[b] != no_path)
+				nodes[a].edges.emplace_back(b, sdist[b]);
+	}
+}
+
+/**
+ * Scan \a len tiles from (\a x, \a y) in direction (\a dx, \a dy) and add an entrance in the middle
+ * of every run where both the tile and its neighbour at offset (\a ox, \a oy) are passable.
+ */
+void Pathfinder::add_entrances(unsigned x, unsigned y, unsigned dx, unsigned dy, unsigned len, unsigned ox, unsigned oy) {
+	unsigned start = 0;
+	bool run = false;
+
+	for (unsigned i = 0; i <= len; ++i) {
+		unsigned px = x + i * dx, py = y + i * dy;
+		bool open = i < len && pass[py * w + px] && pass[(py + oy) * w + px + ox];
+
+		if (open && !run) {
+			start = i;
+			run = true;
+		} else if (!open && run) {
+			unsigned mid = (start + i - 1) / 2;
+			unsigned mx = x + mid * dx, my = y + mid * dy;
+
+			unsigned a = add_node(mx, my), b = add_node(mx + ox, my + oy);
+			nodes[a].edges.emplace_back(b, cost_straight);
+			nodes[b].edges.emplace_back(a, cost_straight);
+
+			run = false;
+		}
+	}
+}
+
+/**
+ * A* from tile \a s to \a g without leaving cluster \a c. If \a g is no_path, just compute the
+ * cost to every tile in the cluster. Appends the tiles after \a s up to and including \a g to \a out.
+ */
+unsigned Pathfinder::local(unsigned c, unsigned s, unsigned g, std::vector<unsigned> *out) {
+	unsigned x0 = (c % cw) * cluster_size, y0 = (c / cw) * cluster_size;
+	unsigned rw = std::min(cluster_size, w - x0), rh = std::min(cluster_size, h - y0);
+	size_t n = (size_t)rw * rh;
+
+	lg.assign(n, no_path);
+	lparent.assign(n, -1);
+	lclosed.assign(n, 0);
+
+	int gx = g % w, gy = g / w;
+	bool all = g == no_path;
+
+	auto to_local = [&](unsigned t) { return (t / w - y0) * rw + t % w - x0; };
+	auto heuristic = [&](int x, int y) { return all ? 0 : octile(x - gx, y - gy); };
+
+	OpenList open;
+	unsigned si = to_local(s), gi = all ? no_path : to_local(g);
+
+	lg[si] = 0;
+	open.emplace(heuristic(s % w, s / w), si);
+
+	while (!open.empty()) {
+		unsigned i = open.top().second;
+		open.pop();
+
+		if (lclosed[i])
+			continue;
+
+		lclosed[i] = 1;
+		++expanded;
+
+		if (i == gi)
+			break;
+
+		int x = x0 + i % rw, y = y0 + i / rw;
+
+		for (unsigned d = 0; d < 8; ++d) {
+			int nx = x + dirs[d][0], ny = y + dirs[d][1];
+
+			if (nx < (int)x0 || ny < (int)y0 || nx >= (int)(x0 + rw) || ny >= (int)(y0 + rh) || !pass[ny * w + nx])
+				continue;
+
+			// don't cut corners
+			if (d >= 4 && (!pass[y * w + nx] || !pass[ny * w + x]))
+				continue;
+
+			unsigned ni = (ny - y0) * rw + nx - x0;
+			unsigned cost = lg[i] + (d >= 4 ? cost_diagonal : cost_straight);
+
+			if (cost < lg[ni]) {
+				lg[ni] = cost;
+				lparent[ni] = i;
+				open.emplace(cost + heuristic(nx, ny), ni);
+			}
+		}
+	}
+
+	if (all || lg[gi] == no_path)
+		return all ? 0 : no_path;
+
+	if (out) {
+		size_t mark = out->size();
+
+		for (int i = gi; i != (int)si; i = lparent[i])
+			out->emplace_back((y0 + i / rw) * w + x0 + i % rw);
+
+		std::reverse(out->begin() + mark, out->end());
+	}
+
+	return lg[gi];
+}
+
+/** Compute cost from \a s to every entrance of cluster \a c and store it in \a dist. */
+void Pathfinder::flood(unsigned c, unsigned s, std::vector<unsigned> &dist) {
+	local(c, s, no_path, nullptr);
+
+	unsigned x0 = (c % cw) * cluster_size, y0 = (c / cw) * cluster_size;
+	unsigned rw = std::min(cluster_size, w - x0);
+
+	dist.assign(nodes.size(), no_path);
+
+	for (unsigned a : cluster_nodes[c]) {
+		unsigned t = nodes[a].tile;
+		dist[a] = lg[(t / w - y0) * rw + t % w - x0];
+	}
+}
+
+/** Find path from \a s to \a g through the abstract graph and append the refined tiles to \a out. */
+bool Pathfinder::abstract(unsigned s, unsigned g, std::vector<unsigned> &out) {
+	ZoneScoped;
+	unsigned c0 = cluster(s), c1 = cluster(g);
+	size_t mark = out.size();
+
+	auto key = std::make_pair(c0, c1);
+	auto it = cache.find(key);
+
+	if (it != cache.end()) {
+		const CachedPath &cp = it->second;
+
+		if (local(c0, s, nodes[cp.nodes.front()].tile, &out) != no_path) {
+			out.insert(out.end(), cp.tiles.begin() + 1, cp.tiles.end());
+
+			if (local(c1, nodes[cp.nodes.back()].tile, g, &out) != no_path) {
+				++cache_hits;
+				return true;
+			}
+		}
+
+		// the cached path does not connect to this start or goal
+		out.resize(mark);
+	}
+
+	++cache_misses;
+
+	flood(c0, s, sdist);
+	flood(c1, g, gdist);
+
+	size_t n = nodes.size();
+	ag.assign(n, no_path);
+	aparent.assign(n, -1);
+	aclosed.assign(n, 0);
+
+	int gx = g % w, gy = g / w;
+	auto heuristic = [&](unsigned a) { unsigned t = nodes[a].tile; return octile((int)(t % w) - gx, (int)(t / w) - gy); };
+
+	OpenList open;
+
+	for (unsigned a : cluster_nodes[c0]) {
+		if (sdist[a] == no_path)
+			continue;
+
+		ag[a] = sdist[a];
+		open.emplace(ag[a] + heuristic(a), a);
+	}
+
+	unsigned best = no_path;
+	int last = -1;
+
+	while (!open.empty()) {
+		auto [f, a] = open.top();
+		open.pop();
+
+		if (f >= best)
+			break;
+
+		if (aclosed[a])
+			continue;
+
+		aclosed[a] = 1;
+		++expanded;
+
+		if (gdist[a] != no_path && ag[a] + gdist[a] < best) {
+			best = ag[a] + gdist[a];
+			last = a;
+		}
+
+		for (const Edge &e : nodes[a].edges) {
+			unsigned cost = ag[a] + e.cost;
+
+			if (cost < ag[e.to]) {
+				ag[e.to] = cost;
+				aparent[e.to] = a;
+				open.emplace(cost + heuristic(e.to), e.to);
+			}
+		}
+	}
+
+	if (last < 0)
+		return false;
+
+	CachedPath cp;
+
+	for (int a = last; a >= 0; a = aparent[a])
+		cp.nodes.emplace_back(a);
+
+	std::reverse(cp.nodes.begin(), cp.nodes.end());
+
+	// refine abstract path
+	if (local(c0, s, nodes[cp.nodes.front()].tile, &out) == no_path)
+		return false;
+
+	// NOTE out always contains the start, so this is also correct if the start is an entrance
+	size_t first = out.size() - 1;
+
+	for (size_t i = 0; i + 1 < cp.nodes.size(); ++i) {
+		const Node &a = nodes[cp.nodes[i]], &b = nodes[cp.nodes[i + 1]];
+
+		if (a.cluster != b.cluster)
+			out.emplace_back(b.tile); // entrances are next to each other
+		else if (local(a.cluster, a.tile, b.tile, &out) == no_path)
+			return false;
+	}
+
+	cp.tiles.assign(out.begin() + first, out.end());
+
+	if (local(c1, nodes[cp.nodes.back()].tile, g, &out) == no_path)
+		return false;
+
+	if (c0 != c1) {
+		if (cache.size() >= cache_max)
+			cache.clear();
+
+		cache.emplace(key, std::move(cp));
+	}
+
+	return true;
+}
+
+/** Check whether a unit can walk in a straight line between the centres of \a a and \a b. */
+bool Pathfinder::visible(unsigned a, unsigned b) const noexcept {
+	int x = a % w, y = a / w, x1 = b % w, y1 = b / w;
+	int dx = abs(x1 - x), dy = abs(y1 - y), sx = x1 > x ? 1 : -1, sy = y1 > y ? 1 : -1;
+
+	// visit every tile the line touches
+	for (int ix = 0, iy = 0; ix < dx || iy < dy;) {
+		long d = (long)(1 + 2 * ix) * dy - (long)(1 + 2 * iy) * dx;
+
+		if (d == 0) {
+			// exactly through a corner, so don't squeeze through diagonal gaps
+			if (!pass[y * w + x + sx] || !pass[(y + sy) * w + x])
+				return false;
+
+			x += sx; ++ix;
+			y += sy; ++iy;
+		} else if (d < 0) {
+			x += sx; ++ix;
+		} else {
+			y += sy; ++iy;
+		}
+
+		if (!pass[y * w + x])
+			return false;
+	}
+
+	return true;
+}
+
+/** Turn \a tiles into waypoints, skipping tiles as long as the next one can be reached in a straight line. */
+void Pathfinder::smooth(const std::vector<unsigned> &tiles, std::vector<std::pair<float, float>> &pts) const {
+	pts.clear();
+
+	if (tiles.size() == 1)
+		pts.emplace_back(tiles[0] % w + 0.5f, tiles[0] / w + 0.5f);
+
+	for (size_t a = 0; a + 1 < tiles.size();) {
+		size_t b = a + 1;
+
+		// limit look ahead, so long straight paths don't get too expensive
+		while (b + 1 < tiles.size() && b - a < 2 * cluster_size && visible(tiles[a], tiles[b + 1]))
+			++b;
+
+		pts.emplace_back(tiles[b] % w + 0.5f, tiles[b] / w + 0.5f);
+		a = b;
+	}
+}
+
+bool Pathfinder::find(float x0, float y0, float x1, float y1, std::vector<std::pair<float, float>> &pts) {
+	ZoneScoped;
+	pts.clear();
+
+	if (!w || !h)
+		return false;
+
+	unsigned goal = tile(x1, y1);
+	unsigned s = snap(tile(x0, y0)), g = snap(goal);
+
+	if (s == no_path || g == no_path)
+		return false;
+
+	tiles.clear();
+	tiles.emplace_back(s);
+
+	unsigned c0 = cluster(s);
+	bool found = c0 == cluster(g) && local(c0, s, g, &tiles) != no_path;
+
+	if (!found) {
+		tiles.resize(1);
+		found = abstract(s, g, tiles);
+	}
+
+	if (!found)
+		return false;
+
+	smooth(tiles, pts);
+
+	// go to the exact spot if we can
+	if (g == goal)
+		pts.back() = std::make_pair(x1, y1);
+
+	return true;
+}
+
+void Pathfinder::request(IdPoolRef ref, float x0, float y0, float x1, float y1) {
+	paths.insert_or_assign(ref, Path(x0, y0, x1, y1));
+	requests.emplace_back(ref);
+}
+
+Path *Pathfinder::try_get(IdPoolRef ref) {
+	auto it = paths.find(ref);
+	return it == paths.end() ? nullptr : &it->second;
+}
+
+uint64_t Pathfinder::process(uint64_t budget) {
+	ZoneScoped;
+	uint64_t start = expanded;
+
+	while (!requests.empty() && expanded - start < budget) {
+		IdPoolRef ref = requests.front();
+		requests.pop_front();
+
+		Path *p = try_get(ref);
+		if (!p || !p->pending)
+			continue;
+
+		if (!w || !h) {
+			// no terrain: just walk straight to the destination
+			paths.erase(ref);
+			continue;
+		}
+
+		find(p->x0, p->y0, p->x1, p->y1, p->pts);
+		p->next = 0;
+		p->pending = false;
+	}
+
+	return expanded - start;
+}
+
+}
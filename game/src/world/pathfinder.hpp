@@ -0,0 +1,122 @@
+#pragma once
+
+#include <idpool.hpp>
+
+#include <climits>
+#include <deque>
+#include <map>
+#include <vector>
+
+#include "terrain.hpp"
+
+namespace aoe {
+
+/** Waypoints of a unit that has been ordered to move somewhere. */
+class Path final {
+public:
+	std::vector<std::pair<float, float>> pts; // waypoints in order, excluding the start
+	size_t next; // index of waypoint we are walking to
+	float x0, y0, x1, y1; // requested start and destination
+	bool pending; // not computed yet
+
+	Path(float x0, float y0, float x1, float y1) : pts(), next(0), x0(x0), y0(y0), x1(x1), y1(y1), pending(true) {}
+};
+
+/**
+ * Hierarchical A* over Terrain::chunk_size clusters. Cluster borders are scanned for entrances
+ * and the distances between all entrances of a cluster are precomputed, so long paths only have to
+ * search the small abstract graph and are then refined per cluster.
+ *
+ * Abstract paths are cached per (start cluster, goal cluster), so group moves only pay once.
+ * Requests are processed in order with a budget of expanded nodes. This is deterministic,
+ * unlike a time budget, so every peer computes the same paths in the same tick.
+ */
+class Pathfinder final {
+	struct Edge final {
+		unsigned to, cost;
+
+		Edge(unsigned to, unsigned cost) : to(to), cost(cost) {}
+	};
+
+	struct Node final {
+		unsigned tile, cluster;
+		std::vector<Edge> edges;
+
+		Node(unsigned tile, unsigned cluster) : tile(tile), cluster(cluster), edges() {}
+	};
+
+	struct CachedPath final {
+		std::vector<unsigned> nodes, tiles; // tiles go from first to last node
+	};
+
+	std::vector<uint8_t> pass;
+	std::vector<Node> nodes;
+	std::vector<std::vector<unsigned>> cluster_nodes;
+	std::vector<int> node_at; // node index for each tile or -1
+	std::map<std::pair<unsigned, unsigned>, CachedPath> cache;
+	std::vector<unsigned> free_nodes; // removed by update, so nodes keep their index
+	std::deque<IdPoolRef> requests;
+	unsigned w, h, cw, ch; // map size in tiles and clusters
+
+	// scratch space
+	std::vector<unsigned> lg, ag, sdist, gdist, tiles;
+	std::vector<int> lparent, aparent;
+	std::vector<uint8_t> lclosed, aclosed;
+public:
+	std::map<IdPoolRef, Path> paths;
+	uint64_t expanded, cache_hits, cache_misses;
+
+	static constexpr unsigned cluster_size = Terrain::chunk_size;
+	static constexpr unsigned no_path = UINT_MAX;
+	static constexpr size_t cache_max = 4096;
+
+	Pathfinder();
+
+	/** Rebuild graph for \a t and drop all cached paths. Takes well over half a second for a max_size map, so only do this when the game starts. */
+	void reset(const Terrain &t);
+	/**
+	 * Update the graph after the area at (\a x, \a y) of \a t has changed. Only the clusters it
+	 * touches and their neighbours are rebuilt. Cached paths are dropped.
+	 */
+	void update(const Terrain &t, unsigned x, unsigned y, unsigned w, unsigned h);
+
+	/** Queue path for \a ref from (\a x0, \a y0) to (\a x1, \a y1). Replaces any old path. */
+	void request(IdPoolRef ref, float x0, float y0, float x1, float y1);
+	Path *try_get(IdPoolRef ref);
+
+	/** Compute queued paths until at least \a budget nodes have been expanded. Returns number of expanded nodes. */
+	uint64_t process(uint64_t budget);
+
+	/** Drop all paths for which \a keep returns false. */
+	template<typename F> void retain(F keep) {
+		for (auto it = paths.begin(); it != paths.end();) {
+			if (keep(it->first))
+				++it;
+			else
+				it = paths.erase(it);
+		}
+	}
+
+	/** Compute waypoints from (\a x0, \a y0) to (\a x1, \a y1). Returns false if unreachable. */
+	bool find(float x0, float y0, float x1, float y1, std::vector<std::pair<float, float>> &pts);
+
+	size_t node_count() const noexcept { return nodes.size() - free_nodes.size(); }
+private:
+	unsigned tile(float x, float y) const noexcept;
+	unsigned cluster(unsigned tile) const noexcept;
+	unsigned snap(unsigned tile) const noexcept;
+
+	unsigned add_node(unsigned x, unsigned y);
+	void add_entrances(unsigned x, unsigned y, unsigned dx, unsigned dy, unsigned len, unsigned ox, unsigned oy);
+	void add_border(unsigned cx, unsigned cy, bool right);
+	void connect(unsigned c);
+
+	unsigned local(unsigned c, unsigned s, unsigned g, std::vector<unsigned> *out);
+	void flood(unsigned c, unsigned s, std::vector<unsigned> &dist);
+	bool abstract(unsigned s, unsigned g, std::vector<unsigned> &out);
+
+	bool visible(unsigned a, unsigned b) const noexcept;
+	void smooth(const std::vector<unsigned> &tiles, std::vector<std::pair<float, float>> &pts) const;
+};
+
+}
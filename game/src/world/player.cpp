@@ -91,8 +91,8 @@ void Player::tick_autotask(WorldView &wv) {
 			}
 
 			Entity *next_target = wv.try_get_alive(e->x, e->y, tt);
-			if (next_target)
-				e->task_attack(*next_target);
+			if (next_target && e->task_attack(*next_target))
+				wv.wake(*e);
 		}
 	}
 }
@@ -112,8 +112,10 @@ void Player::ai_gather(WorldView &wv, unsigned n, EntityType type) {
 		}
 
 		Entity *target = wv.try_get_alive(e.x, e.y, type);
-		if (target && e.task_attack(*target))
+		if (target && e.task_attack(*target)) {
+			wv.wake(e);
 			--n;
+		}
 	}
 }
 
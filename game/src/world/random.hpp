@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstdint>
+
+namespace aoe {
+
+/**
+ * Seeded PCG32 random number generator for anything that affects the simulation. Unlike rand()
+ * and the std distributions, this gives the same numbers with every compiler and standard library.
+ */
+class Random final {
+	uint64_t state;
+public:
+	Random(uint64_t seed=0) noexcept : state(0) {
+		this->seed(seed);
+	}
+
+	void seed(uint64_t seed) noexcept {
+		state = 0;
+		next();
+		state += seed;
+		next();
+	}
+
+	uint32_t next() noexcept {
+		uint64_t old = state;
+		state = old * UINT64_C(6364136223846793005) + UINT64_C(1442695040888963407);
+
+		uint32_t xorshifted = (uint32_t)(((old >> 18) ^ old) >> 27);
+		uint32_t rot = (uint32_t)(old >> 59);
+
+		return (xorshifted >> rot) | (xorshifted << ((32 - rot) & 31));
+	}
+
+	/** Uniform integer in [0, \a n). */
+	unsigned below(unsigned n) noexcept {
+		return (unsigned)((uint64_t)next() * n >> 32);
+	}
+
+	/** Uniform real number in [\a lo, \a hi). */
+	double real(double lo, double hi) noexcept {
+		return lo + (hi - lo) * (next() / 4294967296.0);
+	}
+
+	uint64_t get_state() const noexcept { return state; }
+};
+
+}
@@ -0,0 +1,221 @@
+#include "../server.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <iterator>
+
+#ifndef _WIN32
+#include <arpa/inet.h>
+#endif
+
+namespace aoe {
+
+/*
+ * A replay is a header followed by the same packets the server would send to clients:
+ * scenario settings, final player settings and who controls them, and then lockstep frames
+ * interleaved with state hashes. Replays are stored in network byte order, so they can be
+ * played on any machine that runs the same build.
+ */
+
+ReplayWriter::ReplayWriter(const std::string &path, const ScenarioSettings &scn)
+	: out(path, std::ios::binary | std::ios::trunc), buf(), pending(0, 0)
+{
+	ZoneScoped;
+	if (!out)
+		throw std::runtime_error(std::string("cannot create replay: ") + path);
+
+	uint32_t hdr[2] = { htonl(magic), htonl(version) };
+	out.write((const char*)hdr, sizeof hdr);
+
+	NetPkg pkg;
+
+	pkg.set_scn_vars(scn);
+	put(pkg);
+
+	pkg.set_player_resize(scn.players.size());
+	put(pkg);
+
+	for (unsigned i = 0; i < scn.players.size(); ++i) {
+		const PlayerSetting &p = scn.players[i];
+
+		pkg.set_player_name(i, p.name);
+		put(pkg);
+		pkg.set_player_civ(i, p.civ);
+		put(pkg);
+		pkg.set_player_team(i, p.team);
+		put(pkg);
+		pkg.set_player_type(i, p.type);
+		put(pkg);
+	}
+
+	for (auto &kv : scn.owners) {
+		pkg.set_claim_player(kv.first, kv.second);
+		put(pkg);
+	}
+}
+
+ReplayWriter::~ReplayWriter() {
+	try {
+		close();
+	} catch (std::runtime_error &e) {
+		fprintf(stderr, "%s: %s\n", __func__, e.what());
+	}
+}
+
+void ReplayWriter::put(NetPkg &pkg) {
+	buf.clear();
+	pkg.write(buf);
+	out.write((const char*)buf.data(), buf.size());
+}
+
+void ReplayWriter::flush_frame() {
+	if (!pending.steps && pending.inputs.empty())
+		return;
+
+	NetPkg pkg;
+	size_t i = 0;
+
+	do {
+		i += pkg.set_lockstep_frame(pending.tick, pending.steps, pending.inputs, i);
+		put(pkg);
+	} while (i < pending.inputs.size());
+
+	pending.steps = 0;
+	pending.inputs.clear();
+}
+
+void ReplayWriter::frame(uint32_t tick, unsigned steps, const std::vector<WorldEvent> &inputs) {
+	ZoneScoped;
+	// just tick longer if nothing has happened since the pending frame
+	if (inputs.empty() && pending.tick + pending.steps == tick && pending.steps + steps <= UINT16_MAX) {
+		pending.steps += steps;
+		return;
+	}
+
+	flush_frame();
+
+	pending.tick = tick;
+	pending.steps = steps;
+	pending.inputs = inputs;
+}
+
+void ReplayWriter::hash(uint32_t tick, uint64_t hash) {
+	// keep hashes after the frame that got us there, so a truncated replay still lines up
+	flush_frame();
+
+	NetPkg pkg;
+	pkg.set_state_hash(NetStateHash(tick, hash));
+	put(pkg);
+}
+
+void ReplayWriter::close() {
+	if (!out.is_open())
+		return;
+
+	flush_frame();
+	out.close();
+
+	if (!out)
+		throw std::runtime_error("cannot write replay");
+}
+
+void Replay::load(const std::string &path) {
+	ZoneScoped;
+	std::ifstream in(path, std::ios::binary);
+	if (!in)
+		throw std::runtime_error(std::string("cannot open replay: ") + path);
+
+	std::vector<uint8_t> data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+	uint32_t hdr[2];
+
+	if (data.size() < sizeof hdr)
+		throw std::runtime_error("replay truncated");
+
+	memcpy(hdr, data.data(), sizeof hdr);
+
+	if (ntohl(hdr[0]) != ReplayWriter::magic)
+		throw std::runtime_error("not a replay");
+	if (ntohl(hdr[1]) != ReplayWriter::version)
+		throw std::runtime_error("unsupported replay version");
+
+	RingBuffer q(data.size());
+	q.push_back(data.data() + sizeof hdr, data.size() - sizeof hdr);
+
+	scn = ScenarioSettings();
+	frames.clear();
+	hashes.clear();
+
+	while (!q.empty()) {
+		std::optional<NetPkg> opt;
+
+		try {
+			opt.emplace(q);
+		} catch (std::runtime_error&) {
+			// the game may not have ended properly
+			fprintf(stderr, "%s: %s: ignoring %zu trailing bytes\n", __func__, path.c_str(), q.size());
+			break;
+		}
+
+		NetPkg &pkg = *opt;
+
+		switch (pkg.type()) {
+		case NetPkgType::set_scn_vars: {
+			// not part of scn_vars
+			std::vector<PlayerSetting> players(std::move(scn.players));
+			scn = pkg.get_scn_vars();
+			scn.players = std::move(players);
+			break;
+		}
+		case NetPkgType::playermod: {
+			NetPlayerControl ctl(pkg.get_player_control());
+
+			if (ctl.type == NetPlayerControlType::resize) {
+				scn.players.resize(std::get<uint16_t>(ctl.data));
+				break;
+			}
+
+			if (ctl.type == NetPlayerControlType::set_player_name) {
+				auto p = std::get<std::pair<uint16_t, std::string>>(ctl.data);
+				scn.players.at(p.first).name = p.second;
+				break;
+			}
+
+			auto p = std::get<std::pair<uint16_t, uint16_t>>(ctl.data);
+			PlayerSetting &ps = scn.players.at(p.first);
+
+			switch (ctl.type) {
+			case NetPlayerControlType::set_civ:
+				ps.civ = p.second;
+				break;
+			case NetPlayerControlType::set_team:
+				ps.team = p.second;
+				break;
+			case NetPlayerControlType::set_type:
+				ps.type = (PlayerType)p.second;
+				break;
+			default:
+				throw std::runtime_error("bad replay player data");
+			}
+			break;
+		}
+		case NetPkgType::peermod: {
+			NetPeerControl ctl(pkg.get_peer_control());
+			if (ctl.type != NetPeerControlType::set_player_idx)
+				throw std::runtime_error("bad replay owner");
+
+			scn.owners[ctl.ref] = ctl.u16();
+			break;
+		}
+		case NetPkgType::lockstep_frame:
+			frames.emplace_back(pkg.get_lockstep_frame());
+			break;
+		case NetPkgType::state_hash:
+			hashes.emplace_back(pkg.get_state_hash());
+			break;
+		default:
+			throw std::runtime_error("bad replay packet type");
+		}
+	}
+}
+
+}
@@ -9,8 +9,8 @@ static constexpr int max_resource_value = 99999;
 struct Resources final {
 	int wood, food, gold, stone;
 
-	Resources() : wood(0), food(0), gold(0), stone(0) {}
-	Resources(int w, int f, int g, int s) : wood(w), food(f), gold(g), stone(s) {}
+	constexpr Resources() : wood(0), food(0), gold(0), stone(0) {}
+	constexpr Resources(int w, int f, int g, int s) : wood(w), food(f), gold(g), stone(s) {}
 
 	/** Check if we have sufficient resources to deduct \a res from it. */
 	constexpr bool can_afford(const Resources &res) const noexcept {
@@ -0,0 +1,78 @@
+#include "scheduler.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace aoe {
+
+void TickStats::add_tick(double dt) noexcept {
+	++ticks;
+	tick_time += dt;
+	tick_max = std::max(tick_max, dt);
+}
+
+void TickStats::add_phases(double entities, double particles, double players) noexcept {
+	entities_time += entities;
+	particles_time += particles;
+	players_time += players;
+}
+
+void TickStats::add_pump(double dt) noexcept {
+	pump_time += dt;
+}
+
+void TickStats::add_push(double dt) noexcept {
+	++snapshots;
+	push_time += dt;
+	push_max = std::max(push_max, dt);
+}
+
+void TickStats::add_drift(double dt) noexcept {
+	drift += dt;
+	drift_max = std::max(drift_max, dt);
+}
+
+TickScheduler::TickScheduler(double tick_rate, double snapshot_rate, unsigned max_catchup)
+	: tick_interval(1 / std::max(0.01, tick_rate)), snapshot_interval(1 / std::max(0.01, snapshot_rate))
+	, next_tick(0), next_snapshot(0), max_catchup(std::max(1u, max_catchup)) {}
+
+void TickScheduler::reset(double now) noexcept {
+	next_tick = now + tick_interval;
+	next_snapshot = now;
+}
+
+void TickScheduler::set_tick_rate(double tick_rate) noexcept {
+	double interval = 1 / std::max(0.01, tick_rate);
+
+	next_tick += interval - tick_interval;
+	tick_interval = interval;
+}
+
+unsigned TickScheduler::ticks(double now, uint64_t &skipped) noexcept {
+	if (now < next_tick)
+		return 0;
+
+	double due = std::floor((now - next_tick) / tick_interval) + 1;
+	next_tick += due * tick_interval;
+
+	if (due <= max_catchup)
+		return (unsigned)due;
+
+	skipped += (uint64_t)due - max_catchup;
+	return max_catchup;
+}
+
+bool TickScheduler::snapshot(double now) noexcept {
+	if (now < next_snapshot)
+		return false;
+
+	next_snapshot += snapshot_interval;
+
+	// don't send a burst after a hiccup
+	if (next_snapshot <= now)
+		next_snapshot = now + snapshot_interval;
+
+	return true;
+}
+
+}
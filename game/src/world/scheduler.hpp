@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstdint>
+
+namespace aoe {
+
+/** Where the time of the world event loop went. Times are in seconds. */
+class TickStats final {
+public:
+	uint64_t loops, ticks, snapshots;
+	uint64_t skipped; // ticks dropped because we could not catch up
+	uint64_t slow; // ticks that took longer than the tick interval
+	double tick_time, tick_max;
+	double entities_time, particles_time, players_time; // where tick_time went
+	double pump_time;
+	double push_time, push_max;
+	double drift, drift_max; // how much later than planned we woke up from sleeping
+
+	TickStats() : loops(0), ticks(0), snapshots(0), skipped(0), slow(0), tick_time(0), tick_max(0)
+		, entities_time(0), particles_time(0), players_time(0), pump_time(0)
+		, push_time(0), push_max(0), drift(0), drift_max(0) {}
+
+	void add_tick(double dt) noexcept;
+	void add_phases(double entities, double particles, double players) noexcept;
+	void add_pump(double dt) noexcept;
+	void add_push(double dt) noexcept;
+	void add_drift(double dt) noexcept;
+};
+
+/**
+ * Fixed timestep clock for the world. Ticks happen at tick_rate and snapshots for the peers at
+ * snapshot_rate, each on their own schedule, so the simulation rate and the bandwidth can be tuned
+ * separately. When we fall behind, at most max_catchup ticks are done in one go and the rest are
+ * dropped. The game slows down a bit, but doesn't come back with a burst of ticks and updates.
+ */
+class TickScheduler final {
+	double tick_interval, snapshot_interval;
+	double next_tick, next_snapshot; // seconds
+	unsigned max_catchup;
+public:
+	TickScheduler(double tick_rate, double snapshot_rate, unsigned max_catchup);
+
+	/** Start the schedule at \a now. The first tick is due one interval from now, the first snapshot right away. */
+	void reset(double now) noexcept;
+
+	/** Change the number of ticks per second without moving the last tick. */
+	void set_tick_rate(double tick_rate) noexcept;
+
+	/** Number of ticks due at \a now. Ticks beyond max_catchup are dropped and added to \a skipped. */
+	unsigned ticks(double now, uint64_t &skipped) noexcept;
+
+	/** Whether a snapshot is due at \a now. Missed snapshots are not made up for. */
+	bool snapshot(double now) noexcept;
+
+	/** When the next tick or snapshot is due. */
+	double wakeup() const noexcept { return next_tick < next_snapshot ? next_tick : next_snapshot; }
+
+	double interval() const noexcept { return tick_interval; }
+};
+
+}
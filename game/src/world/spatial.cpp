@@ -0,0 +1,99 @@
+#include "spatial.hpp"
+
+#include <cassert>
+
+namespace aoe {
+
+SpatialIndex::SpatialIndex() : cells(), lookup(), w(0), h(0) {}
+
+void SpatialIndex::resize(unsigned width, unsigned height) {
+	clear();
+
+	w = std::max(1u, (width + cell_size - 1) / cell_size);
+	h = std::max(1u, (height + cell_size - 1) / cell_size);
+
+	cells.resize((size_t)w * h);
+}
+
+void SpatialIndex::clear() {
+	cells.clear();
+	lookup.clear();
+	w = h = 0;
+}
+
+unsigned SpatialIndex::cell_x(float x) const noexcept {
+	if (!(x > 0))
+		return 0;
+
+	return std::min((unsigned)x / cell_size, w - 1);
+}
+
+unsigned SpatialIndex::cell_y(float y) const noexcept {
+	if (!(y > 0))
+		return 0;
+
+	return std::min((unsigned)y / cell_size, h - 1);
+}
+
+void SpatialIndex::add(IdPoolRef ref, float x, float y) {
+	assert(!cells.empty());
+	unsigned c = cell_at(x, y);
+
+	auto ins = lookup.emplace(ref, c);
+	if (!ins.second) {
+		move(ref, x, y);
+		return;
+	}
+
+	cells[c].emplace_back(ref, x, y);
+}
+
+bool SpatialIndex::move(IdPoolRef ref, float x, float y) {
+	auto it = lookup.find(ref);
+	if (it == lookup.end())
+		return false;
+
+	unsigned c0 = it->second, c1 = cell_at(x, y);
+	std::vector<Item> &src = cells[c0];
+
+	for (size_t i = 0; i < src.size(); ++i) {
+		if (src[i].ref != ref)
+			continue;
+
+		if (c0 == c1) {
+			src[i].x = x;
+			src[i].y = y;
+			return true;
+		}
+
+		src[i] = src.back();
+		src.pop_back();
+		break;
+	}
+
+	cells[c1].emplace_back(ref, x, y);
+	it->second = c1;
+
+	return true;
+}
+
+bool SpatialIndex::remove(IdPoolRef ref) {
+	auto it = lookup.find(ref);
+	if (it == lookup.end())
+		return false;
+
+	std::vector<Item> &items = cells[it->second];
+
+	for (size_t i = 0; i < items.size(); ++i) {
+		if (items[i].ref == ref) {
+			items[i] = items.back();
+			items.pop_back();
+			break;
+		}
+	}
+
+	lookup.erase(it);
+	return true;
+}
+
+}
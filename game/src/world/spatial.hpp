@@ -0,0 +1,136 @@
+#pragma once
+
+#include <idpool.hpp>
+#include <minmax.hpp>
+
+#include <cfloat>
+#include <map>
+#include <vector>
+
+#include "terrain.hpp"
+
+namespace aoe {
+
+/**
+ * Uniform grid that buckets entity positions per Terrain::chunk_size tiles.
+ * Only refs and positions are stored, so any entity info (type, state, ...) has to be checked by the caller.
+ */
+class SpatialIndex final {
+public:
+	struct Item final {
+		IdPoolRef ref;
+		float x, y;
+
+		Item(IdPoolRef ref, float x, float y) : ref(ref), x(x), y(y) {}
+	};
+private:
+	std::vector<std::vector<Item>> cells;
+	std::map<IdPoolRef, unsigned> lookup; // ref to cell index
+	unsigned w, h; // in cells
+public:
+	static constexpr unsigned cell_size = Terrain::chunk_size;
+
+	SpatialIndex();
+
+	/** Reset index for a map of \a width x \a height tiles. */
+	void resize(unsigned width, unsigned height);
+	void clear();
+
+	void add(IdPoolRef, float x, float y);
+	/** Update position. Returns false if \a ref is not in the index. */
+	bool move(IdPoolRef, float x, float y);
+	bool remove(IdPoolRef);
+
+	size_t size() const noexcept { return lookup.size(); }
+
+	/** Call \a fn for every item within radius \a r of (\a x, \a y). */
+	template<typename F> void query(float x, float y, float r, F fn) const {
+		if (cells.empty())
+			return;
+
+		unsigned x0 = cell_x(x - r), y0 = cell_y(y - r);
+		unsigned x1 = cell_x(x + r), y1 = cell_y(y + r);
+		float r2 = r * r;
+
+		for (unsigned cy = y0; cy <= y1; ++cy) {
+			for (unsigned cx = x0; cx <= x1; ++cx) {
+				for (const Item &i : cells[cy * w + cx]) {
+					float dx = i.x - x, dy = i.y - y;
+					if (dx * dx + dy * dy <= r2)
+						fn(i.ref);
+				}
+			}
+		}
+	}
+
+	/** Call \a fn for every item in the rectangle from (\a x0, \a y0) to (\a x1, \a y1) inclusive. */
+	template<typename F> void query_rect(float x0, float y0, float x1, float y1, F fn) const {
+		if (cells.empty())
+			return;
+
+		unsigned cx0 = cell_x(x0), cy0 = cell_y(y0);
+		unsigned cx1 = cell_x(x1), cy1 = cell_y(y1);
+
+		for (unsigned cy = cy0; cy <= cy1; ++cy) {
+			for (unsigned cx = cx0; cx <= cx1; ++cx) {
+				for (const Item &i : cells[cy * w + cx]) {
+					if (i.x >= x0 && i.x <= x1 && i.y >= y0 && i.y <= y1)
+						fn(i.ref);
+				}
+			}
+		}
+	}
+
+	/**
+	 * Find closest item to (\a x, \a y) for which \a pred returns true.
+	 * Cells are searched in rings around (\a x, \a y) and the search stops as soon as no unvisited cell can contain anything closer.
+	 */
+	template<typename F> IdPoolRef nearest(float x, float y, F pred) const {
+		IdPoolRef best = invalid_ref;
+
+		if (cells.empty())
+			return best;
+
+		float d = FLT_MAX;
+		int cx = cell_x(x), cy = cell_y(y);
+		int rmax = (int)std::max(w, h);
+
+		for (int r = 0; r <= rmax; ++r) {
+			for (int yy = cy - r; yy <= cy + r; ++yy) {
+				if (yy < 0 || yy >= (int)h)
+					continue;
+
+				// only visit the perimeter of this ring
+				int step = (yy == cy - r || yy == cy + r) ? 1 : std::max(1, 2 * r);
+
+				for (int xx = cx - r; xx <= cx + r; xx += step) {
+					if (xx < 0 || xx >= (int)w)
+						continue;
+
+					for (const Item &i : cells[yy * w + xx]) {
+						float dx = i.x - x, dy = i.y - y;
+						float d2 = dx * dx + dy * dy;
+
+						if (d2 < d && pred(i.ref)) {
+							d = d2;
+							best = i.ref;
+						}
+					}
+				}
+			}
+
+			// anything in the next ring is at least r cells away
+			float reach = (float)r * cell_size;
+			if (best != invalid_ref && d <= reach * reach)
+				break;
+		}
+
+		return best;
+	}
+private:
+	unsigned cell_x(float x) const noexcept;
+	unsigned cell_y(float y) const noexcept;
+	unsigned cell_at(float x, float y) const noexcept { return cell_y(y) * w + cell_x(x); }
+};
+
+}
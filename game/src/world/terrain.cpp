@@ -1,6 +1,8 @@
 #include "terrain.hpp"
 
 #include <cassert>
+#include <cstring>
+#include <stdexcept>
 
 #include <tracy/Tracy.hpp>
 #include <minmax.hpp>
@@ -9,7 +11,9 @@
 
 namespace aoe {
 
-Terrain::Terrain() : tiles(), hmap(), obstructed(false), w(0), h(0), seed(0), players(0), wrap(false), type(TerrainType::normal) {}
+Terrain::Terrain()
+	: chunk_tiles(), chunk_hmap(), chunk_obstructed(), chunk_versions(), cw(0), ch(0), last_version(0)
+	, w(0), h(0), seed(0), players(0), wrap(false), type(TerrainType::normal) {}
 
 void Terrain::resize(unsigned width, unsigned height, unsigned seed, unsigned players, bool wrap, TerrainType type) {
 	ZoneScoped;
@@ -21,59 +25,92 @@ void Terrain::resize(unsigned width, unsigned height, unsigned seed, unsigned pl
 	this->wrap = wrap;
 	this->type = type;
 
-	size_t count = (size_t)w * h;
+	cw = (w + chunk_size - 1) / chunk_size;
+	ch = (h + chunk_size - 1) / chunk_size;
 
-	tiles.resize(count, 0);
-	hmap.resize(count, 0);
-	obstructed.resize(count, false);
+	size_t count = (size_t)cw * ch * chunk_area;
+
+	// chunk_area is a multiple of 64, so every chunk starts at a whole byte and word
+	chunk_tiles.assign(count, 0);
+	chunk_hmap.assign(count / 2, 0);
+	chunk_obstructed.assign(count / 64, 0);
+	// everything is new
+	chunk_versions.assign((size_t)cw * ch, ++last_version);
 }
 
 tile_t Terrain::tile_at(unsigned x, unsigned y) {
-	return tiles.at(y * w + x);
+	return chunk_tiles.at(idx(x, y));
 }
 
 uint8_t Terrain::h_at(unsigned x, unsigned y) {
 	x = std::clamp(x, 0u, w - 1);
 	y = std::clamp(y, 0u, h - 1);
-	return hmap.at(y * w + x);
+	return height(idx(x, y));
 }
 
-void Terrain::add_building(EntityType t, unsigned x, unsigned y) {
-	assert(is_building(t));
+bool Terrain::passable(unsigned x, unsigned y) const {
+	if (x >= w || y >= h)
+		throw std::out_of_range("tile out of range");
 
+	size_t pos = idx(x, y);
+	return !is_water(tile_type(chunk_tiles[pos])) && !(chunk_obstructed[pos / 64] >> (pos % 64) & 1);
+}
+
+void Terrain::building_area(EntityType t, unsigned x, unsigned y, unsigned &x0, unsigned &y0, unsigned &x1, unsigned &y1) noexcept {
 	// TODO determine size
-	const EntityInfo &info = entity_info.at((unsigned)t);
+	const EntityInfo &info = entity_type_info(t);
 
-	unsigned x0 = x - info.size / 2, y0 = y - info.size / 2;
-	unsigned x1 = x + info.size / 2 + 1, y1 = y + info.size / 2 + 1;
+	x0 = x - info.size / 2; y0 = y - info.size / 2;
+	x1 = x + info.size / 2 + 1; y1 = y + info.size / 2 + 1;
+}
+
+void Terrain::add_building(EntityType t, unsigned x, unsigned y) {
+	assert(is_building(t));
+
+	unsigned x0, y0, x1, y1;
+	building_area(t, x, y, x0, y0, x1, y1);
 
 	assert(x0 < x && y0 < y && x1 <= w && y1 < h);
 
 	for (unsigned yy = y0; yy < y1; ++yy) {
 		for (unsigned xx = x0; xx < x1; ++xx) {
-			size_t pos = yy * w + xx;
-			obstructed.at(pos) = true;
+			size_t pos = idx(xx, yy);
+			chunk_obstructed.at(pos / 64) |= (uint64_t)1 << (pos % 64);
 		}
 	}
 }
 
-void Terrain::fetch(std::vector<uint16_t> &tt, std::vector<uint8_t> &hm, unsigned x0, unsigned y0, unsigned &w, unsigned &h) {
-	tt.clear();
-	hm.clear();
+void Terrain::touch(unsigned cx, unsigned cy) {
+	chunk_versions[(size_t)cy * cw + cx] = last_version;
+}
 
+void Terrain::fetch(std::vector<uint16_t> &tt, std::vector<uint8_t> &hm, unsigned x0, unsigned y0, unsigned &w, unsigned &h) const {
 	assert(x0 < this->w && y0 < this->h);
 
 	unsigned x1 = std::min(x0 + w, this->w), y1 = std::min(y0 + h, this->h);
 
+	w = x1 - x0;
+	h = y1 - y0;
+
+	tt.resize((size_t)w * h);
+	hm.resize((size_t)w * h);
+
+	// copy each row in runs that stay within one chunk
 	for (unsigned y = y0; y < y1; ++y) {
-		for (unsigned x = x0; x < x1; ++x) {
-			tt.emplace_back(tiles[y * this->w + x]);
-			hm.emplace_back(hmap [y * this->w + x]);
+		size_t dst = (size_t)(y - y0) * w;
+
+		for (unsigned x = x0; x < x1;) {
+			unsigned n = std::min(x1, (x / chunk_size + 1) * chunk_size) - x;
+			size_t src = idx(x, y);
+
+			memcpy(&tt[dst], &chunk_tiles[src], n * sizeof(tile_t));
+			for (unsigned i = 0; i < n; ++i)
+				hm[dst + i] = height(src + i);
+
+			dst += n;
+			x += n;
 		}
 	}
-
-	w = x1 - x0;
-	h = y1 - y0;
 }
 
 void Terrain::set(const std::vector<uint16_t> &tt, const std::vector<uint8_t> &hm, unsigned x0, unsigned y0, unsigned w, unsigned h) {
@@ -81,12 +118,89 @@ void Terrain::set(const std::vector<uint16_t> &tt, const std::vector<uint8_t> &h
 
 	unsigned x1 = std::min(x0 + w, this->w), y1 = std::min(y0 + h, this->h);
 
-	for (unsigned y = y0, ty = 0; y < y1; ++y, ++ty) {
-		for (unsigned x = x0, tx = 0; x < x1; ++x, ++tx) {
-			tiles[y * this->w + x] = tt[ty * w + tx];
-			hmap [y * this->w + x] = hm[ty * w + tx];
+	if (tt.size() < (size_t)w * (y1 - y0) || hm.size() < (size_t)w * (y1 - y0))
+		throw std::runtime_error("terrain area too small");
+
+	for (unsigned y = y0; y < y1; ++y) {
+		size_t src = (size_t)(y - y0) * w;
+
+		for (unsigned x = x0; x < x1;) {
+			unsigned n = std::min(x1, (x / chunk_size + 1) * chunk_size) - x;
+			size_t dst = idx(x, y);
+
+			memcpy(&chunk_tiles[dst], &tt[src], n * sizeof(tile_t));
+			for (unsigned i = 0; i < n; ++i)
+				set_height(dst + i, hm[src + i]);
+
+			src += n;
+			x += n;
 		}
 	}
+
+	++last_version;
+
+	for (unsigned cy = y0 / chunk_size; cy <= (y1 - 1) / chunk_size; ++cy)
+		for (unsigned cx = x0 / chunk_size; cx <= (x1 - 1) / chunk_size; ++cx)
+			touch(cx, cy);
+}
+
+void Terrain::fetch_chunk(unsigned cx, unsigned cy, tile_t *tt, uint8_t *hm) const {
+	if (cx >= cw || cy >= ch)
+		throw std::out_of_range("chunk out of range");
+
+	size_t pos = ((size_t)cy * cw + cx) * chunk_area;
+
+	memcpy(tt, &chunk_tiles[pos], chunk_area * sizeof(tile_t));
+	for (unsigned i = 0; i < chunk_area; ++i)
+		hm[i] = height(pos + i);
+}
+
+void Terrain::set_chunk(unsigned cx, unsigned cy, const tile_t *tt, const uint8_t *hm) {
+	if (cx >= cw || cy >= ch)
+		throw std::out_of_range("chunk out of range");
+
+	size_t pos = ((size_t)cy * cw + cx) * chunk_area;
+
+	// tiles beyond the map edge are never read, so there is no need to skip them
+	memcpy(&chunk_tiles[pos], tt, chunk_area * sizeof(tile_t));
+	for (unsigned i = 0; i < chunk_area; ++i)
+		set_height(pos + i, hm[i]);
+
+	++last_version;
+	touch(cx, cy);
+}
+
+void Terrain::sync(const Terrain &src) {
+	ZoneScoped;
+
+	if (cw != src.cw || ch != src.ch || w != src.w || h != src.h) {
+		*this = src;
+		return;
+	}
+
+	seed = src.seed;
+	players = src.players;
+	wrap = src.wrap;
+	type = src.type;
+
+	for (size_t c = 0, n = chunk_versions.size(); c < n; ++c) {
+		if (chunk_versions[c] == src.chunk_versions[c])
+			continue;
+
+		size_t pos = c * chunk_area;
+
+		memcpy(&chunk_tiles[pos], &src.chunk_tiles[pos], chunk_area * sizeof(tile_t));
+		memcpy(&chunk_hmap[pos / 2], &src.chunk_hmap[pos / 2], chunk_area / 2);
+		chunk_versions[c] = src.chunk_versions[c];
+	}
+
+	// buildings don't bump versions, but there are few obstruction words anyway
+	chunk_obstructed = src.chunk_obstructed;
+	last_version = src.last_version;
+}
+
+size_t Terrain::memory() const noexcept {
+	return chunk_tiles.size() * sizeof(tile_t) + chunk_hmap.size() + chunk_obstructed.size() * sizeof(uint64_t) + chunk_versions.size() * sizeof(uint32_t);
 }
 
 }
@@ -1,11 +1,17 @@
 #pragma once
 
 #include <vector>
+#include <cstddef>
 #include <cstdint>
 #include <array>
+#include <algorithm>
 
 #include "entity_info.hpp"
 
+namespace ctpl {
+	class thread_pool;
+}
+
 namespace aoe {
 
 enum class TileType {
@@ -28,7 +34,6 @@ enum class TerrainType {
 	max,
 };
 
-// TODO introduce terrain block/chunk
 typedef uint16_t tile_t;
 
 static constexpr bool is_water(TileType t) {
@@ -45,23 +50,56 @@ extern std::array<TileType, 4> fhvn(const std::vector<tile_t> &tiles, size_t w,
 extern std::array<TileType, 4> neighs_hv(const std::vector<tile_t> &tiles, size_t w, size_t h, size_t x, size_t y);
 extern std::array<TileType, 4> fdn(const std::vector<tile_t> &tiles, size_t w, size_t h, size_t x, size_t y, TileType f);
 
+/** Tile to be painted with another type, e.g. by the scenario editor. */
+struct TilePaint final {
+	unsigned x, y;
+	TileType type;
+
+	TilePaint(unsigned x, unsigned y, TileType type) : x(x), y(y), type(type) {}
+};
+
+/**
+ * Tiles, heights and obstructions of the map. Everything is stored chunk by chunk, so a chunk and
+ * the tiles around any tile are close together in memory and a chunk can be copied in one go.
+ * Every chunk has a version that is bumped whenever its tiles or heights change, so whoever shows
+ * or sends the terrain can check which chunks they have to look at again.
+ * Heights take 4 bits and obstructions 1 bit per tile, so a 1024x1024 map is about 2.6MB.
+ */
 class Terrain final {
-	std::vector<tile_t> tiles;
-	std::vector<uint8_t> hmap;
-	std::vector<bool> obstructed; // tiles occupied by buildings
+	// chunk-major: all chunk_area values of chunk (0,0), then of chunk (1,0) and so on
+	std::vector<tile_t> chunk_tiles;
+	std::vector<uint8_t> chunk_hmap; // two heights per byte, even tiles in the low nibble
+	std::vector<uint64_t> chunk_obstructed; // one bit per tile occupied by a building
+	std::vector<uint32_t> chunk_versions;
+	unsigned cw, ch; // size in chunks
+	uint32_t last_version;
 public:
 	unsigned w, h, seed, players;
 	bool wrap;
 	TerrainType type;
 
-	// TODO increase max_size on demand
-	static constexpr unsigned min_size = 48, chunk_size = 16, max_size = 250;
+	static constexpr unsigned min_size = 48, chunk_size = 16, max_size = 1024;
+	static constexpr unsigned chunk_area = chunk_size * chunk_size;
+	/** Heights are clamped to this when set. */
+	static constexpr unsigned max_height = 15;
 
 	Terrain();
 
 	void resize(unsigned width, unsigned height, unsigned seed, unsigned players, bool wrap, TerrainType type);
 
-	void generate();
+	/** Create a new map. With a thread pool, the work is spread over its threads. The map is the same either way. */
+	void generate(ctpl::thread_pool *tp=nullptr);
+
+	/** How far from a painted tile the types of other tiles can change. Subimages can change one tile further. */
+	static constexpr unsigned paint_halo = 2;
+
+	/**
+	 * Paint tiles in order and fix the transitions and heights around them like generate does, without
+	 * going over the whole map. Shores and overlays are made from scratch, so painting water_desert is
+	 * the same as painting desert. Heights are only lowered, as far as needed for smooth slopes.
+	 * Returns false if nothing has changed, e.g. if all tiles already had the type they are painted with.
+	 */
+	bool paint(const std::vector<TilePaint> &lst);
 
 	static constexpr tile_t tile_id(TileType type, unsigned subimage) noexcept {
 		return ((unsigned)type & 0x7) | (subimage << 3);
@@ -90,27 +128,70 @@ public:
 		return type;
 	}
 
+	/** Position of tile (\a x, \a y) in the chunk-major arrays. */
+	constexpr size_t idx(unsigned x, unsigned y) const noexcept {
+		return ((size_t)(y / chunk_size) * cw + x / chunk_size) * chunk_area + (y % chunk_size) * chunk_size + x % chunk_size;
+	}
+
 	tile_t tile_at(unsigned x, unsigned y);
 	uint8_t h_at(unsigned x, unsigned y);
+	/** Check if units can walk here: i.e. no water and no building. */
+	bool passable(unsigned x, unsigned y) const;
 
 	void add_building(EntityType t, unsigned x, unsigned y);
+	/** Tiles from (\a x0, \a y0) up to but not including (\a x1, \a y1) are covered by building \a t at (\a x, \a y). */
+	static void building_area(EntityType t, unsigned x, unsigned y, unsigned &x0, unsigned &y0, unsigned &x1, unsigned &y1) noexcept;
 
-	void fetch(std::vector<tile_t> &tiles, std::vector<uint8_t> &hmap, unsigned x, unsigned y, unsigned &w, unsigned &h);
+	/** Copy the area at (\a x, \a y) in row-major order. \a w and \a h are clipped to the map. */
+	void fetch(std::vector<tile_t> &tiles, std::vector<uint8_t> &hmap, unsigned x, unsigned y, unsigned &w, unsigned &h) const;
 
+	/** Replace the area at (\a x, \a y) with \a tiles and \a hmap in row-major order and bump the versions of all chunks it touches. */
 	void set(const std::vector<tile_t> &tiles, const std::vector<uint8_t> &hmap, unsigned x, unsigned y, unsigned w, unsigned h);
+
+	unsigned chunks_w() const noexcept { return cw; }
+	unsigned chunks_h() const noexcept { return ch; }
+
+	/** Copy chunk (\a cx, \a cy) in row-major order. \a tiles and \a hmap must have room for chunk_area values. */
+	void fetch_chunk(unsigned cx, unsigned cy, tile_t *tiles, uint8_t *hmap) const;
+	/** Replace chunk (\a cx, \a cy). Tiles beyond the edge of the map are stored, but never used. */
+	void set_chunk(unsigned cx, unsigned cy, const tile_t *tiles, const uint8_t *hmap);
+
+	/** Versions only go up. A chunk has changed if its version is newer than the one you have seen. */
+	uint32_t chunk_version(unsigned cx, unsigned cy) const { return chunk_versions.at((size_t)cy * cw + cx); }
+	/** Newest version of any chunk. */
+	uint32_t version() const noexcept { return last_version; }
+
+	/** Become a copy of \a src, but only copy the chunks that have changed if we have the same size. */
+	void sync(const Terrain &src);
+
+	/** Bytes used for the tiles, heights, obstructions and versions. */
+	size_t memory() const noexcept;
 private:
-	void tgen_desert();
-	void tgen_normal();
-	void tgen_flat();
-
-	void fix_tile_transitions();
-	void fix_water_desert();
-	void fix_grass_desert();
-	void smooth_water();
-
-	void fix_heightmap();
-	void fix_water_transitions();
-	void smooth_slopes();
+	void touch(unsigned cx, unsigned cy);
+
+	uint8_t height(size_t i) const noexcept {
+		return (chunk_hmap[i / 2] >> (i % 2 * 4)) & 0xf;
+	}
+
+	void set_height(size_t i, unsigned v) noexcept {
+		uint8_t &b = chunk_hmap[i / 2];
+		unsigned shift = i % 2 * 4;
+		b = (uint8_t)((b & ~(0xf << shift)) | (std::min(v, max_height) << shift));
+	}
+
+	// generators work on a row-major copy of the whole map. passes that get a thread pool split the map in bands of chunk rows
+	void tgen_desert(std::vector<tile_t> &tiles, std::vector<uint8_t> &hmap);
+	void tgen_normal(std::vector<tile_t> &tiles, std::vector<uint8_t> &hmap, ctpl::thread_pool *tp);
+	void tgen_flat(std::vector<tile_t> &tiles, std::vector<uint8_t> &hmap);
+
+	void fix_tile_transitions(std::vector<tile_t> &tiles, std::vector<uint8_t> &hmap, ctpl::thread_pool *tp);
+	void fix_water_desert(std::vector<tile_t> &tiles, std::vector<uint8_t> &hmap, ctpl::thread_pool *tp);
+	void fix_grass_desert(std::vector<tile_t> &tiles, ctpl::thread_pool *tp);
+	void smooth_water(std::vector<tile_t> &tiles, ctpl::thread_pool *tp);
+
+	void fix_heightmap(std::vector<tile_t> &tiles, std::vector<uint8_t> &hmap, ctpl::thread_pool *tp);
+	void fix_water_transitions(std::vector<tile_t> &tiles, std::vector<uint8_t> &hmap, ctpl::thread_pool *tp);
+	void smooth_slopes(std::vector<tile_t> &tiles, std::vector<uint8_t> &hmap, ctpl::thread_pool *tp);
 };
 
 }
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "../terrain.hpp"
+
+#include <algorithm>
+#include <future>
+#include <vector>
+
+#include <ctpl_stl.hpp>
+
+namespace aoe {
+
+/**
+ * Run \a fn(y0, y1) over bands of whole chunk rows of a map that is \a h tiles high, one band per
+ * thread of \a tp. Without a thread pool, the whole map is done at once on this thread.
+ */
+template<typename F> static inline void for_bands(ctpl::thread_pool *tp, size_t h, F fn) {
+	size_t rows = (h + Terrain::chunk_size - 1) / Terrain::chunk_size;
+	size_t bands = tp ? std::min<size_t>(tp->size(), rows) : 1;
+
+	if (bands <= 1) {
+		fn(0, h);
+		return;
+	}
+
+	std::vector<std::future<void>> jobs;
+
+	for (size_t i = 0; i < bands; ++i) {
+		size_t y0 = rows * i / bands * Terrain::chunk_size;
+		size_t y1 = std::min(h, rows * (i + 1) / bands * Terrain::chunk_size);
+
+		jobs.emplace_back(tp->push([&fn, y0, y1](int) { fn(y0, y1); }));
+	}
+
+	for (std::future<void> &f : jobs)
+		f.get();
+}
+
+}
@@ -4,7 +4,7 @@
 
 namespace aoe {
 
-void Terrain::tgen_flat() {
+void Terrain::tgen_flat(std::vector<tile_t> &tiles, std::vector<uint8_t> &hmap) {
 	// TODO stub
 }
 
@@ -1,10 +1,11 @@
 #include "../terrain.hpp"
+#include "bands.hpp"
 
 #include <perlin_noise.hpp>
 
 namespace aoe {
 
-void Terrain::tgen_normal() {
+void Terrain::tgen_normal(std::vector<tile_t> &tiles, std::vector<uint8_t> &hmap, ctpl::thread_pool *tp) {
 	// TODO stub
 	double frequency = 4;
 	double octaves = 5;
@@ -13,22 +14,31 @@ void Terrain::tgen_normal() {
 	const double fx = frequency / this->w;
 	const double fy = frequency / this->h;
 
-	for (int32_t y = 0; y < h; ++y) {
-		for (int32_t x = 0; x < w; ++x) {
-			double v = perlin.octave2D_01(x * fx, y * fx, octaves);
+	// the noise is the expensive part and can be done in any order
+	std::vector<double> noise((size_t)w * h);
 
-			size_t i = y * w + x;
+	for_bands(tp, h, [&perlin, &noise, fx, octaves, w = (int32_t)w](size_t y0, size_t y1) {
+		for (int32_t y = y0; y < y1; ++y) {
+			double *row = &noise[(size_t)y * w];
 
-			if (v > 0.5)
-				tiles[i] = Terrain::tile_id(TileType::grass, rand() % 9);
-			else if (v > 0.2)
-				tiles[i] = Terrain::tile_id(TileType::desert, rand() % 9);
-			else
-				tiles[i] = Terrain::tile_id(TileType::water, 0);
-
-			// scale 0 to 5
-			//hmap[i] = (uint8_t)(v * 5);
+			for (int32_t x = 0; x < w; ++x)
+				row[x] = perlin.octave2D_01(x * fx, y * fx, octaves);
 		}
+	});
+
+	// rand has to be called in the same order as always, so the same seed gives the same map
+	for (size_t i = 0, n = noise.size(); i < n; ++i) {
+		double v = noise[i];
+
+		if (v > 0.5)
+			tiles[i] = Terrain::tile_id(TileType::grass, rand() % 9);
+		else if (v > 0.2)
+			tiles[i] = Terrain::tile_id(TileType::desert, rand() % 9);
+		else
+			tiles[i] = Terrain::tile_id(TileType::water, 0);
+
+		// scale 0 to 5
+		//hmap[i] = (uint8_t)(v * 5);
 	}
 }
 
@@ -1,12 +1,17 @@
 #include "../terrain.hpp"
+#include "bands.hpp"
 
 #include <cassert>
+#include <cstddef>
+#include <cstdlib>
 
 #include <array>
 #include <set>
 
 #include "../engine/grid.hpp"
 
+#include <tracy/Tracy.hpp>
+
 namespace aoe {
 
 enum class TerrainAlgorithm {
@@ -22,7 +27,7 @@ const std::array<std::pair<int, int>, 8> neighs_dir{{
 	{-1, -1}, {0, -1}, {1, -1},
 }};
 
-void Terrain::tgen_desert() {
+void Terrain::tgen_desert(std::vector<tile_t> &tiles, std::vector<uint8_t> &hmap) {
 	// TODO use real generator like perlin noise
 	TileType types[] = { TileType::desert, TileType::grass, TileType::grass_desert };
 
@@ -37,225 +42,392 @@ static constexpr inline size_t pos_dir(size_t w, size_t x, size_t y, unsigned di
 	return (size_t)((long)y + d.second) * w + (size_t)((long)x + d.first);
 }
 
-void Terrain::generate() {
+/*
+ * The transition passes look at the neighbours of every tile. Instead of collecting them with
+ * neighs, fhvn and fdn, they look at a copy of the tile types with a border around the map and
+ * turn the neighbours they are interested in into a bitmask, which is then looked up in a table.
+ *
+ * Neighbour masks use the same order as fhvn and fdn:
+ *   bit 0: (x, y + 1)  bit 1: (x - 1, y)  bit 2: (x + 1, y)  bit 3: (x, y - 1)
+ * and for diagonals:
+ *   bit 0: (x - 1, y + 1)  bit 1: (x + 1, y + 1)  bit 2: (x - 1, y - 1)  bit 3: (x + 1, y - 1)
+ */
+
+/** Set of tile types, one bit per TileType. */
+typedef unsigned TileTypes;
+
+static constexpr TileTypes water_types = 1 << (unsigned)TileType::water | 1 << (unsigned)TileType::deepwater | 1 << (unsigned)TileType::deepwater_water;
+static constexpr TileTypes shore_types = 1 << (unsigned)TileType::desert | 1 << (unsigned)TileType::water_desert;
+
+static_assert(is_water(TileType::water) && is_water(TileType::deepwater) && is_water(TileType::deepwater_water) && !is_water(TileType::water_desert));
+
+static constexpr bool in(TileTypes set, uint8_t t) noexcept {
+	return (set >> t) & 1;
+}
+
+/**
+ * Tile types with a border of TileType::unexplored around the map. No pass matches unexplored
+ * tiles, which is what the defaults for tiles beyond the edge of the map amounted to as well.
+ */
+class PaddedTypes final {
+public:
+	std::vector<uint8_t> types;
+	ptrdiff_t stride;
+
+	PaddedTypes(size_t w, size_t h) : types((w + 2) * (h + 2), (uint8_t)TileType::unexplored), stride(w + 2) {}
+
+	void load(const std::vector<tile_t> &tiles, size_t w, size_t y0, size_t y1) noexcept {
+		for (size_t y = y0; y < y1; ++y) {
+			uint8_t *dst = at(0, y);
+			const tile_t *src = &tiles[y * w];
+
+			for (size_t x = 0; x < w; ++x)
+				dst[x] = (uint8_t)Terrain::tile_type(src[x]);
+		}
+	}
+
+	uint8_t *at(size_t x, size_t y) noexcept {
+		return &types[(y + 1) * stride + x + 1];
+	}
+
+	unsigned hv(const uint8_t *p, TileTypes set) const noexcept {
+		return in(set, p[stride]) | in(set, p[-1]) << 1 | in(set, p[1]) << 2 | in(set, p[-stride]) << 3;
+	}
+
+	unsigned diag(const uint8_t *p, TileTypes set) const noexcept {
+		return in(set, p[stride - 1]) | in(set, p[stride + 1]) << 1 | in(set, p[-stride - 1]) << 2 | in(set, p[-stride + 1]) << 3;
+	}
+};
+
+template<typename F> static constexpr std::array<uint8_t, 16> mask_table(F fn) {
+	std::array<uint8_t, 16> t{};
+
+	for (unsigned m = 0; m < 16; ++m)
+		t[m] = fn(m);
+
+	return t;
+}
+
+/** Water desert that has water on opposite sides. */
+static constexpr std::array<uint8_t, 16> water_desert_invalid = mask_table([](unsigned m) {
+	return (m & 0x6) == 0x6 || (m & 0x9) == 0x9;
+});
+
+/** Water desert subimage for water next to it. */
+static constexpr std::array<uint8_t, 16> water_desert_edge = mask_table([](unsigned m) {
+	switch (m) {
+	case 0x1: return 11;
+	case 0x2: return 8;
+	case 0x4: return 9;
+	case 0x8: return 10;
+	case 0x2 | 0x8: return 0;
+	case 0x2 | 0x1: return 1;
+	case 0x4 | 0x8: return 2;
+	case 0x1 | 0x4: case 0x1 | 0x8: case 0x2 | 0x4: return 3;
+	default: return 0;
+	}
+});
+
+/** Water desert subimage for water diagonally next to it if there is none right next to it. */
+static constexpr std::array<uint8_t, 16> water_desert_corner = mask_table([](unsigned m) {
+	return m & 0x1 ? 5 : m & 0x2 ? 7 : m & 0x4 ? 4 : 6;
+});
+
+/** Grass desert overlay bits for desert next to grass: left, below, above, right. */
+static constexpr std::array<uint8_t, 16> grass_desert_bits = mask_table([](unsigned m) {
+	return (m >> 1 & 1) | (m & 1) << 1 | (m >> 3 & 1) << 2 | (m >> 2 & 1) << 3;
+});
+
+void Terrain::generate(ctpl::thread_pool *tp) {
+	ZoneScoped;
+	std::vector<tile_t> tiles((size_t)w * h, 0);
+	std::vector<uint8_t> hmap((size_t)w * h, 0);
+
 	switch (alg) {
 	case TerrainAlgorithm::perlin_noise:
 		switch (type) {
 		case TerrainType::normal:
-			tgen_normal();
+			tgen_normal(tiles, hmap, tp);
 			break;
 		case TerrainType::flat:
-			tgen_flat();
+			tgen_flat(tiles, hmap);
 			break;
 		default:
 			fprintf(stderr, "%s: stub terrain type=%u, falling back to desert garbage\n", __func__, (unsigned)type);
-			tgen_desert();
+			tgen_desert(tiles, hmap);
 			break;
 		}
 		break;
 	case TerrainAlgorithm::desert_garbage:
 	default:
-		tgen_desert();
+		tgen_desert(tiles, hmap);
 		break;
 	}
 
-	fix_tile_transitions();
-	fix_heightmap();
+	fix_tile_transitions(tiles, hmap, tp);
+	fix_heightmap(tiles, hmap, tp);
+
+	set(tiles, hmap, 0, 0, w, h);
 }
 
-void Terrain::fix_tile_transitions() {
-	fix_water_desert();
-	smooth_water();
-	fix_grass_desert();
+void Terrain::fix_tile_transitions(std::vector<tile_t> &tiles, std::vector<uint8_t> &hmap, ctpl::thread_pool *tp) {
+	ZoneScoped;
+	fix_water_desert(tiles, hmap, tp);
+	smooth_water(tiles, tp);
+	fix_grass_desert(tiles, tp);
 }
 
-void Terrain::fix_water_desert() {
-	for (size_t y = 0; y < h; ++y) {
-		for (size_t x = 0; x < w; ++x) {
-			size_t idx = y * w + x;
-			// prefer a slow and dumb algorithm that just works
-			TileType type = tile_type(tiles[idx]);
+/**
+ * Collect the positions of all tiles of type \a t in row-major order. Used by passes that have to
+ * visit tiles in order, because they look at what they have just changed.
+ */
+static void collect_type(const std::vector<tile_t> &tiles, size_t w, size_t h, TileType t, ctpl::thread_pool *tp, std::vector<size_t> &out) {
+	std::vector<std::vector<size_t>> bands(h);
 
-			if (!is_water(type))
-				continue;
+	for_bands(tp, h, [&](size_t y0, size_t y1) {
+		std::vector<size_t> &lst = bands[y0];
+
+		for (size_t i = y0 * w, end = y1 * w; i < end; ++i)
+			if (Terrain::tile_type(tiles[i]) == t)
+				lst.emplace_back(i);
+	});
+
+	out.clear();
+
+	for (const std::vector<size_t> &lst : bands)
+		out.insert(out.end(), lst.begin(), lst.end());
+}
+
+void Terrain::fix_water_desert(std::vector<tile_t> &tiles, std::vector<uint8_t> &hmap, ctpl::thread_pool *tp) {
+	ZoneScoped;
+	PaddedTypes pt(w, h);
 
-			// force water on lowest elevation
-			hmap[idx] = 0;
+	for_bands(tp, h, [&](size_t y0, size_t y1) { pt.load(tiles, w, y0, y1); });
 
-			auto nn = neighs(tiles, w, h, x, y, TileType::water);
+	// any land next to water becomes water desert. the water itself stays, so the order doesn't matter
+	for_bands(tp, h, [&](size_t y0, size_t y1) {
+		for (size_t y = y0; y < y1; ++y) {
+			const uint8_t *p = pt.at(0, y);
 
-			for (unsigned i = 0; i < nn.size(); ++i) {
-				TileType tt = nn[i];
-				if (!is_water(tt)) {
-					size_t idx2 = pos_dir(w, x, y, i);
-					tiles[idx2] = tile_id(TileType::water_desert, 0);
-					hmap[idx2] = 0;
+			for (size_t x = 0; x < w; ++x, ++p) {
+				size_t idx = y * w + x;
+
+				// force water on lowest elevation
+				if (in(water_types, *p)) {
+					hmap[idx] = 0;
+					continue;
+				}
+
+				if (pt.hv(p, water_types) | pt.diag(p, water_types)) {
+					tiles[idx] = tile_id(TileType::water_desert, 0);
+					hmap[idx] = 0;
 				}
 			}
 		}
-	}
+	});
 
-	// another pass to prevent floating water desert tiles
-	for (size_t y = 0; y < h; ++y) {
-		for (size_t x = 0; x < w; ++x) {
-			size_t idx = y * w + x;
-			TileType type = tile_type(tiles[idx]);
+	// another pass to prevent floating water desert tiles.
+	// reverting a tile to water affects the tiles after it, so this has to be done in order
+	std::vector<size_t> lst;
+	collect_type(tiles, w, h, TileType::water_desert, tp, lst);
 
-			if (type != TileType::water_desert)
-				continue;
+	for_bands(tp, h, [&](size_t y0, size_t y1) { pt.load(tiles, w, y0, y1); });
 
-			auto nn = fhvn(tiles, w, h, x, y, TileType::water_desert);
+	for (size_t idx : lst) {
+		uint8_t *p = pt.at(idx % w, idx / w);
 
-			if ((is_water(nn[1]) && is_water(nn[2])) || (is_water(nn[0]) && is_water(nn[3])))
-				// invalid transition, revert to water
-				tiles[idx] = tile_id(TileType::water, 0);
+		if (water_desert_invalid[pt.hv(p, water_types)]) {
+			// invalid transition, revert to water
+			tiles[idx] = tile_id(TileType::water, 0);
+			*p = (uint8_t)TileType::water;
 		}
 	}
 }
 
-void Terrain::smooth_water() {
-	for (size_t y = 0; y < h; ++y) {
-		for (size_t x = 0; x < w; ++x) {
-			size_t idx = y * w + x;
-			TileType type = tile_type(tiles[idx]);
-			if (type == TileType::water_desert) {
-				auto nn = fhvn(tiles, w, h, x, y, TileType::desert);
-				unsigned edges = 0, subimage = 0;
-
-				for (TileType t : nn)
-					if (t == TileType::water)
-						++edges;
-
-				switch (edges) {
-				case 1:
-					if (nn[0] == TileType::water)
-						subimage = 11;
-					else if (nn[1] == TileType::water)
-						subimage = 8;
-					else if (nn[2] == TileType::water)
-						subimage = 9;
-					else
-						subimage = 10;
-					break;
-				case 2:
-					if (nn[1] == TileType::water && nn[3] == TileType::water)
-						subimage = 0;
-					else if (nn[1] == TileType::water && nn[0] == TileType::water)
-						subimage = 1;
-					else if (nn[2] == TileType::water && nn[3] == TileType::water)
-						subimage = 2;
-					else
-						subimage = 3;
-					break;
-				case 0:
-					// find diagonal neighbors
-					nn = fdn(tiles, w, h, x, y, TileType::desert);
-
-					if (nn[0] == TileType::water)
-						subimage = 5;
-					else if (nn[1] == TileType::water)
-						subimage = 7;
-					else if (nn[2] == TileType::water)
-						subimage = 4;
-					else
-						subimage = 6;
-
-					break;
-				}
+void Terrain::smooth_water(std::vector<tile_t> &tiles, ctpl::thread_pool *tp) {
+	ZoneScoped;
+	PaddedTypes pt(w, h);
+
+	for_bands(tp, h, [&](size_t y0, size_t y1) { pt.load(tiles, w, y0, y1); });
+
+	// only subimages change, so every tile can be done on its own
+	for_bands(tp, h, [&](size_t y0, size_t y1) {
+		for (size_t y = y0; y < y1; ++y) {
+			const uint8_t *p = pt.at(0, y);
+
+			for (size_t x = 0; x < w; ++x, ++p) {
+				if (*p != (uint8_t)TileType::water_desert)
+					continue;
+
+				unsigned edges = pt.hv(p, 1 << (unsigned)TileType::water);
+				unsigned subimage = edges ? water_desert_edge[edges] : water_desert_corner[pt.diag(p, 1 << (unsigned)TileType::water)];
 
-				tiles[idx] = Terrain::tile_id(type, subimage);
+				tiles[y * w + x] = Terrain::tile_id(TileType::water_desert, subimage);
 			}
 		}
-	}
+	});
 }
 
-void Terrain::fix_grass_desert() {
+void Terrain::fix_grass_desert(std::vector<tile_t> &tiles, ctpl::thread_pool *tp) {
+	ZoneScoped;
+	PaddedTypes pt(w, h);
+
+	for_bands(tp, h, [&](size_t y0, size_t y1) { pt.load(tiles, w, y0, y1); });
+
 	// TODO add water deep water transitions
-	for (size_t y = 0; y < h; ++y) {
-		for (size_t x = 0; x < w; ++x) {
-			size_t idx = y * w + x;
-			TileType type = tile_type(tiles[idx]);
-
-			if (type == TileType::grass) {
-				auto nn = fhvn(tiles, w, h, x, y, TileType::grass);
-				unsigned bits = 0;
-
-				if (nn[1] == TileType::desert || nn[1] == TileType::water_desert)
-					bits |= 1 << 0;
-				if (nn[0] == TileType::desert || nn[0] == TileType::water_desert)
-					bits |= 1 << 1;
-				if (nn[3] == TileType::desert || nn[3] == TileType::water_desert)
-					bits |= 1 << 2;
-				if (nn[2] == TileType::desert || nn[2] == TileType::water_desert)
-					bits |= 1 << 3;
-
-				if (bits) {
-					type = TileType::grass_desert;
-					bits <<= 16 - 4 - 3;
-				}
+	for_bands(tp, h, [&](size_t y0, size_t y1) {
+		for (size_t y = y0; y < y1; ++y) {
+			const uint8_t *p = pt.at(0, y);
 
-				tiles[idx] = tile_id(type, bits);
+			for (size_t x = 0; x < w; ++x, ++p) {
+				if (*p != (uint8_t)TileType::grass)
+					continue;
+
+				unsigned bits = grass_desert_bits[pt.hv(p, shore_types)];
+
+				tiles[y * w + x] = bits ? tile_id(TileType::grass_desert, bits << (16 - 4 - 3)) : tile_id(TileType::grass, 0);
 			}
 		}
-	}
+	});
 }
 
-void Terrain::fix_heightmap() {
+void Terrain::fix_heightmap(std::vector<tile_t> &tiles, std::vector<uint8_t> &hmap, ctpl::thread_pool *tp) {
+	ZoneScoped;
 	// smooth heightmap. three steps
 	// step one: force tiles adjacent to water_desert to have same hmap
-	fix_water_transitions();
+	fix_water_transitions(tiles, hmap, tp);
 
 	// step two: smooth slopes. limit runs just in case to prevent looping forever
-	smooth_slopes();
+	smooth_slopes(tiles, hmap, tp);
 
 	// TODO step three: convert flat tiles to hill tiles with corners etc.
 }
 
-void Terrain::fix_water_transitions() {
-	// force tiles adjacent to water to have same height
-	Vector2dView<tile_t> grid(tiles, w);
+void Terrain::fix_water_transitions(std::vector<tile_t> &tiles, std::vector<uint8_t> &hmap, ctpl::thread_pool *tp) {
+	// force tiles adjacent to water to have same height.
+	// a tile can be changed by one water desert tile and then be copied to the next, so do them in order
+	std::vector<size_t> lst;
+	collect_type(tiles, w, h, TileType::water_desert, tp, lst);
 
-	for (size_t y = 0; y < h; ++y) {
-		for (size_t x = 0; x < w; ++x) {
-			TileType type = tile_type(grid.at(x, y));
+	for (size_t idx : lst) {
+		size_t x = idx % w, y = idx / w;
+		unsigned h0 = hmap[idx];
 
-			if (type != TileType::water_desert)
-				continue;
+		if (y > 1)     hmap[idx - w] = h0;
+		if (y < h - 1) hmap[idx + w] = h0;
+		if (x > 1)     hmap[idx - 1] = h0;
+		if (x < w - 1) hmap[idx + 1] = h0;
+	}
+}
+
+/**
+ * Lower the neighbours of the tiles in \a todo that are more than one higher, then theirs and so on.
+ * Sweeping over the map until nothing changes can take as many sweeps as the map is wide, so only
+ * revisit the neighbours of tiles that have been lowered. Every tile is lowered at most max_height times.
+ */
+static bool lower_slopes(std::vector<uint8_t> &hmap, size_t w, size_t h, std::vector<size_t> &todo) {
+	bool changed = false;
+
+	while (!todo.empty()) {
+		size_t idx = todo.back();
+		todo.pop_back();
+
+		size_t x = idx % w, y = idx / w;
+		unsigned h0 = hmap[idx];
+		auto hh = heights(hmap, w, h, x, y, h0);
+
+		for (unsigned i = 0; i < hh.size(); ++i) {
+			if (hh[i] > h0 + 1) {
+				size_t idx2 = pos_dir(w, x, y, i);
+				hmap[idx2] = h0 + 1;
+				todo.emplace_back(idx2);
+				changed = true;
+			}
+		}
+	}
 
-			unsigned h0 = hmap[grid.idx(x, y)];
+	return changed;
+}
 
-			if (y > 1)     hmap[grid.idx(x, y - 1)] = h0;
-			if (y < h - 1) hmap[grid.idx(x, y + 1)] = h0;
-			if (x > 1)     hmap[grid.idx(x - 1, y)] = h0;
-			if (x < w - 1) hmap[grid.idx(x + 1, y)] = h0;
+/**
+ * Lower tiles until none is more than one higher than any of its neighbours.
+ * There is only one outcome, whatever the order, so the tiles to start with are found in parallel.
+ */
+static bool limit_slopes(std::vector<uint8_t> &hmap, size_t w, size_t h, ctpl::thread_pool *tp) {
+	ZoneScoped;
+	ptrdiff_t stride = w + 2;
+	// border of zeros, which are never too high
+	std::vector<uint8_t> padded((w + 2) * (h + 2), 0);
+	std::vector<std::vector<size_t>> bands(h);
+
+	for_bands(tp, h, [&](size_t y0, size_t y1) {
+		for (size_t y = y0; y < y1; ++y)
+			std::copy(&hmap[y * w], &hmap[y * w] + w, &padded[(y + 1) * stride + 1]);
+	});
+
+	for_bands(tp, h, [&](size_t y0, size_t y1) {
+		std::vector<size_t> &lst = bands[y0];
+
+		for (size_t y = y0; y < y1; ++y) {
+			const uint8_t *p = &padded[(y + 1) * stride + 1];
+
+			for (size_t x = 0; x < w; ++x, ++p) {
+				unsigned h1 = *p + 1;
+				unsigned top = std::max({ p[-stride - 1], p[-stride], p[-stride + 1], p[-1], p[1], p[stride - 1], p[stride], p[stride + 1] });
+
+				if (top > h1)
+					lst.emplace_back(y * w + x);
+			}
 		}
+	});
+
+	std::vector<size_t> todo;
+
+	for (auto it = bands.rbegin(); it != bands.rend(); ++it)
+		todo.insert(todo.end(), it->rbegin(), it->rend());
+
+	return lower_slopes(hmap, w, h, todo);
+}
+
+/** Subimage of desert or grass at height \a h0 with neighbour heights \a hh, or 0 if it is not on a slope. */
+static unsigned slope_subimage(unsigned h0, const std::array<unsigned, 8> &hh) {
+	if (h0 > hh[3] && h0 > hh[6])
+		return 23;
+#if 0
+	else if (hh[3] == h0 && hh[4] == h0 && hh[1] > h0) {
+		if (hh[2] == h0)
+			return 10; // 0 edge up
+		else
+			return 16;
 	}
+#else
+	else if (hh[1] > h0 && hh[3] > h0 && hh[4] == h0 && hh[6] == h0 && hh[7] == h0)
+		return 22; // 7 edge down
+	else if (hh[1] == h0 && hh[4] == h0 && hh[6] == h0 && hh[3] > h0)
+		return 14; // 3 side up
+	else if (hh[3] == h0 && hh[4] == h0 && hh[6] == h0 && hh[1] > h0)
+		return 16; // 1 side up
+	else if (hh[4] == h0 && hh[6] == h0 && (hh[1] > h0 && hh[3] > h0))
+		return 10; // 0 edge up
+	else if (hh[1] == h0 && hh[4] == h0 && (hh[3] > h0 || hh[6] > h0))
+		return 11; // 5 edge up
+	else if (hh[1] == h0 && hh[3] == h0 && (hh[4] > h0 || hh[6] > h0))
+		return 9; // 7 edge up
+	else if (hh[3] == h0 && hh[6] == h0 && (hh[1] > h0 || hh[4] > h0))
+		return 12; // 2 edge up
+#endif
+
+	return 0;
 }
 
-void Terrain::smooth_slopes() {
+void Terrain::smooth_slopes(std::vector<tile_t> &tiles, std::vector<uint8_t> &hmap, ctpl::thread_pool *tp) {
 	bool changed = true;
 	Vector2dView grid(tiles, w);
 
 	std::set<size_t> hlower;
 
 	for (size_t runs = 0; changed && runs < std::max(w, h); ++runs) {
-		changed = false;
-
-		for (size_t y = 0; y < h; ++y) {
-			for (size_t x = 0; x < w; ++x) {
-				size_t idx = grid.idx(x, y);
-				unsigned h0 = hmap[idx];
-				auto hh = heights(hmap, w, h, x, y, h0);
-
-				for (unsigned i = 0; i < hh.size(); ++i) {
-					if (hh[i] > h0 + 1) {
-						size_t idx2 = pos_dir(w, x, y, i);
-						hmap[idx2] = h0 + 1;
-						changed = true;
-					}
-				}
-			}
-		}
+		changed = limit_slopes(hmap, w, h, tp);
 
 		if (!changed)
 			break;
@@ -281,40 +453,13 @@ void Terrain::smooth_slopes() {
 					continue;
 
 				// try to deduce subimage
-				if (h0 > hh[3] && h0 > hh[6]) {
-					tiles[idx] = tile_id(t, 23);
-					hlower.emplace(idx);
-				}
-#if 0
-				else if (hh[3] == h0 && hh[4] == h0 && hh[1] > h0) {
-					if (hh[2] == h0)
-						tiles[idx] = tile_id(t, 10); // 0 edge up
-					else
-						tiles[idx] = tile_id(t, 16);
-				}
-#else
-				else if (hh[1] > h0 && hh[3] > h0 && hh[4] == h0 && hh[6] == h0 && hh[7] == h0) {
-					tiles[idx] = tile_id(t, 22); // 7 edge down
-				}
-				else if (hh[1] == h0 && hh[4] == h0 && hh[6] == h0 && hh[3] > h0) {
-					tiles[idx] = tile_id(t, 14); // 3 side up
-				}
-				else if (hh[3] == h0 && hh[4] == h0 && hh[6] == h0 && hh[1] > h0) {
-					tiles[idx] = tile_id(t, 16); // 1 side up
-				}
-				else if (hh[4] == h0 && hh[6] == h0 && (hh[1] > h0 && hh[3] > h0)) {
-					tiles[idx] = tile_id(t, 10); // 0 edge up
-				}
-				else if (hh[1] == h0 && hh[4] == h0 && (hh[3] > h0 || hh[6] > h0)) {
-					tiles[idx] = tile_id(t, 11); // 5 edge up
-				}
-				else if (hh[1] == h0 && hh[3] == h0 && (hh[4] > h0 || hh[6] > h0)) {
-					tiles[idx] = tile_id(t, 9); // 7 edge up
-				}
-				else if (hh[3] == h0 && hh[6] == h0 && (hh[1] > h0 || hh[4] > h0)) {
-					tiles[idx] = tile_id(t, 12); // 2 edge up
+				unsigned img = slope_subimage(h0, hh);
+
+				if (img) {
+					tiles[idx] = tile_id(t, img);
+					if (img == 23)
+						hlower.emplace(idx);
 				}
-#endif
 			}
 		}
 	}
@@ -324,4 +469,243 @@ void Terrain::smooth_slopes() {
 	}
 }
 
+
+/** What a tile was before the transition passes got to it. */
+static constexpr TileType paint_base(TileType t) noexcept {
+	switch (t) {
+	case TileType::water_desert: return TileType::desert;
+	case TileType::grass_desert: return TileType::grass;
+	case TileType::deepwater_water: return TileType::deepwater;
+	default: return t;
+	}
+}
+
+/** New tile of type \a t with the same kind of subimage tgen_normal would give it. */
+static tile_t paint_tile(TileType t) {
+	return Terrain::tile_id(t, t == TileType::desert ? rand() % 9 : 0);
+}
+
+bool Terrain::paint(const std::vector<TilePaint> &lst) {
+	ZoneScoped;
+	// tiles can change type up to paint_halo tiles away, their subimages one further, heights up to
+	// max_height further and the ring around that is only looked at
+	static constexpr unsigned margin = paint_halo + 1 + max_height + 2;
+
+	unsigned px0 = w, py0 = h, px1 = 0, py1 = 0;
+	bool changed = false;
+
+	for (const TilePaint &p : lst) {
+		if (p.x >= w || p.y >= h)
+			continue;
+
+		changed |= paint_base(tile_type(tile_at(p.x, p.y))) != paint_base(p.type);
+
+		px0 = std::min(px0, p.x);
+		py0 = std::min(py0, p.y);
+		px1 = std::max(px1, p.x);
+		py1 = std::max(py1, p.y);
+	}
+
+	if (!changed)
+		return false;
+
+	unsigned x0 = px0 > margin ? px0 - margin : 0, x1 = std::min(w, px1 + margin + 1);
+	unsigned y0 = py0 > margin ? py0 - margin : 0, y1 = std::min(h, py1 + margin + 1);
+	unsigned ww = x1 - x0, wh = y1 - y0;
+
+	std::vector<tile_t> tiles;
+	std::vector<uint8_t> hmap;
+
+	fetch(tiles, hmap, x0, y0, ww, wh);
+
+	const std::vector<tile_t> old_tiles(tiles);
+	const std::vector<uint8_t> old_hmap(hmap);
+
+	// distance to the nearest painted tile, as far as we care, and what it has been painted with
+	std::vector<uint8_t> near((size_t)ww * wh, UINT8_MAX);
+	std::vector<TileType> near_type((size_t)ww * wh, TileType::desert);
+	const int reach = paint_halo + 1;
+
+	for (const TilePaint &p : lst) {
+		if (p.x >= w || p.y >= h)
+			continue;
+
+		int px = p.x - x0, py = p.y - y0;
+		TileType t = paint_base(p.type);
+
+		for (int y = std::max(0, py - reach); y <= std::min((int)wh - 1, py + reach); ++y) {
+			for (int x = std::max(0, px - reach); x <= std::min((int)ww - 1, px + reach); ++x) {
+				size_t idx = (size_t)y * ww + x;
+				unsigned d = std::max(std::abs(x - px), std::abs(y - py));
+
+				if (d <= near[idx]) {
+					near[idx] = d;
+					near_type[idx] = t;
+				}
+			}
+		}
+
+		tiles[(size_t)py * ww + px] = paint_tile(t);
+	}
+
+	// shores and overlays are made again from the base types, like fix_tile_transitions does for the whole map.
+	// we don't know what a shore was before, so if it is not next to water any more, it becomes whatever land is painted next to it
+	for (size_t i = 0, n = tiles.size(); i < n; ++i) {
+		if (near[i] > paint_halo)
+			continue;
+
+		TileType t = tile_type(tiles[i]);
+
+		if (t == TileType::water_desert)
+			tiles[i] = paint_tile(near_type[i] == TileType::grass ? TileType::grass : TileType::desert);
+		else if (t == TileType::grass_desert)
+			tiles[i] = paint_tile(TileType::grass);
+	}
+
+	PaddedTypes pt(ww, wh);
+	pt.load(tiles, ww, 0, wh);
+
+	for (size_t y = 0; y < wh; ++y) {
+		uint8_t *p = pt.at(0, y);
+
+		for (size_t x = 0; x < ww; ++x, ++p) {
+			size_t idx = y * ww + x;
+
+			if (near[idx] > paint_halo)
+				continue;
+
+			if (in(water_types, *p)) {
+				hmap[idx] = 0;
+			} else if (pt.hv(p, water_types) | pt.diag(p, water_types)) {
+				tiles[idx] = tile_id(TileType::water_desert, 0);
+				hmap[idx] = 0;
+				*p = (uint8_t)TileType::water_desert;
+			}
+		}
+	}
+
+	for (size_t y = 0; y < wh; ++y) {
+		uint8_t *p = pt.at(0, y);
+
+		for (size_t x = 0; x < ww; ++x, ++p) {
+			size_t idx = y * ww + x;
+
+			if (near[idx] <= paint_halo && *p == (uint8_t)TileType::water_desert && water_desert_invalid[pt.hv(p, water_types)]) {
+				tiles[idx] = tile_id(TileType::water, 0);
+				*p = (uint8_t)TileType::water;
+			}
+		}
+	}
+
+	for (size_t y = 0; y < wh; ++y) {
+		const uint8_t *p = pt.at(0, y);
+
+		for (size_t x = 0; x < ww; ++x, ++p) {
+			size_t idx = y * ww + x;
+
+			if (near[idx] > paint_halo + 1)
+				continue;
+
+			if (*p == (uint8_t)TileType::water_desert) {
+				unsigned edges = pt.hv(p, 1 << (unsigned)TileType::water);
+				unsigned subimage = edges ? water_desert_edge[edges] : water_desert_corner[pt.diag(p, 1 << (unsigned)TileType::water)];
+
+				tiles[idx] = tile_id(TileType::water_desert, subimage);
+			} else if (*p == (uint8_t)TileType::grass || *p == (uint8_t)TileType::grass_desert) {
+				unsigned bits = grass_desert_bits[pt.hv(p, shore_types)];
+
+				// plain grass keeps its subimage, as it may be on a slope
+				if (bits)
+					tiles[idx] = tile_id(TileType::grass_desert, bits << (16 - 4 - 3));
+				else if (*p == (uint8_t)TileType::grass_desert)
+					tiles[idx] = tile_id(TileType::grass, 0);
+			}
+		}
+	}
+
+	// same as fix_water_transitions, but only for the shores that may be new
+	for (size_t y = 0; y < wh; ++y) {
+		for (size_t x = 0; x < ww; ++x) {
+			size_t idx = y * ww + x;
+
+			if (near[idx] > paint_halo || tile_type(tiles[idx]) != TileType::water_desert)
+				continue;
+
+			unsigned h0 = hmap[idx];
+
+			if (y > 0)      hmap[idx - ww] = h0;
+			if (y < wh - 1) hmap[idx + ww] = h0;
+			if (x > 0)      hmap[idx - 1] = h0;
+			if (x < ww - 1) hmap[idx + 1] = h0;
+		}
+	}
+
+	std::vector<size_t> todo;
+
+	for (size_t i = 0, n = hmap.size(); i < n; ++i)
+		if (hmap[i] != old_hmap[i])
+			todo.emplace_back(i);
+
+	lower_slopes(hmap, ww, wh, todo);
+
+	// desert and grass that have changed or are next to tiles with new heights may be on another slope
+	for (size_t y = 0; y < wh; ++y) {
+		for (size_t x = 0; x < ww; ++x) {
+			size_t idx = y * ww + x;
+			TileType t = tile_type(tiles[idx]);
+
+			if (t != TileType::desert && t != TileType::grass)
+				continue;
+
+			bool dirty = tiles[idx] != old_tiles[idx];
+
+			for (size_t ny = y ? y - 1 : y; !dirty && ny < std::min<size_t>(wh, y + 2); ++ny)
+				for (size_t nx = x ? x - 1 : x; nx < std::min<size_t>(ww, x + 2); ++nx)
+					dirty |= hmap[ny * ww + nx] != old_hmap[ny * ww + nx];
+
+			if (!dirty)
+				continue;
+
+			unsigned h0 = hmap[idx];
+			unsigned img = slope_subimage(h0, heights(hmap, ww, wh, x, y, h0));
+
+			if (img)
+				tiles[idx] = tile_id(t, img);
+			else if (tile_img(tiles[idx]) > 8) // flat again
+				tiles[idx] = paint_tile(t);
+		}
+	}
+
+	// only store what has changed, so whoever looks at the chunk versions only has to look at the chunks around the painted tiles
+	unsigned cx0 = ww, cy0 = wh, cx1 = 0, cy1 = 0;
+
+	for (unsigned y = 0; y < wh; ++y) {
+		for (unsigned x = 0; x < ww; ++x) {
+			size_t idx = (size_t)y * ww + x;
+
+			if (tiles[idx] != old_tiles[idx] || hmap[idx] != old_hmap[idx]) {
+				cx0 = std::min(cx0, x);
+				cy0 = std::min(cy0, y);
+				cx1 = std::max(cx1, x);
+				cy1 = std::max(cy1, y);
+			}
+		}
+	}
+
+	if (cx0 > cx1)
+		return false;
+
+	unsigned aw = cx1 - cx0 + 1, ah = cy1 - cy0 + 1;
+	std::vector<tile_t> at((size_t)aw * ah);
+	std::vector<uint8_t> ahm((size_t)aw * ah);
+
+	for (unsigned y = 0; y < ah; ++y) {
+		std::copy_n(&tiles[(size_t)(y + cy0) * ww + cx0], aw, &at[(size_t)y * aw]);
+		std::copy_n(&hmap[(size_t)(y + cy0) * ww + cx0], aw, &ahm[(size_t)y * aw]);
+	}
+
+	set(at, ahm, x0 + cx0, y0 + cy0, aw, ah);
+	return true;
+}
+
 }
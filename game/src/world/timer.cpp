@@ -0,0 +1,84 @@
+#include "timer.hpp"
+
+#include <algorithm>
+
+#include <tracy/Tracy.hpp>
+
+namespace aoe {
+
+void TimerWheel::reset(uint32_t tick) {
+	for (auto &level : wheel)
+		for (std::vector<EntityTimer> &slot : level)
+			slot.clear();
+
+	overflow.clear();
+	now = tick;
+	count = 0;
+}
+
+void TimerWheel::add(const EntityTimer &t) {
+	int64_t delta = (int32_t)(t.tick - now);
+
+	for (unsigned level = 0; level < levels; ++level) {
+		if (delta >> (slot_bits * (level + 1)))
+			continue;
+
+		wheel[level][(t.tick >> (slot_bits * level)) % slots].emplace_back(t);
+		return;
+	}
+
+	overflow.emplace_back(t);
+}
+
+void TimerWheel::schedule(const EntityTimer &t) {
+	// too late already, just fire as soon as possible
+	if ((int32_t)(t.tick - now) <= 0)
+		add(EntityTimer(now + 1, t.ref, t.type));
+	else
+		add(t);
+
+	++count;
+}
+
+/** Move all timers in the current slot of \a level down to where they belong now. */
+void TimerWheel::cascade_slot(unsigned level) {
+	std::vector<EntityTimer> &slot = wheel[level][(now >> (slot_bits * level)) % slots];
+
+	cascade.clear();
+	std::swap(cascade, slot);
+
+	for (const EntityTimer &t : cascade)
+		add(t);
+}
+
+void TimerWheel::advance(uint32_t tick, std::vector<EntityTimer> &due) {
+	ZoneScoped;
+	size_t first = due.size();
+
+	while ((int32_t)(tick - now) > 0) {
+		++now;
+
+		// a turn of level 0 is complete, so bring in the next slot from above and so on
+		unsigned level = 1;
+		for (; level < levels && !(now % (1u << (slot_bits * level))); ++level)
+			cascade_slot(level);
+
+		if (level == levels && !(now % (1u << (slot_bits * levels)))) {
+			cascade.clear();
+			std::swap(cascade, overflow);
+
+			for (const EntityTimer &t : cascade)
+				add(t);
+		}
+
+		std::vector<EntityTimer> &slot = wheel[0][now % slots];
+
+		count -= slot.size();
+		due.insert(due.end(), slot.begin(), slot.end());
+		slot.clear();
+	}
+
+	std::sort(due.begin() + first, due.end());
+}
+
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <idpool.hpp>
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+namespace aoe {
+
+enum class EntityTimerType {
+	died, // death animation is done, start decaying
+	decayed, // corpse has rotted away
+};
+
+/** Something that happens to an entity at an absolute tick. */
+class EntityTimer final {
+public:
+	uint32_t tick;
+	IdPoolRef ref;
+	EntityTimerType type;
+
+	EntityTimer(uint32_t tick, IdPoolRef ref, EntityTimerType type) : tick(tick), ref(ref), type(type) {}
+
+	friend bool operator<(const EntityTimer &lhs, const EntityTimer &rhs) noexcept {
+		if (lhs.tick != rhs.tick)
+			return lhs.tick < rhs.tick;
+		if (lhs.ref != rhs.ref)
+			return lhs.ref < rhs.ref;
+		return lhs.type < rhs.type;
+	}
+};
+
+/**
+ * Hierarchical timer wheel. Level 0 has a slot for each of the next 64 ticks and every next level
+ * has 64 slots that each span a whole turn of the level below. When a turn of a level completes,
+ * the next slot of the level above is cascaded down, so scheduling and expiring are O(1) no matter
+ * how far ahead a timer is. Timers beyond the last level wait in an overflow list.
+ *
+ * Due timers are returned sorted by EntityTimer::operator<, so all peers handle them in the same order.
+ */
+class TimerWheel final {
+	static constexpr unsigned slot_bits = 6, slots = 1u << slot_bits, levels = 4;
+
+	std::array<std::array<std::vector<EntityTimer>, slots>, levels> wheel;
+	std::vector<EntityTimer> overflow, cascade;
+	uint32_t now; // all timers up to and including now have expired
+	size_t count;
+
+	void add(const EntityTimer&);
+	void cascade_slot(unsigned level);
+public:
+	TimerWheel() : wheel(), overflow(), cascade(), now(0), count(0) {}
+
+	/** Drop all timers and start counting at \a tick. */
+	void reset(uint32_t tick);
+
+	/** Fire \a t at t.tick or at the next advance if t.tick has passed already. */
+	void schedule(const EntityTimer &t);
+
+	/** Expire all timers up to and including \a tick and append them to \a due in order. */
+	void advance(uint32_t tick, std::vector<EntityTimer> &due);
+
+	size_t size() const noexcept { return count; }
+};
+
+}
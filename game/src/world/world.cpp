@@ -4,7 +4,7 @@
 
 #include <array>
 #include <chrono>
-#include <random>
+#include <cstdio>
 #include <algorithm>
 
 #include <tracy/Tracy.hpp>
@@ -16,54 +16,38 @@ Entity &WorldView::at(IdPoolRef r) {
 }
 
 Entity *WorldView::try_get(IdPoolRef r) {
-	return w.entities.try_get(r);
-}
+	if (!frozen)
+		return w.entities.try_get(r);
 
-Entity *WorldView::try_get_alive(float x, float y, EntityType t) {
-	Entity *closest = nullptr;
-	double d = DBL_MAX;
-
-	// special case for trees
-	if (is_tree(t)) {
-		for (auto it = w.entities.begin(); it != w.entities.end(); ++it) {
-			Entity &e = it->second;
-			if (e.is_alive() && is_tree(e.type)) {
-				double dx = e.x - x, dy = e.y - y;
-				double d2 = sqrt(dx * dx + dy * dy);
-
-				if (d2 < d) {
-					d = d2;
-					closest = &e;
-				}
-			}
-		}
-
-		return closest;
-	}
-
-	// find exact match
-	for (auto it = w.entities.begin(); it != w.entities.end(); ++it) {
-		Entity &e = it->second;
+	auto it = std::lower_bound(frozen->begin(), frozen->end(), r, [](const Entity &e, IdPoolRef r) { return e.ref < r; });
+	return it != frozen->end() && it->ref == r ? const_cast<Entity*>(&*it) : nullptr;
+}
 
-		if (e.is_alive() && e.type == t) {
-			double dx = e.x - x, dy = e.y - y;
-			double d2 = sqrt(dx * dx + dy * dy);
+Path *WorldView::try_path(const Entity &e) {
+	return w.paths.try_get(e.ref);
+}
 
-			if (d2 < d) {
-				d = d2;
-				closest = &e;
-			}
-		}
-	}
+Entity *WorldView::try_get_alive(float x, float y, EntityType t) {
+	IdPoolRef ref = w.spatial.nearest(x, y, [this, t](IdPoolRef r) {
+		const Entity *e = w.entities.try_get(r);
+		return e && e->is_alive() && e->is_type(t);
+	});
 
-	return closest;
+	return w.entities.try_get(ref);
 }
 
 World::World()
-	: m(), m_events(), t(), entities(), dirty_entities(), spawned_entities()
+	: m(), t(), entities(), spatial(), paths(), dirty_entities(), spawned_entities()
+	, died_entities(), killed_entities(), active_entities(), timers(), timers_due()
 	, particles(), spawned_particles()
-	, players(), player_achievements(), events_in(), events_out(), views()
-	, resources_out(), s(nullptr), gameover(false), scn(), logic_gamespeed((unsigned)(1.0 / World::gamespeed_step)), running(false) {}
+	, players(), player_achievements()
+	, events_in(event_queue_size), events_batch(), events_draining(false), events_stalled(0), events_dropped(0), events_out(), views()
+	, resources_out(), s(nullptr), gameover(false)
+	, tp(), tick_slots(), tick_targets(), tick_buffers(), tick_merged(), tick_stats()
+	, ticks(0), rng(), lockstep_inputs(), replay(), lockstep_hashes(), desynced()
+	, scn(), logic_gamespeed((unsigned)(1.0 / World::gamespeed_step)), running(false), replay_path()
+	, tick_rate(DEFAULT_TICKS_PER_SECOND), snapshot_rate(DEFAULT_TICKS_PER_SECOND), max_catchup(max_catchup_default)
+	, tick_threads(std::thread::hardware_concurrency()) {}
 
 void World::load_sp_players() {
 	this->scn.players.clear();
@@ -93,6 +77,7 @@ void World::load_scn(const ScenarioSettings &scn) {
 	this->scn.square = scn.square;
 	this->scn.wrap = scn.wrap;
 	this->scn.type = scn.type;
+	this->scn.lockstep = scn.lockstep;
 
 	t.resize(this->scn.width, this->scn.height, this->scn.seed, this->scn.players.size(), this->scn.wrap, this->scn.type);
 }
@@ -100,7 +85,13 @@ void World::load_scn(const ScenarioSettings &scn) {
 void World::create_terrain() {
 	ZoneScoped;
 	this->t.resize(scn.width, scn.height, scn.seed, scn.players.size(), scn.wrap, scn.type);
-	this->t.generate();
+
+	if (tp.size() < (int)tick_threads)
+		tp.resize(tick_threads);
+
+	this->t.generate(&tp);
+	// build the whole graph now (slow on big maps), so ticks only have to update the parts that change
+	paths.reset(this->t);
 }
 
 NetTerrainMod World::fetch_terrain(int x, int y, unsigned &w, unsigned &h) {
@@ -133,35 +124,210 @@ void WorldView::collect(unsigned player, const Resources &res) {
 	w.resources_out.emplace(player);
 }
 
+void WorldView::wake(const Entity &e) {
+	w.wake(e.ref);
+}
+
+void World::wake(IdPoolRef ref) {
+	const Entity *ent = entities.try_get(ref);
+
+	// buildings don't do anything on their own (yet)
+	if (ent && !ent->is_building())
+		active_entities.emplace(ref);
+}
+
+void World::rest(Entity &ent) {
+	active_entities.erase(ent.ref);
+
+	if (ent.is_building() || is_resource(ent.type))
+		return;
+
+	uint32_t at = ticks + ent.anim_ticks_left();
+
+	if (ent.state == EntityState::dying)
+		timers.schedule(EntityTimer(at, ent.ref, EntityTimerType::died));
+	else if (ent.state == EntityState::decaying)
+		timers.schedule(EntityTimer(at, ent.ref, EntityTimerType::decayed));
+}
+
+/** Handle everything that is scheduled up to now. Timers of entities that are gone or doing something else are ignored. */
+void World::fire_timers() {
+	ZoneScoped;
+	timers_due.clear();
+	timers.advance(ticks, timers_due);
+
+	for (const EntityTimer &t : timers_due) {
+		Entity *ent = entities.try_get(t.ref);
+		if (!ent)
+			continue;
+
+		switch (t.type) {
+		case EntityTimerType::died:
+			if (ent->state != EntityState::dying)
+				break;
+
+			ent->decay();
+			dirty_entities.emplace(t.ref);
+			rest(*ent);
+			break;
+		case EntityTimerType::decayed:
+			if (ent->state == EntityState::decaying)
+				nuke_ref(t.ref);
+			break;
+		}
+	}
+}
+
+/**
+ * Tick all active entities. Entities only modify themselves while ticking and see their targets as they
+ * were at the start of the tick, so this can be split over multiple threads. Everything that
+ * affects other entities or players is collected and applied afterwards in merge_tick.
+ * Idle units, resources and buildings are not touched at all, so this scales with the number of busy units.
+ */
 void World::tick_entities() {
 	ZoneScoped;
 
-	WorldView wv(*this);
 	died_entities.clear();
 	killed_entities.clear();
 
-	for (auto &kv : entities) {
-		Entity &ent = kv.second;
+	fire_timers();
+	paths.process(path_budget);
+
+	tick_slots.clear();
+	for (IdPoolRef ref : active_entities)
+		tick_slots.emplace_back((uint32_t)entities.index(ref));
+
+	freeze_targets();
+
+	size_t n = tick_slots.size();
+	size_t chunks = std::max<size_t>(1, std::min<size_t>(tick_threads, n / tick_chunk_min));
+
+	if (tick_buffers.size() < chunks)
+		tick_buffers.resize(chunks);
+
+	for (EntityTickBuffer &buf : tick_buffers)
+		buf.clear();
+
+	if (chunks == 1) {
+		tick_range(0, n, tick_buffers[0]);
+	} else {
+		if (tp.size() < (int)chunks)
+			tp.resize(chunks);
+
+		std::vector<std::future<void>> jobs;
+		size_t step = (n + chunks - 1) / chunks;
 
-		if (is_building(ent.type))
+		for (size_t i = 0, from = 0; i < chunks; ++i, from += step) {
+			size_t to = std::min(n, from + step);
+			jobs.emplace_back(tp.push([this, from, to, i](int) { tick_range(from, to, tick_buffers[i]); }));
+		}
+
+		for (std::future<void> &f : jobs)
+			f.get();
+	}
+
+	merge_tick();
+
+	// forget paths of entities that have arrived or are doing something else now
+	paths.retain([this](IdPoolRef ref) {
+		const Entity *ent = entities.try_get(ref);
+		return ent && ent->state == EntityState::moving;
+	});
+
+	// now iterate all died entities
+	for (IdPoolRef ref : died_entities) {
+		Entity &ent = entities.at(ref);
+		players[ent.playerid].lost_entity(ref);
+		rest(ent);
+	}
+
+	// now iterate all killed entities
+	for (IdPoolRef ref : killed_entities)
+		nuke_ref(ref);
+}
+
+/** Copy all entities that are targeted by another entity, so they can be read while their owner is ticking. */
+void World::freeze_targets() {
+	ZoneScoped;
+	tick_targets.clear();
+
+	// only active entities look at their target
+	for (uint32_t i : tick_slots) {
+		const Entity &ent = (entities.begin() + i)->second;
+
+		if (ent.target_ref == invalid_ref)
 			continue;
 
-		bool alive = ent.is_alive();
-		bool dirty = ent.tick(wv), tdirty = false;
-		bool more = ent.imgtick(1);
+		Entity *t = entities.try_get(ent.target_ref);
+		if (t)
+			tick_targets.emplace_back(*t);
+	}
+
+	std::sort(tick_targets.begin(), tick_targets.end());
+	tick_targets.erase(std::unique(tick_targets.begin(), tick_targets.end(),
+		[](const Entity &lhs, const Entity &rhs) { return lhs.ref == rhs.ref; }), tick_targets.end());
+}
 
-		if (alive && !ent.is_alive())
-			died_entities.emplace(ent.ref);
+/**
+ * Tick entities in tick_slots [\a from, \a to). Must not touch anything but these entities and \a buf.
+ * Movement and animation are batched in \a buf, so both are simple loops over arrays.
+ */
+void World::tick_range(size_t from, size_t to, EntityTickBuffer &buf) {
+	ZoneScoped;
+	WorldView wv(*this, &tick_targets);
+	auto slot = [this](uint32_t i) -> Entity& { return (entities.begin() + i)->second; };
+
+	// run state machines. anyone who walks, adds themself to buf.motion
+	for (size_t i = from; i < to; ++i) {
+		Entity &ent = slot(tick_slots[i]);
+		uint32_t row = buf.slots.size();
+
+		buf.slots.emplace_back(tick_slots[i]);
+		buf.was_alive.emplace_back(ent.is_alive());
+		buf.changed.emplace_back(ent.tick(wv, buf.motion, row));
+		buf.more.emplace_back(1);
+	}
+
+	buf.motion.step();
+
+	for (size_t i = 0; i < buf.motion.size(); ++i) {
+		uint32_t row = buf.motion.row[i];
+		Entity &ent = slot(buf.slots[row]);
+
+		ent.x = Fixed::from_raw(buf.motion.x[i]);
+		ent.y = Fixed::from_raw(buf.motion.y[i]);
+		ent.leg_ticks = (uint32_t)std::max(buf.motion.ticks[i], 0);
+
+		buf.changed[row] |= ent.stepped(wv, buf.motion.arrived[i]);
+	}
+
+	for (size_t row = 0; row < buf.slots.size(); ++row) {
+		Entity &ent = slot(buf.slots[row]);
+		AnimStep a;
+
+		if (ent.anim_step(1, a))
+			buf.anim.add(row, ent.subimage, a);
+	}
+
+	buf.anim.advance();
+
+	for (size_t i = 0; i < buf.anim.size(); ++i) {
+		uint32_t row = buf.anim.row[i];
+
+		slot(buf.slots[row]).subimage = buf.anim.subimage[i];
+		buf.more[row] = buf.anim.more[i];
+	}
+
+	for (size_t row = 0; row < buf.slots.size(); ++row) {
+		Entity &ent = slot(buf.slots[row]);
+		bool dirty = buf.changed[row], more = buf.more[row];
+
+		if (buf.was_alive[row] && !ent.is_alive())
+			buf.died.emplace_back(ent.ref);
 
 		switch (ent.state) {
-			case EntityState::dying:
-				if (!more) {
-					ent.decay();
-					dirty = true;
-				}
-				break;
 			case EntityState::attack: {
-				Entity *t = entities.try_get(ent.target_ref);
+				const Entity *t = wv.try_get(ent.target_ref);
 
 				if (!t || !t->is_alive()) {
 					ent.task_cancel();
@@ -169,59 +335,99 @@ void World::tick_entities() {
 					break;
 				}
 
-				if (!more) {
-					// prevent killing the entity twice. yes i've debug tested this can happen
-					bool was_alive = t->is_alive();
-					//printf("TODO attack (%u,%u) to (%u,%u)\n", ent.ref.first, ent.ref.second, ent.target_ref.first, ent.target_ref.second);
-					if (was_alive) {
-						dirty |= t->hit(wv, ent);
-						dirty_entities.emplace(t->ref);
-					}
-
-					auto it = died_entities.find(t->ref);
-					// if t died just now
-					if (!t->is_alive()) {
-						if (is_building(t->type))
-							spawn_particle(ParticleType::explode2, t->x, t->y);
-
-						died_entities.emplace(t->ref);
-						ent.task_cancel();
-						dirty = true;
-					}
-
-					// if t died just now, remove from player
-					if (!t->is_alive() && was_alive) {
-						if (is_resource(t->type)) {
-							killed_entities.emplace(t->ref);
-							ent.task_cancel();
-							dirty = true;
-						} else if (t->playerid != Player::gaia) { // update score but ensure entity isn't owned by gaia
-							if (is_building(t->type))
-								players[ent.playerid].killed_building();
-							else
-								players[ent.playerid].killed_unit();
-						}
-					}
-
-					// TODO conversion is not detected!
-				}
+				if (!more)
+					buf.hits.emplace_back(ent.ref, t->ref);
 				break;
 			}
 		}
 
 		if (dirty)
-			dirty_entities.emplace(ent.ref);
+			buf.dirty.emplace_back(ent.ref);
+
+		// nothing left to do until someone gives us a task or hits us
+		if (ent.state == EntityState::alive && ent.hp)
+			buf.idle.emplace_back(ent.ref);
 	}
+}
 
-	// now iterate all died entities
-	for (IdPoolRef ref : died_entities) {
-		Entity &ent = entities.at(ref);
-		players[ent.playerid].lost_entity(ref);
+/** Apply all tick buffers in ref order, so the outcome does not depend on how the entities were split. */
+void World::merge_tick() {
+	ZoneScoped;
+	EntityTickBuffer &all = tick_merged;
+	all.clear();
+
+	for (const EntityTickBuffer &buf : tick_buffers) {
+		all.dirty.insert(all.dirty.end(), buf.dirty.begin(), buf.dirty.end());
+		all.died.insert(all.died.end(), buf.died.begin(), buf.died.end());
+		all.idle.insert(all.idle.end(), buf.idle.begin(), buf.idle.end());
+		all.hits.insert(all.hits.end(), buf.hits.begin(), buf.hits.end());
 	}
 
-	// now iterate all killed entities
-	for (IdPoolRef ref : killed_entities)
-		nuke_ref(ref);
+	std::sort(all.dirty.begin(), all.dirty.end());
+	std::sort(all.hits.begin(), all.hits.end());
+
+	for (IdPoolRef ref : all.dirty) {
+		const Entity &ent = entities.at(ref);
+		dirty_entities.emplace(ref);
+		spatial.move(ref, ent.x, ent.y);
+	}
+
+	died_entities.insert(all.died.begin(), all.died.end());
+
+	for (IdPoolRef ref : all.idle)
+		active_entities.erase(ref);
+
+	WorldView wv(*this);
+
+	for (auto [ref, tref] : all.hits) {
+		Entity &ent = entities.at(ref);
+		Entity *t = entities.try_get(tref);
+
+		// attacker may have been killed by an earlier hit
+		if (!t || !ent.is_alive())
+			continue;
+
+		bool dirty = false;
+
+		// prevent killing the entity twice. yes i've debug tested this can happen
+		bool was_alive = t->is_alive();
+		if (was_alive) {
+			dirty |= t->hit(wv, ent);
+			dirty_entities.emplace(t->ref);
+			wake(t->ref);
+		}
+
+		// if t died just now
+		if (!t->is_alive()) {
+			if (is_building(t->type))
+				spawn_particle(ParticleType::explode2, t->x, t->y);
+
+			died_entities.emplace(t->ref);
+			ent.task_cancel();
+			dirty = true;
+		}
+
+		// if t died just now, remove from player
+		if (!t->is_alive() && was_alive) {
+			if (is_resource(t->type)) {
+				killed_entities.emplace(t->ref);
+				ent.task_cancel();
+				dirty = true;
+			} else if (t->playerid != Player::gaia) { // update score but ensure entity isn't owned by gaia
+				if (is_building(t->type))
+					players[ent.playerid].killed_building();
+				else
+					players[ent.playerid].killed_unit();
+			}
+		}
+
+		// TODO conversion is not detected!
+
+		if (dirty) {
+			dirty_entities.emplace(ent.ref);
+			spatial.move(ent.ref, ent.x, ent.y);
+		}
+	}
 }
 
 /** Iterate all particles and remove those whose animation has ended. */
@@ -296,9 +502,82 @@ void World::stop(unsigned team) {
 void World::tick() {
 	ZoneScoped;
 	std::lock_guard<std::mutex> lk(m);
+
+	using namespace std::chrono;
+	auto t0 = steady_clock::now();
 	tick_entities();
+	auto t1 = steady_clock::now();
 	tick_particles();
+	auto t2 = steady_clock::now();
 	tick_players();
+	auto t3 = steady_clock::now();
+
+	tick_stats.add_phases(duration<double>(t1 - t0).count(), duration<double>(t2 - t1).count(), duration<double>(t3 - t2).count());
+
+	if (++ticks % hash_interval || (!scn.lockstep && !replay))
+		return;
+
+	uint64_t h = state_hash();
+	if (replay)
+		replay->hash(ticks, h);
+
+	lockstep_hashes.emplace(ticks, h);
+	if (lockstep_hashes.size() > hash_history)
+		lockstep_hashes.erase(lockstep_hashes.begin());
+}
+
+/** 64-bit FNV-1a over \a v. */
+template<typename T> static void hash_put(uint64_t &h, T v) noexcept {
+	static_assert(std::is_integral_v<T> || std::is_enum_v<T>);
+	uint64_t u = (uint64_t)v;
+
+	for (unsigned i = 0; i < sizeof(T); ++i, u >>= 8) {
+		h ^= u & 0xff;
+		h *= UINT64_C(0x100000001b3);
+	}
+}
+
+uint64_t World::state_hash() const {
+	ZoneScoped;
+	uint64_t h = UINT64_C(0xcbf29ce484222325);
+
+	hash_put(h, ticks);
+	hash_put(h, rng.get_state());
+	hash_put(h, timers.size());
+
+	// NOTE entities are in creation order, which is the same for all peers
+	for (auto &kv : entities) {
+		const Entity &e = kv.second;
+
+		hash_put(h, e.ref.first);
+		hash_put(h, e.ref.second);
+		hash_put(h, e.type);
+		hash_put(h, e.playerid);
+		hash_put(h, e.x.raw);
+		hash_put(h, e.y.raw);
+		hash_put(h, e.target_ref.first);
+		hash_put(h, e.target_ref.second);
+		hash_put(h, e.target_x.raw);
+		hash_put(h, e.target_y.raw);
+		hash_put(h, e.leg_dx.raw);
+		hash_put(h, e.leg_dy.raw);
+		hash_put(h, e.leg_ticks);
+		hash_put(h, e.state);
+		hash_put(h, e.hp);
+		// animation decides when attacks hit. subimage still advances by fractions of a frame per tick,
+		// so keep a few decimals: truncating it to the frame would hide peers that are almost a frame apart
+		hash_put(h, (int32_t)(e.subimage * 1000));
+	}
+
+	for (const Player &p : players) {
+		hash_put(h, p.alive);
+		hash_put(h, p.res.food);
+		hash_put(h, p.res.wood);
+		hash_put(h, p.res.gold);
+		hash_put(h, p.res.stone);
+	}
+
+	return h;
 }
 
 void World::save_scores() {
@@ -312,25 +591,36 @@ void World::save_scores() {
 /** Process all events sent from peers to us. */
 void World::pump_events() {
 	ZoneScoped;
-	std::lock_guard<std::mutex> lk(m_events);
+	// take everything that is there right now, so producers get their room back before we start processing
+	events_batch.clear();
+	events_in.drain(events_batch);
 
-	for (WorldEvent &ev : events_in) {
+	for (WorldEvent &ev : events_batch) {
 		try {
 			switch (ev.type) {
 			case WorldEventType::entity_kill:
-				if (running)
+				if (running) {
+					if (scn.lockstep || replay)
+						lockstep_inputs.emplace_back(ev);
 					entity_kill(ev);
+				}
 				break;
 			case WorldEventType::peer_cam_move:
 				cam_move(ev);
 				break;
 			case WorldEventType::entity_task:
-				if (running)
+				if (running) {
+					if (scn.lockstep || replay)
+						lockstep_inputs.emplace_back(ev);
 					entity_task(ev);
+				}
 				break;
 			case WorldEventType::gamespeed_control:
 				gamespeed_control(ev);
 				break;
+			case WorldEventType::state_hash:
+				check_state_hash(ev);
+				break;
 			default:
 				LOGF("%s: todo: process event: %u\n", __func__, (unsigned)ev.type);
 				break;
@@ -339,8 +629,6 @@ void World::pump_events() {
 			fprintf(stderr, "%s: bad event: %u\n", __func__, (unsigned)ev.type);
 		}
 	}
-
-	events_in.clear();
 }
 
 /** Send any new changes back to the peers. */
@@ -352,6 +640,7 @@ void World::push_events() {
 
 	push_entities();
 	push_particles();
+	push_terrain();
 
 	for (WorldEvent &ev : events_out) {
 		switch (ev.type) {
@@ -369,47 +658,233 @@ void World::push_events() {
 
 void World::push_entities() {
 	ZoneScoped;
-	NetPkg pkg;
 
-	for (IdPoolRef ref : dirty_entities) {
-		Entity *ent = entities.try_get(ref);
-		if (!ent)
+	// lockstep peers tick the world themselves, so they already know
+	if (scn.lockstep) {
+		dirty_entities.clear();
+		spawned_entities.clear();
+		return;
+	}
+
+	std::vector<NetEntityDelta> lst;
+	Server *ss = dynamic_cast<Server*>(this->s);
+
+	for (auto it = views.begin(); it != views.end();) {
+		// drop views from peers that have left
+		if (ss && !ss->try_peer(it->first)) {
+			it = views.erase(it);
 			continue;
+		}
 
-		pkg.set_entity_update(*ent);
-		s->broadcast(pkg);
+		push_snapshot(it->first, it->second, lst);
+		++it;
 	}
 
 	dirty_entities.clear();
+	spawned_entities.clear();
+}
+
+/**
+ * Collect all entities that have entered, left or changed in the area of interest of \a peer.
+ * A peer can see anything it owns and anything in or near its camera.
+ * NOTE the connection is reliable and ordered, so whatever we have sent will arrive before the next snapshot and we don't need acks.
+ */
+void World::collect_snapshot(IdPoolRef peer, PeerView &v, std::vector<NetEntityDelta> &lst) {
+	ZoneScoped;
+	std::optional<unsigned> idx(ref2idx(peer));
+
+	auto visible = [&](const Entity &ent) {
+		return (idx.has_value() && ent.playerid == idx.value()) || v.can_see(ent.x, ent.y);
+	};
+
+	auto leave = [&](IdPoolRef ref) {
+		EntityView ev;
+		ev.ref = ref;
+		lst.emplace_back(ev, (unsigned)NetEntityDeltaFlags::leave);
+	};
 
 	for (IdPoolRef ref : spawned_entities) {
+		Entity *ent = entities.try_get(ref);
+		if (!ent || !visible(*ent))
+			continue;
+
+		EntityView ev(*ent);
+		lst.emplace_back(ev, (unsigned)NetEntityDeltaFlags::full | (unsigned)NetEntityDeltaFlags::spawn);
+		v.entities.insert_or_assign(ref, ev);
+	}
+
+	for (IdPoolRef ref : dirty_entities) {
+		// already sent in full
+		if (spawned_entities.find(ref) != spawned_entities.end())
+			continue;
+
 		Entity *ent = entities.try_get(ref);
 		if (!ent)
 			continue;
 
-		pkg.set_entity_spawn(*ent);
-		s->broadcast(pkg);
+		auto it = v.entities.find(ref);
+
+		if (!visible(*ent)) {
+			if (it != v.entities.end()) {
+				leave(ref);
+				v.entities.erase(it);
+			}
+			continue;
+		}
+
+		EntityView ev(*ent);
+		unsigned flags = it == v.entities.end() ? (unsigned)NetEntityDeltaFlags::full : NetEntityDelta::diff(it->second, ev);
+
+		if (!flags)
+			continue;
+
+		lst.emplace_back(ev, flags);
+
+		if (it == v.entities.end())
+			v.entities.emplace(ref, ev);
+		else
+			it->second = ev;
 	}
 
-	spawned_entities.clear();
+	if (!v.cam_changed)
+		return;
+
+	v.cam_changed = false;
+
+	for (auto it = v.entities.begin(); it != v.entities.end();) {
+		Entity *ent = entities.try_get(it->first);
+
+		if (ent && !visible(*ent)) {
+			leave(it->first);
+			it = v.entities.erase(it);
+		} else {
+			++it;
+		}
+	}
+
+	float m = PeerView::margin;
+
+	spatial.query_rect(v.cam.x - m, v.cam.y - m, v.cam.x + v.cam.w + m, v.cam.y + v.cam.h + m, [&](IdPoolRef ref) {
+		if (v.entities.find(ref) != v.entities.end())
+			return;
+
+		Entity *ent = entities.try_get(ref);
+		if (!ent)
+			return;
+
+		EntityView ev(*ent);
+		lst.emplace_back(ev, (unsigned)NetEntityDeltaFlags::full);
+		v.entities.emplace(ref, ev);
+	});
+}
+
+void World::push_snapshot(IdPoolRef peer, PeerView &v, std::vector<NetEntityDelta> &lst) {
+	ZoneScoped;
+	NetPkg pkg;
+
+	lst.clear();
+	collect_snapshot(peer, v, lst);
+
+	for (size_t i = 0; i < lst.size();) {
+		i += pkg.set_entity_snapshot(lst, i);
+		send_player(peer, pkg);
+	}
 }
 
 void World::push_particles() {
 	ZoneScoped;
 	NetPkg pkg;
 
+	if (scn.lockstep) {
+		spawned_particles.clear();
+		return;
+	}
+
 	for (IdPoolRef ref : spawned_particles) {
 		Particle *p = particles.try_get(ref);
 		if (!p)
 			continue;
 
 		pkg.particle_spawn(*p);
-		s->broadcast(pkg);
+
+		for (auto &kv : views)
+			if (kv.second.can_see(p->x, p->y))
+				send_player(kv.first, pkg);
 	}
 
 	spawned_particles.clear();
 }
 
+void PeerView::stale_chunks(const Terrain &t, std::vector<unsigned> &lst, size_t max) {
+	ZoneScoped;
+	size_t count = (size_t)t.chunks_w() * t.chunks_h();
+
+	lst.clear();
+
+	if (chunks.size() != count) {
+		chunks.assign(count, 0);
+		terrain_version = 0;
+	}
+
+	if (terrain_version == t.version())
+		return;
+
+	// distance in tiles from the edge of the area of interest to the chunk, so everything in view goes first
+	int32_t left = cam.x - margin, right = cam.x + cam.w + margin;
+	int32_t top = cam.y - margin, bottom = cam.y + cam.h + margin;
+	std::vector<uint64_t> todo;
+
+	for (unsigned cy = 0, i = 0; cy < t.chunks_h(); ++cy) {
+		for (unsigned cx = 0; cx < t.chunks_w(); ++cx, ++i) {
+			if (t.chunk_version(cx, cy) == chunks[i])
+				continue;
+
+			int32_t x0 = cx * Terrain::chunk_size, x1 = x0 + Terrain::chunk_size - 1;
+			int32_t y0 = cy * Terrain::chunk_size, y1 = y0 + Terrain::chunk_size - 1;
+			int32_t dx = std::max({0, left - x1, x0 - right});
+			int32_t dy = std::max({0, top - y1, y0 - bottom});
+
+			todo.emplace_back((uint64_t)std::max(dx, dy) << 32 | i);
+		}
+	}
+
+	if (todo.size() > max) {
+		std::nth_element(todo.begin(), todo.begin() + max, todo.end());
+		todo.resize(max);
+	}
+
+	std::sort(todo.begin(), todo.end());
+
+	for (uint64_t v : todo)
+		lst.emplace_back((unsigned)v);
+}
+
+/** Send terrain chunks that peers don't have yet. Large maps take a few snapshots, but the area around the camera comes first. */
+void World::push_terrain() {
+	ZoneScoped;
+	NetPkg pkg;
+	std::vector<unsigned> lst;
+	unsigned cw = t.chunks_w();
+
+	for (auto &kv : views) {
+		PeerView &v = kv.second;
+		v.stale_chunks(t, lst, terrain_chunks_per_push);
+
+		for (unsigned i : lst) {
+			unsigned cx = i % cw, cy = i / cw;
+			unsigned w = Terrain::chunk_size, h = Terrain::chunk_size;
+			NetTerrainMod tm(fetch_terrain(cx * Terrain::chunk_size, cy * Terrain::chunk_size, w, h));
+
+			pkg.set_terrain_mod(tm);
+			send_player(kv.first, pkg);
+			v.chunks[i] = t.chunk_version(cx, cy);
+		}
+
+		if (lst.size() < terrain_chunks_per_push)
+			v.terrain_version = t.version();
+	}
+}
+
 void World::push_scores() {
 	ZoneScoped;
 	NetPkg pkg;
@@ -480,7 +955,13 @@ void World::push_gamespeed_control(WorldEvent &ev) {
 void World::cam_move(WorldEvent &ev) {
 	ZoneScoped;
 	EventCameraMove move(std::get<EventCameraMove>(ev.data));
-	views.at(move.ref) = move.cam;
+
+	auto it = views.find(move.ref);
+	if (it == views.end())
+		return;
+
+	it->second.cam = move.cam;
+	it->second.cam_changed = true;
 }
 
 unsigned World::set_gamespeed(int v) {
@@ -552,6 +1033,8 @@ void World::entity_kill(WorldEvent &ev) {
 	if (is_resource(ent->type)) {
 		nuke_ref(ref);
 	} else if (ent->die()) {
+		rest(*ent);
+
 		if (is_building(ent->type))
 			spawn_particle(ParticleType::explode2, ent->x, ent->y);
 
@@ -566,13 +1049,20 @@ void World::nuke_ref(IdPoolRef ref) {
 	if (!entities.try_invalidate(ref))
 		return;
 
+	active_entities.erase(ref);
+	spatial.remove(ref);
+
 	for (Player &p : players)
 		p.lost_entity(ref, false);
 
 	// TODO add client info that sent kill command?
 	NetPkg pkg;
 	pkg.set_entity_kill(ref);
-	s->broadcast(pkg);
+
+	// only peers that know about the entity care
+	for (auto &kv : views)
+		if (kv.second.entities.erase(ref))
+			send_player(kv.first, pkg);
 }
 
 bool World::controls_player(IdPoolRef src, unsigned pid) {
@@ -607,6 +1097,8 @@ void World::entity_task(WorldEvent &ev) {
 		case EntityTaskType::move:
 			if (ent->task_move(task.x, task.y)) {
 				dirty_entities.emplace(ent->ref);
+				wake(ent->ref);
+				paths.request(ent->ref, ent->x, ent->y, task.x, task.y);
 				// TODO keep track which player initiated this so we know which peers to send it to
 				spawn_particle(ParticleType::moveto, task.x, task.y);
 			}
@@ -617,15 +1109,26 @@ void World::entity_task(WorldEvent &ev) {
 			if (!target)
 				break;
 
-			if (ent->task_attack(*target))
+			if (ent->task_attack(*target)) {
 				dirty_entities.emplace(ent->ref);
+				wake(ent->ref);
+
+				// e.g. soldiers just walk to resources
+				if (ent->state == EntityState::moving)
+					paths.request(ent->ref, ent->x, ent->y, ent->target_x, ent->target_y);
+			}
 			break;
 		}
 		case EntityTaskType::train_unit: {
-			assert(task.info_type == (unsigned)EntityIconType::unit);
 			EntityType train = (EntityType)task.info_value;
 
-			Resources cost = entity_info.at((unsigned)train).cost;
+			// the peer can send anything here
+			if (task.info_type != (unsigned)EntityIconType::unit || task.info_value >= (unsigned)EntityType::max || !is_unit(train)) {
+				fprintf(stderr, "%s: cannot train entity type %u\n", __func__, task.info_value);
+				break;
+			}
+
+			Resources cost = entity_type_info(train).cost;
 			bool can_train = false;
 			auto idx = ref2idx(ev.src);
 
@@ -704,6 +1207,8 @@ void World::send_initial_player_data(unsigned i, PlayerSetting &p) {
 	s->broadcast(pkg);
 	pkg.set_player_team(i, p.team);
 	s->broadcast(pkg);
+	pkg.set_player_type(i, p.type);
+	s->broadcast(pkg);
 }
 
 void World::sanitize_player_settings(Server &ss) {
@@ -783,50 +1288,75 @@ void World::create_players() {
 		}
 	}
 
-	size_t size = (size_t)scn.width * scn.height;
-	players.clear();
-	for (const PlayerSetting &ps : scn.players)
-		players.emplace_back(ps, size);
+	init_players();
+	views.clear();
 
 	if (ss) {
 		// create player views
 		for (auto kv : ss->peers)
-			views.emplace(kv.second.ref, NetCamSet());
+			views.emplace(kv.second.ref, PeerView());
 		// TODO send view to client
+	} else {
+		// local game: there is no one to hide anything from
+		views.emplace(invalid_ref, PeerView(NetCamSet(0, 0, scn.width, scn.height)));
 	}
 }
 
+void World::init_players() {
+	size_t size = (size_t)scn.width * scn.height;
+	players.clear();
+	for (const PlayerSetting &ps : scn.players)
+		players.emplace_back(ps, size);
+}
+
 void World::add_building(EntityType t, unsigned player, int x, int y) {
 	ZoneScoped;
 	assert(is_building(t) && player < MAX_PLAYERS);
 
 	this->t.add_building(t, x, y);
 
+	unsigned x0, y0, x1, y1;
+	Terrain::building_area(t, x, y, x0, y0, x1, y1);
+	paths.update(this->t, x0, y0, x1 - x0, y1 - y0);
+
 	auto p = entities.emplace(t, player, x, y);
 	assert(p.second);
 
+	spatial.add(p.first->first, x, y);
 	players.at(player).new_entity(p.first->second);
 }
 
 void World::add_unit(EntityType t, unsigned player, float x, float y) {
-	add_unit(t, player, x, y, fmodf(rand(), 360));
+	add_unit(t, player, x, y, rng.real(0, 2 * M_PI));
 }
 
-void World::add_unit(EntityType t, unsigned player, float x, float y, float angle, EntityState state) {
+IdPoolRef World::add_unit(EntityType t, unsigned player, float x, float y, float angle, EntityState state) {
 	ZoneScoped;
 	assert(!is_building(t) && !is_resource(t) && player < MAX_PLAYERS);
 
 	auto p = entities.emplace(t, player, x, y, angle, state);
 	assert(p.second);
 
+	spatial.add(p.first->first, x, y);
 	players.at(player).new_entity(p.first->second);
+
+	if (!p.first->second.is_alive())
+		rest(p.first->second);
+	else if (state != EntityState::alive)
+		wake(p.first->first);
+
+	return p.first->first;
 }
 
-void World::add_resource(EntityType t, float x, float y, unsigned subimage) {
+IdPoolRef World::add_resource(EntityType t, float x, float y, unsigned subimage) {
 	ZoneScoped;
 	assert(is_resource(t));
 	// TODO add resource values
-	entities.emplace(t, x, y, subimage);
+	auto p = entities.emplace(t, x, y, subimage);
+	assert(p.second);
+
+	spatial.add(p.first->first, x, y);
+	return p.first->first;
 }
 
 void World::add_berries(float x, float y) {
@@ -834,15 +1364,15 @@ void World::add_berries(float x, float y) {
 }
 
 void World::add_gold(float x, float y) {
-	add_resource(EntityType::gold, x, y, rand() % 7);
+	add_resource(EntityType::gold, x, y, rng.below(7));
 }
 
 void World::add_stone(float x, float y) {
-	add_resource(EntityType::stone, x, y, rand() % 7);
+	add_resource(EntityType::stone, x, y, rng.below(7));
 }
 
 void World::spawn_unit(EntityType t, unsigned player, float x, float y) {
-	spawn_unit(t, player, x, y, fmodf(rand(), 360));
+	spawn_unit(t, player, x, y, rng.real(0, 2 * M_PI));
 }
 
 void World::spawn_unit(EntityType t, unsigned player, float x, float y, float angle) {
@@ -853,6 +1383,7 @@ void World::spawn_unit(EntityType t, unsigned player, float x, float y, float an
 	assert(p.second);
 
 	auto &ref = p.first;
+	spatial.add(ref->first, x, y);
 	players.at(player).new_entity(ref->second);
 	spawned_entities.emplace(ref->first);
 }
@@ -871,6 +1402,14 @@ void World::spawn_particle(ParticleType t, float x, float y)
 void World::create_entities() {
 	ZoneScoped;
 	entities.clear();
+	active_entities.clear();
+	// before the timers, or a reused world would still be at the tick the last game ended
+	ticks = 0;
+	timers.reset(ticks);
+	spatial.resize(t.w, t.h);
+
+	for (auto &kv : views)
+		kv.second.entities.clear();
 
 	/*
 	strategy:
@@ -882,29 +1421,34 @@ void World::create_entities() {
 	double eps_x = t.w * 0.5, eps_y = t.h * 0.5;
 	long eps_hw = (long)(scale * t.w / 2), eps_hh = (long)(scale * t.h / 2);
 
-	std::uniform_real_distribution<double> unif(0.0, 2.0 * M_PI);
-	std::default_random_engine re;
+	// anyone who creates a world from the same settings must end up with the same world
+	rng.seed(scn.seed);
+	lockstep_inputs.clear();
+	lockstep_hashes.clear();
+	desynced.clear();
+
+	auto unif = [this]() { return rng.real(0.0, 2.0 * M_PI); };
 
 	scale = 0.1;
 	double angle_step = 2 * M_PI / std::max(1, non_gaia_players());
 	double angle_jitter = angle_step * scale;
-	double angle_offset = unif(re);
+	double angle_offset = unif();
 
 	scale = 0.1; // NOTE: this + ellipsoid position scale must be less than 1
 	double x_jitter = scale * t.w, y_jitter = scale * t.h;
 
-	std::uniform_real_distribution<double> unif_ang(-angle_jitter * 0.5, angle_jitter * 0.5);
-	std::uniform_real_distribution<double> unif_jx(-x_jitter * 0.5, x_jitter * 0.5);
-	std::uniform_real_distribution<double> unif_jy(-y_jitter * 0.5, y_jitter * 0.5);
+	auto unif_ang = [&]() { return rng.real(-angle_jitter * 0.5, angle_jitter * 0.5); };
+	auto unif_jx = [&]() { return rng.real(-x_jitter * 0.5, x_jitter * 0.5); };
+	auto unif_jy = [&]() { return rng.real(-y_jitter * 0.5, y_jitter * 0.5); };
 
 	const double villager_radius = 4.0;
 
 	// create player stuff
 	for (unsigned pid = first_player_idx; pid < this->players.size(); ++pid) {
-		double angle = angle_offset + pid * angle_step + unif_ang(re);
+		double angle = angle_offset + pid * angle_step + unif_ang();
 
-		int t_x = (int)(eps_x + eps_hw * cos(angle) + unif_jx(re));
-		int t_y = (int)(eps_y + eps_hh * sin(angle) + unif_jy(re));
+		int t_x = (int)(eps_x + eps_hw * cos(angle) + unif_jx());
+		int t_y = (int)(eps_y + eps_hh * sin(angle) + unif_jy());
 
 		add_building(EntityType::town_center, pid, t_x, t_y);
 
@@ -912,31 +1456,31 @@ void World::create_entities() {
 		++t_x;
 		++t_y;
 
-		int mil_x = (int)(eps_x + eps_hw * cos(angle) + unif_jx(re)) - 3;
-		int mil_y = (int)(eps_y + eps_hh * sin(angle) + unif_jy(re)) - 3;
+		int mil_x = (int)(eps_x + eps_hw * cos(angle) + unif_jx()) - 3;
+		int mil_y = (int)(eps_y + eps_hh * sin(angle) + unif_jy()) - 3;
 
 		add_building(EntityType::barracks, pid, mil_x, mil_y);
 
 		unsigned villagers = this->scn.villagers;
 		double angle_villagers = 2 * M_PI / villagers;
-		double angle_vilagers_offset = unif(re);
+		double angle_vilagers_offset = unif();
 
 		double r = villager_radius;
 
 		// place villagers around town center facing random directions
 		for (unsigned j = 0; j < villagers; ++j) {
-			angle = unif(re);
+			angle = unif();
 
 			add_unit(
 				EntityType::villager, pid,
 				t_x + r * cos(angle), t_y + r * sin(angle),
-				unif(re)
+				unif()
 			);
 		}
 
 		// add some resources near the player
 		r = 6;
-		angle = unif(re);
+		angle = unif();
 
 		int b_x = t_x + r * cos(angle), b_y = t_y + r * sin(angle);
 
@@ -948,7 +1492,7 @@ void World::create_entities() {
 		add_berries(b_x + 1, b_y);
 
 		r = 7;
-		angle = unif(re);
+		angle = unif();
 		int g_x = t_x + r * cos(angle), g_y = t_y + r * sin(angle);
 
 		add_gold(g_x + 0, g_y + 0);
@@ -956,7 +1500,7 @@ void World::create_entities() {
 		add_gold(g_x + 0, g_y + 1);
 		add_gold(g_x + 1, g_y + 1);
 
-		angle = unif(re);
+		angle = unif();
 		int s_x = t_x + r * cos(angle), s_y = t_y + r * sin(angle);
 
 		add_stone(s_x + 0, s_y + 0);
@@ -976,9 +1520,9 @@ void World::create_entities() {
 	};
 
 	for (unsigned x = 0; x < players.size() * 3; ++x) {
-		add_resource(trees[rand() % 4], x, 0, 0);
-		add_resource(trees[rand() % 4], x, 1, 0);
-		add_resource(trees[rand() % 4], x, 2, 0);
+		add_resource(trees[rng.below(4)], x, 0, 0);
+		add_resource(trees[rng.below(4)], x, 1, 0);
+		add_resource(trees[rng.below(4)], x, 2, 0);
 	}
 }
 
@@ -1000,29 +1544,26 @@ void World::startup(UI_TaskInfo *info) {
 	if (info) info->next("Creating entities");
 	create_entities();
 
-	// now send all entities to each client
-	for (auto &kv : entities) {
-		pkg.set_entity_add(kv.second);
-		// TODO only send to clients that can see this entity
-		s->broadcast(pkg);
-	}
-
-	// send initial terrain chunk
-	// TODO this is buggy if the map is too small...
+	// now send all entities to each client that can see them.
+	// owned entities may be outside the camera, so just mark everything as changed
+	for (auto &kv : entities)
+		dirty_entities.emplace(kv.first);
 
-	for (unsigned y = 0; y < Terrain::min_size; y += Terrain::chunk_size) {
-		for (unsigned x = 0; x < Terrain::min_size; x += Terrain::chunk_size) {
-			unsigned w = Terrain::chunk_size, h = Terrain::chunk_size;
-			NetTerrainMod tm(fetch_terrain(x, y, w, h));
+	push_entities();
 
-			pkg.set_terrain_mod(tm);
-			s->broadcast(pkg);
-		}
-	}
+	// the terrain is streamed by push_terrain, starting around the camera of each peer
 
 	pkg.set_gamespeed(NetGamespeedType::increase, this->logic_gamespeed);
 	s->broadcast(pkg);
 
+	if (!replay_path.empty()) {
+		try {
+			replay.reset(new ReplayWriter(replay_path, scn));
+		} catch (std::runtime_error &e) {
+			fprintf(stderr, "%s: not recording replay: %s\n", __func__, e.what());
+		}
+	}
+
 	this->running = true;
 
 	// start!
@@ -1046,6 +1587,111 @@ void World::send_gameticks(unsigned n) {
 	s->broadcast(pkg);
 }
 
+/** Send all inputs we have applied at this tick to the lockstep peers, and tell them to tick \a steps times. */
+void World::send_frame(unsigned steps) {
+	ZoneScoped;
+	if (!steps && lockstep_inputs.empty())
+		return;
+
+	NetPkg pkg;
+	size_t i = 0;
+
+	do {
+		i += pkg.set_lockstep_frame(ticks, steps, lockstep_inputs, i);
+		s->broadcast(pkg);
+	} while (i < lockstep_inputs.size());
+}
+
+/** Compare state hash of a lockstep peer with ours and tell everyone once if they have diverged. */
+void World::check_state_hash(WorldEvent &ev) {
+	ZoneScoped;
+	NetStateHash h(std::get<NetStateHash>(ev.data));
+
+	// hashes we have forgotten about can't be checked
+	auto it = lockstep_hashes.find(h.tick);
+	if (it == lockstep_hashes.end() || it->second == h.hash || !desynced.emplace(ev.src).second)
+		return;
+
+	char buf[80];
+	snprintf(buf, sizeof buf, "(%u::%u) is out of sync since tick %u", ev.src.first, ev.src.second, (unsigned)h.tick);
+	fprintf(stderr, "%s: %s\n", __func__, buf);
+
+	NetPkg pkg;
+	pkg.set_chat_text(invalid_ref, buf);
+	s->broadcast(pkg);
+}
+
+void World::start_lockstep(IServer &s, const ScenarioSettings &scn) {
+	ZoneScoped;
+	this->s = &s;
+
+	load_scn(scn);
+	// also when replaying a game that wasn't played in lockstep
+	this->scn.lockstep = true;
+
+	// the server has already sanitized these, so just copy them
+	this->scn.players = scn.players;
+	this->scn.owners = scn.owners;
+
+	for (PlayerSetting &p : this->scn.players)
+		p.res = this->scn.res;
+
+	create_terrain();
+	init_players();
+	// no views: there is nobody to send anything to
+	views.clear();
+	create_entities();
+
+	this->running = true;
+}
+
+void World::step_lockstep(const LockstepFrame &f, std::vector<NetStateHash> &hashes) {
+	ZoneScoped;
+
+	if (f.tick != ticks)
+		throw std::runtime_error("lockstep frame for tick " + std::to_string(f.tick) + " at tick " + std::to_string(ticks));
+
+	// same as pump_events, so bad inputs are ignored just like the server did
+	for (WorldEvent ev : f.inputs) {
+		try {
+			if (ev.type == WorldEventType::entity_kill)
+				entity_kill(ev);
+			else
+				entity_task(ev);
+		} catch (const std::runtime_error &e) {
+			fprintf(stderr, "%s: bad event: %u\n", __func__, (unsigned)ev.type);
+		}
+	}
+
+	for (unsigned i = 0; i < f.steps && !gameover; ++i) {
+		tick();
+
+		if (ticks % hash_interval == 0)
+			hashes.emplace_back(ticks, lockstep_hashes.at(ticks));
+	}
+}
+
+void World::sync_lockstep(Game &g) {
+	ZoneScoped;
+	std::lock_guard<std::mutex> lk(m);
+
+	std::set<Entity> lst;
+	for (auto &kv : entities)
+		lst.emplace(kv.second);
+
+	g.entities_set(std::move(lst), spawned_entities);
+
+	for (IdPoolRef ref : spawned_particles) {
+		Particle *p = particles.try_get(ref);
+		if (p)
+			g.particle_spawn(*p);
+	}
+
+	dirty_entities.clear();
+	spawned_entities.clear();
+	spawned_particles.clear();
+}
+
 std::optional<unsigned> World::ref2idx(IdPoolRef ref) const noexcept {
 	for (auto kv : scn.owners)
 		if (kv.first == ref)
@@ -1057,45 +1703,145 @@ std::optional<unsigned> World::ref2idx(IdPoolRef ref) const noexcept {
 void World::eventloop(IServer &s, UI_TaskInfo *info) {
 	ZoneScoped;
 
+	using namespace std::chrono;
+
 	this->s = &s;
+	// peers may already send input while we start up: make them wait for room rather than losing it
+	events_draining = true;
 	startup(info);
 
-	auto last = std::chrono::steady_clock::now();
-	double dt = 0;
+	auto start = steady_clock::now();
+	auto clock = [start] { return duration<double>(steady_clock::now() - start).count(); };
 
-	while (s.is_running() && !gameover) {
-		// recompute as logic_gamespeed may change
-		double interval_inv = logic_gamespeed * World::gamespeed_step * DEFAULT_TICKS_PER_SECOND;
-		double interval = 1 / std::max(0.01, interval_inv);
+	unsigned gamespeed = logic_gamespeed;
+	TickScheduler sched(tick_rate * gamespeed * gamespeed_step, snapshot_rate, max_catchup);
+	double last_slow = -1;
 
-		auto now = std::chrono::steady_clock::now();
-		std::chrono::duration<double> elapsed = now - last;
-		last = now;
-		dt += elapsed.count();
+	sched.reset(clock());
+	tick_stats = TickStats();
 
-		size_t steps = (size_t)(dt * interval_inv);
+	while (s.is_running() && !gameover) {
+		if (gamespeed != logic_gamespeed) {
+			gamespeed = logic_gamespeed;
+			sched.set_tick_rate(tick_rate * gamespeed * gamespeed_step);
+		}
 
+		double pump_start = clock();
 		pump_events();
+		tick_stats.add_pump(clock() - pump_start);
 
-		if (running) {
-			if (!gameover)
-				send_gameticks(steps);
+		uint64_t skipped = tick_stats.skipped;
+		unsigned steps = sched.ticks(clock(), tick_stats.skipped);
 
-			save_scores();
+		if (tick_stats.skipped != skipped)
+			LOGF("%s: lagging behind, dropped %llu ticks\n", __func__, (unsigned long long)(tick_stats.skipped - skipped));
+
+		if (running) {
+			begin_steps(steps);
 
 			// do steps
-			for (; steps && !gameover; --steps)
+			for (; steps && !gameover; --steps) {
+				double t0 = clock();
 				tick();
+				double dt = clock() - t0;
+
+				tick_stats.add_tick(dt);
+
+				if (dt > sched.interval()) {
+					++tick_stats.slow;
+
+					// once a second is plenty to see something is wrong
+					if (t0 - last_slow >= 1) {
+						LOGF("%s: slow tick %u: %.1f ms, budget is %.1f ms\n", __func__, (unsigned)ticks, dt * 1000, sched.interval() * 1000);
+						last_slow = t0;
+					}
+				}
+			}
 		}
 
-		push_events();
+		if (sched.snapshot(clock()) || gameover) {
+			double t0 = clock();
+			push_events();
+			tick_stats.add_push(clock() - t0);
+		}
 
-		dt = fmod(dt, interval);
-		unsigned us = !steps ? (unsigned)(interval * 1000 * 1000) : 0;
+		++tick_stats.loops;
 
-		if (us > 500)
-			std::this_thread::sleep_for(std::chrono::microseconds(us));
+		double wakeup = sched.wakeup(), now = clock();
+		if (wakeup > now) {
+			std::this_thread::sleep_for(duration<double>(wakeup - now));
+			tick_stats.add_drift(std::max(0.0, clock() - wakeup));
+		}
+	}
+
+	events_draining = false;
+	replay.reset();
+
+	[[maybe_unused]] MpscStats st(events_in.stats());
+	LOGF("%s: events: %llu in, at most %zu per pump, %llu stalled, %llu dropped\n", __func__,
+		(unsigned long long)st.drained, st.peak, (unsigned long long)events_stalled.load(), (unsigned long long)events_dropped.load());
+
+	[[maybe_unused]] const TickStats &ts = tick_stats;
+	[[maybe_unused]] double per_tick = 1000.0 / std::max<uint64_t>(1, ts.ticks);
+	LOGF("%s: %llu loops, %llu ticks (%.2f ms avg, %.2f ms max, %llu slow, %llu dropped), %llu snapshots (%.2f ms avg, %.2f ms max), sleep drift %.2f ms avg, %.2f ms max\n", __func__,
+		(unsigned long long)ts.loops, (unsigned long long)ts.ticks, ts.tick_time * per_tick, ts.tick_max * 1000,
+		(unsigned long long)ts.slow, (unsigned long long)ts.skipped,
+		(unsigned long long)ts.snapshots, ts.push_time * 1000 / std::max<uint64_t>(1, ts.snapshots), ts.push_max * 1000,
+		ts.drift * 1000 / std::max<uint64_t>(1, ts.loops), ts.drift_max * 1000);
+	LOGF("%s: per tick: entities %.2f ms, particles %.2f ms, players %.2f ms; pump_events %.2f ms per loop\n", __func__,
+		ts.entities_time * per_tick, ts.particles_time * per_tick, ts.players_time * per_tick, ts.pump_time * 1000 / std::max<uint64_t>(1, ts.loops));
+}
+
+/** Record and announce the \a steps ticks we are about to do. */
+void World::begin_steps(unsigned steps) {
+	if (!gameover) {
+		if (replay)
+			replay->frame(ticks, steps, lockstep_inputs);
+
+		if (scn.lockstep)
+			send_frame(steps);
+		else
+			send_gameticks(steps);
+	}
+
+	lockstep_inputs.clear();
+
+	save_scores();
+}
+
+void World::start_headless(IServer &s) {
+	ZoneScoped;
+	this->s = &s;
+	events_draining = true;
+	startup(nullptr);
+	tick_stats = TickStats();
+}
+
+void World::step(unsigned steps) {
+	ZoneScoped;
+
+	using namespace std::chrono;
+	auto clock = [] { return duration<double>(steady_clock::now().time_since_epoch()).count(); };
+
+	double t0 = clock();
+	pump_events();
+	tick_stats.add_pump(clock() - t0);
+
+	if (running) {
+		begin_steps(steps);
+
+		for (; steps && !gameover; --steps) {
+			t0 = clock();
+			tick();
+			tick_stats.add_tick(clock() - t0);
+		}
 	}
+
+	t0 = clock();
+	push_events();
+	tick_stats.add_push(clock() - t0);
+
+	++tick_stats.loops;
 }
 
 }
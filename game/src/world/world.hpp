@@ -3,6 +3,11 @@
 #include <idpool.hpp>
 
 #include "../net/protocol.hpp"
+#include "pathfinder.hpp"
+#include "random.hpp"
+#include "spatial.hpp"
+#include "scheduler.hpp"
+#include "timer.hpp"
 
 namespace aoe {
 
@@ -15,6 +20,7 @@ enum class WorldEventType {
 	peer_cam_move,
 	gameover,
 	gamespeed_control,
+	state_hash,
 };
 
 class EventCameraMove final {
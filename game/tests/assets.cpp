@@ -0,0 +1,106 @@
+#include "../src/engine/assets.hpp"
+
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+
+namespace aoe {
+
+class AssetCacheFixture : public ::testing::Test {
+protected:
+	std::string path;
+	std::vector<char> data;
+
+	static constexpr uint64_t key = 0x1234;
+
+	void SetUp() override {
+		path = ::testing::TempDir() + "test.cache";
+
+		Assets a("");
+		a.bkg_cols[(io::DrsId)50] = BackgroundColors();
+		a.drs_ids[(io::DrsId)51] = IdPoolRef(1, 0);
+
+		std::vector<std::pair<int, int>> mask{ { 0, 3 }, { 1, 2 } };
+		a.ts_ui.imgs.emplace(IdPoolRef(1, 0), SDL_Rect{ 0, 0, 4, 2 }, nullptr, mask, 1, 1, 0.0f, 0.0f, 1.0f, 1.0f);
+		a.ts_ui.surf.reset(SDL_CreateRGBSurfaceWithFormat(0, 4, 2, 32, SDL_PIXELFORMAT_RGBA32));
+		ASSERT_TRUE(a.ts_ui.surf.get());
+
+		a.save_cache(path, key);
+
+		std::ifstream in(path, std::ios::binary);
+		data.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+		ASSERT_FALSE(data.empty());
+	}
+
+	void TearDown() override {
+		remove(path.c_str());
+	}
+
+	void write(size_t size) {
+		std::ofstream out(path, std::ios::binary | std::ios::trunc);
+		out.write(data.data(), size);
+	}
+
+	/** Load the cache and check that nothing is left behind when it fails. */
+	bool load() {
+		Assets a("");
+		bool good = a.load_cache(path, key);
+
+		if (!good) {
+			EXPECT_TRUE(a.bkg_cols.empty());
+			EXPECT_TRUE(a.drs_ids.empty());
+			EXPECT_TRUE(a.ts_ui.imgs.empty());
+			EXPECT_FALSE(a.ts_ui.surf.get());
+		}
+
+		return good;
+	}
+};
+
+TEST_F(AssetCacheFixture, loadWhatWasSaved) {
+	Assets a("");
+	ASSERT_TRUE(a.load_cache(path, key));
+
+	EXPECT_EQ(a.bkg_cols.size(), 1u);
+	EXPECT_EQ(a.drs_ids.at((io::DrsId)51), IdPoolRef(1, 0));
+	ASSERT_EQ(a.ts_ui.imgs.size(), 1u);
+	EXPECT_EQ(a.ts_ui.imgs.begin()->mask.size(), 2u);
+	ASSERT_TRUE(a.ts_ui.surf.get());
+	EXPECT_EQ(a.ts_ui.surf->w, 4);
+
+	EXPECT_FALSE(a.load_cache(path, key + 1));
+}
+
+TEST_F(AssetCacheFixture, truncated) {
+	for (size_t size = 0; size < data.size(); ++size) {
+		write(size);
+		EXPECT_FALSE(load()) << "size " << size;
+	}
+}
+
+TEST_F(AssetCacheFixture, corrupt) {
+	// make every field in turn as big as it gets, so any count in there would ask for way too much memory
+	std::vector<char> good(data);
+
+	for (size_t pos = 16; pos + 4 <= good.size(); pos += 4) {
+		data = good;
+		for (size_t i = 0; i < 4; ++i)
+			data[pos + i] = (char)0xff;
+
+		write(data.size());
+		EXPECT_NO_THROW(load()) << "offset " << pos;
+	}
+
+	// the mask size of the only image: it is followed by the mask, the surface size and the pixels
+	data = good;
+	size_t mask = good.size() - 4 * 2 * 4 - 2 * 4 - 2 * 2 * 4 - 4;
+	for (size_t i = 0; i < 4; ++i)
+		data[mask + i] = (char)0xff;
+
+	write(data.size());
+	EXPECT_FALSE(load());
+}
+
+}
@@ -0,0 +1,77 @@
+#include <idpool.hpp>
+
+#include <set>
+
+#include <gtest/gtest.h>
+
+namespace aoe {
+
+struct PoolItem final {
+	IdPoolRef ref;
+	unsigned v;
+
+	PoolItem(IdPoolRef ref, unsigned v) : ref(ref), v(v) {}
+};
+
+TEST(IdPool, EmplaceGet) {
+	IdPool<PoolItem> p;
+
+	auto ins = p.emplace(5u);
+	ASSERT_TRUE(ins.second);
+
+	IdPoolRef ref = ins.first->first;
+	ASSERT_NE(ref, invalid_ref);
+	ASSERT_EQ(ref, ins.first->second.ref);
+
+	PoolItem *i = p.try_get(ref);
+	ASSERT_NE(i, nullptr);
+	ASSERT_EQ(i->v, 5u);
+	ASSERT_EQ(p.try_get(invalid_ref), nullptr);
+}
+
+TEST(IdPool, StaleRef) {
+	IdPool<PoolItem> p;
+
+	IdPoolRef ref = p.emplace(1u).first->first;
+	ASSERT_TRUE(p.try_invalidate(ref));
+	ASSERT_FALSE(p.try_invalidate(ref));
+
+	// id is recycled, but the old ref must stay invalid
+	IdPoolRef ref2 = p.emplace(2u).first->first;
+	ASSERT_EQ(ref.first, ref2.first);
+	ASSERT_EQ(p.try_get(ref), nullptr);
+	ASSERT_EQ(p.at(ref2).v, 2u);
+
+	try {
+		p.at(ref);
+		FAIL() << "stale ref accepted";
+	} catch (std::out_of_range&) {}
+}
+
+TEST(IdPool, EraseWhileIterating) {
+	IdPool<PoolItem> p;
+	std::set<IdPoolRef> keep;
+
+	for (unsigned i = 0; i < 100; ++i) {
+		IdPoolRef ref = p.emplace(i).first->first;
+		if (i % 3)
+			keep.emplace(ref);
+	}
+
+	for (auto it = p.begin(); it != p.end();) {
+		if (it->second.v % 3 == 0)
+			it = p.erase(it);
+		else
+			++it;
+	}
+
+	ASSERT_EQ(p.size(), keep.size());
+
+	for (IdPoolRef ref : keep) {
+		PoolItem *i = p.try_get(ref);
+		ASSERT_NE(i, nullptr);
+		ASSERT_EQ(i->ref, ref);
+	}
+}
+
+}
@@ -0,0 +1,72 @@
+#include <mpsc.hpp>
+
+#include <string>
+#include <thread>
+
+#include <gtest/gtest.h>
+
+namespace aoe {
+
+TEST(MpscQueue, FifoAndFull) {
+	MpscQueue<std::string> q(3);
+	std::vector<std::string> out;
+
+	ASSERT_EQ(q.capacity(), 4u);
+
+	for (unsigned i = 0; i < 4; ++i) {
+		ASSERT_TRUE(q.has_room());
+		ASSERT_TRUE(q.try_emplace(std::to_string(i)));
+	}
+
+	EXPECT_FALSE(q.has_room());
+	EXPECT_FALSE(q.try_emplace("full"));
+
+	EXPECT_EQ(q.drain(out), 4u);
+	EXPECT_EQ(out, (std::vector<std::string>{ "0", "1", "2", "3" }));
+
+	// slots can be reused after draining
+	EXPECT_TRUE(q.has_room());
+	ASSERT_TRUE(q.try_emplace("4"));
+	EXPECT_EQ(q.drain(out), 1u);
+	EXPECT_EQ(out.back(), "4");
+
+	MpscStats st(q.stats());
+	EXPECT_EQ(st.drained, 5u);
+	EXPECT_EQ(st.full, 1u);
+	EXPECT_EQ(st.peak, 4u);
+}
+
+TEST(MpscQueue, ManyProducers) {
+	static constexpr unsigned producers = 4, count = 50000;
+	MpscQueue<std::pair<unsigned, unsigned>> q(64);
+	std::vector<std::thread> threads;
+
+	for (unsigned p = 0; p < producers; ++p)
+		threads.emplace_back([&q, p] {
+			for (unsigned i = 0; i < count; ++i)
+				while (!q.try_emplace(p, i))
+					std::this_thread::yield();
+		});
+
+	std::vector<std::pair<unsigned, unsigned>> out;
+	std::vector<unsigned> next(producers, 0);
+
+	while (out.size() < producers * count) {
+		size_t first = out.size();
+		q.drain(out);
+
+		// everyone's items arrive in the order they were added
+		for (size_t i = first; i < out.size(); ++i) {
+			auto [p, v] = out[i];
+			ASSERT_LT(p, producers);
+			ASSERT_EQ(v, next[p]++);
+		}
+	}
+
+	for (std::thread &t : threads)
+		t.join();
+
+	EXPECT_EQ(q.drain(out), 0u);
+}
+
+}
@@ -581,7 +581,7 @@ TEST(Ssock, ConnectStop) {
 	t1.join();
 }
 
-static bool process_echo(const Peer&, std::deque<uint8_t> &in, std::deque<uint8_t> &out, int processed, void*) {
+static bool process_echo(const Peer&, RingBuffer &in, RingBuffer &out, int processed, void*) {
 	for (; !in.empty(); in.pop_front())
 		out.emplace_back(in.front());
 
@@ -595,11 +595,11 @@ public:
 	void started() override {}
 	void stopped() override {}
 
-	int proper_packet(ServerSocket&, const std::deque<uint8_t> &q) {
+	int proper_packet(ServerSocket&, const RingBuffer &q) {
 		return (int)(-(long long)q.size()); // always drop the data we receive. nom nom nom
 	}
 
-	bool process_packet(ServerSocket&, const Peer&, std::deque<uint8_t>&, std::deque<uint8_t> &out, int) { return true; }
+	bool process_packet(ServerSocket&, const Peer&, RingBuffer&, RingBuffer &out, int) { return true; }
 };
 
 class SsockCtlEcho final : public ServerSocketController {
@@ -609,11 +609,11 @@ public:
 	void started() override {}
 	void stopped() override {}
 
-	int proper_packet(ServerSocket&, const std::deque<uint8_t> &q) {
+	int proper_packet(ServerSocket&, const RingBuffer &q) {
 		return !q.empty() ? 1 : 0; // always accept the data if the queue isn't empty
 	}
 
-	bool process_packet(ServerSocket&, const Peer&, std::deque<uint8_t> &in, std::deque<uint8_t> &out, int) {
+	bool process_packet(ServerSocket&, const Peer&, RingBuffer &in, RingBuffer &out, int) {
 		for (; !in.empty(); in.pop_front())
 			out.emplace_back(in.front());
 
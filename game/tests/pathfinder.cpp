@@ -0,0 +1,155 @@
+#include "../src/world/pathfinder.hpp"
+
+#include <gtest/gtest.h>
+
+namespace aoe {
+
+class PathfinderFixture : public ::testing::Test {
+protected:
+	Terrain t;
+	Pathfinder pf;
+	std::vector<std::pair<float, float>> pts;
+
+	static constexpr unsigned size = 64, wall = 30;
+
+	/** Grass map with a water wall at x == wall that has a gap at \a gap, or no gap at all if gap >= size. */
+	void create(unsigned gap) {
+		t.resize(size, size, 0, 0, false, TerrainType::flat);
+
+		std::vector<tile_t> tiles(size * size, Terrain::tile_id(TileType::grass, 0));
+		std::vector<uint8_t> hmap(size * size, 0);
+
+		for (unsigned y = 0; y < size; ++y)
+			if (y != gap)
+				tiles[y * size + wall] = Terrain::tile_id(TileType::water, 0);
+
+		t.set(tiles, hmap, 0, 0, size, size);
+		pf.reset(t);
+	}
+
+	/** Check we never walk through water when following pts from (\a x, \a y). */
+	void expect_walkable(float x, float y) {
+		for (auto [nx, ny] : pts) {
+			for (unsigned i = 0; i <= 100; ++i) {
+				float f = i / 100.0f;
+				ASSERT_TRUE(t.passable(x + f * (nx - x), y + f * (ny - y))) << "between (" << x << "," << y << ") and (" << nx << "," << ny << ")";
+			}
+
+			x = nx;
+			y = ny;
+		}
+	}
+};
+
+TEST_F(PathfinderFixture, straight) {
+	create(size);
+
+	ASSERT_TRUE(pf.find(2.5f, 2.5f, 20.5f, 9.5f, pts));
+	ASSERT_EQ(pts.size(), 1u);
+	EXPECT_EQ(pts.back(), std::make_pair(20.5f, 9.5f));
+}
+
+TEST_F(PathfinderFixture, aroundWall) {
+	create(50);
+
+	ASSERT_TRUE(pf.find(10.5f, 10.5f, 50.5f, 10.5f, pts));
+	EXPECT_EQ(pts.back(), std::make_pair(50.5f, 10.5f));
+	expect_walkable(10.5f, 10.5f);
+
+	bool through_gap = false;
+	for (auto [x, y] : pts)
+		through_gap |= (unsigned)y == 50;
+
+	EXPECT_TRUE(through_gap);
+}
+
+TEST_F(PathfinderFixture, unreachable) {
+	create(size);
+	EXPECT_FALSE(pf.find(10.5f, 10.5f, 50.5f, 10.5f, pts));
+	EXPECT_TRUE(pts.empty());
+}
+
+TEST_F(PathfinderFixture, snapToLand) {
+	create(size);
+
+	// target is in the water, so go as close as possible
+	ASSERT_TRUE(pf.find(10.5f, 10.5f, wall + 0.5f, 10.5f, pts));
+	EXPECT_EQ((unsigned)pts.back().first, wall - 1);
+	expect_walkable(10.5f, 10.5f);
+}
+
+TEST_F(PathfinderFixture, groupReusesPath) {
+	create(50);
+
+	for (unsigned i = 0; i < 5; ++i) {
+		ASSERT_TRUE(pf.find(4.5f + i, 4.5f, 60.5f, 60.5f, pts));
+		expect_walkable(4.5f + i, 4.5f);
+	}
+
+	EXPECT_EQ(pf.cache_misses, 1u);
+	EXPECT_EQ(pf.cache_hits, 4u);
+}
+
+TEST_F(PathfinderFixture, budget) {
+	create(50);
+
+	for (unsigned i = 0; i < 10; ++i)
+		pf.request(IdPoolRef(i, 0), 4.5f, 4.5f + i, 60.5f, 60.5f - i);
+
+	// always make progress, even if the budget is too small
+	EXPECT_GT(pf.process(1), 0u);
+	EXPECT_FALSE(pf.try_get(IdPoolRef(0, 0))->pending);
+	EXPECT_TRUE(pf.try_get(IdPoolRef(1, 0))->pending);
+
+	pf.process(UINT64_MAX);
+
+	for (unsigned i = 0; i < 10; ++i) {
+		const Path *p = pf.try_get(IdPoolRef(i, 0));
+		ASSERT_TRUE(p);
+		EXPECT_FALSE(p->pending);
+		EXPECT_FALSE(p->pts.empty());
+	}
+}
+
+
+TEST_F(PathfinderFixture, updateGap) {
+	create(size);
+	ASSERT_FALSE(pf.find(10.5f, 10.5f, 50.5f, 10.5f, pts));
+
+	std::vector<tile_t> tiles(1, Terrain::tile_id(TileType::grass, 0));
+	std::vector<uint8_t> hmap(1, 0);
+
+	// open a gap in the wall. this is on a cluster border, so the clusters on both sides change
+	t.set(tiles, hmap, wall, 40, 1, 1);
+	pf.update(t, wall, 40, 1, 1);
+
+	ASSERT_TRUE(pf.find(10.5f, 10.5f, 50.5f, 10.5f, pts));
+	expect_walkable(10.5f, 10.5f);
+
+	// and close it again
+	tiles[0] = Terrain::tile_id(TileType::water, 0);
+	t.set(tiles, hmap, wall, 40, 1, 1);
+	pf.update(t, wall, 40, 1, 1);
+
+	EXPECT_FALSE(pf.find(10.5f, 10.5f, 50.5f, 10.5f, pts));
+}
+
+TEST_F(PathfinderFixture, updateBuilding) {
+	create(50);
+
+	Pathfinder fresh;
+	unsigned x0, y0, x1, y1;
+
+	// block the gap with a building
+	t.add_building(EntityType::town_center, wall, 50);
+	Terrain::building_area(EntityType::town_center, wall, 50, x0, y0, x1, y1);
+	pf.update(t, x0, y0, x1 - x0, y1 - y0);
+
+	EXPECT_FALSE(pf.find(10.5f, 10.5f, 50.5f, 10.5f, pts));
+
+	// same graph as building it from scratch, apart from the order of the nodes
+	fresh.reset(t);
+	EXPECT_EQ(pf.node_count(), fresh.node_count());
+}
+
+}
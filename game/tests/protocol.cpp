@@ -35,4 +35,137 @@ TEST(Pkg, ProtocolVersion) {
 		FAIL() << "bad protocol version, expected 0x" << std::hex << exp_prot << ", got " << pkg.protocol_version() << std::dec;
 }
 
+TEST(Pkg, EntityUpdateWireFormat) {
+	Entity e(IdPoolRef(12, 3), EntityType::villager, 1, 10.5f, 20.25f);
+	e.angle = 1.5f;
+	e.subimage = 7;
+
+	NetPkg pkg;
+	pkg.set_entity_update(e);
+
+	// same bytes as the old "2H2I2F" "HHHB" "bbH" writef layout
+	std::vector<uint8_t> exp{
+		0x00, 0x02, 0x00, 0x03, // control type, entity type
+		0x00, 0x00, 0x00, 0x0c, 0x00, 0x00, 0x00, 0x03, // ref
+		0x00, 0x00, 0x00, 0x0a, 0x00, 0x00, 0x00, 0x14, // whole x, y
+		0x3d, 0x1d, 0x00, 0x01, 0x00, 0x07, 0x00, // angle, player, subimage, state
+		0x3f, 0x1f, 0x00, 0x19, // fractional x, y, hp
+	};
+	EXPECT_EQ(pkg.data, exp);
+
+	pkg.hton();
+	pkg.ntoh();
+
+	NetEntityMod m(pkg.get_entity_mod());
+	ASSERT_EQ(m.type, NetEntityControlType::update);
+
+	EntityView ev(std::get<EntityView>(m.data));
+	EXPECT_EQ(ev.ref, e.ref);
+	EXPECT_EQ(ev.subimage, 7u);
+	EXPECT_NEAR(ev.x, 10.5f, 0.01f);
+	EXPECT_NEAR(ev.y, 20.25f, 0.01f);
+}
+
+TEST(Pkg, EntitySnapshot) {
+	Entity e1(IdPoolRef(1, 2), EntityType::villager, 1, 10.5f, 20.25f), e2(IdPoolRef(3, 4), EntityType::villager, 2, 5.0f, 6.0f);
+	EntityView prev(e2);
+
+	e2.x = Fixed(e2.x + 1.5f);
+	e2.hp -= 3;
+
+	std::vector<NetEntityDelta> lst;
+	lst.emplace_back(EntityView(e1), (unsigned)NetEntityDeltaFlags::full);
+	lst.emplace_back(EntityView(e2), NetEntityDelta::diff(prev, EntityView(e2)));
+
+	ASSERT_EQ(lst[1].flags, (unsigned)NetEntityDeltaFlags::pos | (unsigned)NetEntityDeltaFlags::hp);
+
+	NetPkg pkg;
+	ASSERT_EQ(pkg.set_entity_snapshot(lst), lst.size());
+	ASSERT_EQ(pkg.data.size(), 2 + lst[0].size() + lst[1].size());
+	pkg.hton();
+	pkg.ntoh();
+
+	std::vector<NetEntityDelta> got(pkg.get_entity_snapshot());
+	ASSERT_EQ(got.size(), lst.size());
+
+	EXPECT_EQ(got[0].ev.ref, e1.ref);
+	EXPECT_EQ(got[0].ev.playerid, e1.playerid);
+	EXPECT_NEAR(got[0].ev.x, e1.x, 0.01f);
+	EXPECT_NEAR(got[0].ev.y, e1.y, 0.01f);
+
+	got[1].apply(prev);
+	EXPECT_EQ(prev.ref, e2.ref);
+	EXPECT_EQ(prev.hp, e2.hp);
+	EXPECT_NEAR(prev.x, e2.x, 0.01f);
+	EXPECT_NEAR(prev.y, e2.y, 0.01f);
+}
+
+TEST(Pkg, Particle) {
+	Particle p(IdPoolRef(5, 6), (ParticleType)1, 3.5f, 4.25f, 6);
+
+	NetPkg pkg;
+	pkg.particle_spawn(p);
+	pkg.hton();
+	pkg.ntoh();
+
+	Particle got(pkg.get_particle());
+
+	EXPECT_EQ(got.ref, p.ref);
+	EXPECT_EQ(got.type, p.type);
+	EXPECT_EQ(got.subimage, p.subimage);
+	EXPECT_NEAR(got.x, p.x, 0.01f);
+	EXPECT_NEAR(got.y, p.y, 0.01f);
+}
+
+TEST(Pkg, LockstepFrame) {
+	std::vector<WorldEvent> inputs;
+	inputs.emplace_back(IdPoolRef(1, 0), WorldEventType::entity_task, EntityTask(IdPoolRef(7, 2), 30, 40));
+	inputs.emplace_back(IdPoolRef(1, 0), WorldEventType::entity_kill, IdPoolRef(8, 3));
+
+	NetPkg pkg;
+	ASSERT_EQ(pkg.set_lockstep_frame(90, 3, inputs, 0), inputs.size());
+	pkg.hton();
+	pkg.ntoh();
+
+	LockstepFrame f(pkg.get_lockstep_frame());
+	EXPECT_EQ(f.tick, 90u);
+	EXPECT_EQ(f.steps, 3u);
+	ASSERT_EQ(f.inputs.size(), inputs.size());
+
+	const EntityTask &t = std::get<EntityTask>(f.inputs[0].data);
+	EXPECT_EQ(f.inputs[0].src, IdPoolRef(1, 0));
+	EXPECT_EQ(t.type, EntityTaskType::move);
+	EXPECT_EQ(t.ref1, IdPoolRef(7, 2));
+	EXPECT_EQ(t.x, 30u);
+	EXPECT_EQ(t.y, 40u);
+
+	EXPECT_EQ(f.inputs[1].type, WorldEventType::entity_kill);
+	EXPECT_EQ(std::get<IdPoolRef>(f.inputs[1].data), IdPoolRef(8, 3));
+}
+
+TEST(Pkg, TerrainMod) {
+	NetTerrainMod tm;
+	tm.x = 32; tm.y = 16; tm.w = 16; tm.h = 9;
+
+	for (unsigned i = 0; i < tm.w * tm.h; ++i) {
+		tm.tiles.emplace_back(i < 100 ? 0x0101 : (uint16_t)i);
+		tm.hmap.emplace_back(i / 50);
+	}
+
+	NetPkg pkg;
+	pkg.set_terrain_mod(tm);
+	// mostly the same tile, so it should be smaller than the tiles and heights
+	EXPECT_LT(pkg.data.size(), NetTerrainMod::possize + tm.w * tm.h * 3);
+	pkg.hton();
+	pkg.ntoh();
+
+	NetTerrainMod got(pkg.get_terrain_mod());
+	EXPECT_EQ(got.x, tm.x);
+	EXPECT_EQ(got.y, tm.y);
+	EXPECT_EQ(got.w, tm.w);
+	EXPECT_EQ(got.h, tm.h);
+	EXPECT_EQ(got.tiles, tm.tiles);
+	EXPECT_EQ(got.hmap, tm.hmap);
+}
+
 }
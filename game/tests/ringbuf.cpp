@@ -0,0 +1,52 @@
+#include <ringbuf.hpp>
+
+#include <deque>
+
+#include <gtest/gtest.h>
+
+namespace aoe {
+
+TEST(RingBuffer, PushPeekConsume) {
+	RingBuffer q;
+	const char msg[] = "Hello, k thx goodbye.";
+
+	q.push_back(msg, sizeof msg);
+	ASSERT_EQ(q.size(), sizeof msg);
+
+	char buf[sizeof msg];
+	q.peek(buf, sizeof msg);
+	EXPECT_STREQ(buf, msg);
+
+	q.consume(7);
+	EXPECT_EQ(q.front(), 'k');
+	EXPECT_EQ(q.size(), sizeof msg - 7);
+}
+
+TEST(RingBuffer, WrapAround) {
+	RingBuffer q(64);
+	std::deque<uint8_t> exp;
+	uint8_t v = 0;
+
+	// keep the buffer partially filled so head and tail wrap many times
+	for (unsigned i = 0; i < 1000; ++i) {
+		auto span = q.write_span(i % 17 + 1);
+		ASSERT_GE(span.second, i % 17 + 1);
+
+		for (unsigned j = 0; j <= i % 17; ++j, ++v) {
+			span.first[j] = v;
+			exp.emplace_back(v);
+		}
+
+		q.commit(i % 17 + 1);
+
+		size_t n = std::min<size_t>(q.size(), i % 13 + 3);
+		q.consume(n);
+		exp.erase(exp.begin(), exp.begin() + n);
+
+		ASSERT_EQ(q.size(), exp.size());
+		for (size_t j = 0; j < exp.size(); ++j)
+			ASSERT_EQ(q[j], exp[j]);
+	}
+}
+
+}
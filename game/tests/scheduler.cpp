@@ -0,0 +1,46 @@
+#include "../src/world/scheduler.hpp"
+
+#include <gtest/gtest.h>
+
+namespace aoe {
+
+TEST(TickScheduler, FixedRate) {
+	TickScheduler s(10, 5, 4);
+	uint64_t skipped = 0;
+
+	s.reset(0);
+	EXPECT_DOUBLE_EQ(s.wakeup(), 0);
+	EXPECT_TRUE(s.snapshot(0));
+	EXPECT_FALSE(s.snapshot(0.1));
+
+	EXPECT_EQ(s.ticks(0.05, skipped), 0u);
+	EXPECT_EQ(s.ticks(0.1, skipped), 1u);
+	EXPECT_EQ(s.ticks(0.15, skipped), 0u);
+	EXPECT_DOUBLE_EQ(s.wakeup(), 0.2);
+	EXPECT_EQ(s.ticks(0.35, skipped), 2u);
+	EXPECT_EQ(skipped, 0u);
+
+	EXPECT_TRUE(s.snapshot(0.2));
+}
+
+TEST(TickScheduler, CatchUpIsCapped) {
+	TickScheduler s(10, 10, 4);
+	uint64_t skipped = 0;
+
+	s.reset(0);
+
+	// one hiccup of a second
+	EXPECT_EQ(s.ticks(1.05, skipped), 4u);
+	EXPECT_EQ(skipped, 6u);
+
+	// back on schedule without a burst
+	EXPECT_EQ(s.ticks(1.09, skipped), 0u);
+	EXPECT_EQ(s.ticks(1.11, skipped), 1u);
+
+	// missed snapshots are dropped
+	EXPECT_TRUE(s.snapshot(1.05));
+	EXPECT_FALSE(s.snapshot(1.1));
+	EXPECT_TRUE(s.snapshot(1.16));
+}
+
+}
@@ -0,0 +1,142 @@
+#include "../src/world/spatial.hpp"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+
+namespace aoe {
+
+class SpatialFixture : public ::testing::Test {
+protected:
+	SpatialIndex s;
+	std::vector<IdPoolRef> found;
+
+	// not a multiple of cell_size, so the last cells are partially used
+	static constexpr unsigned size = 3 * SpatialIndex::cell_size + 5;
+	static constexpr float edge = (float)SpatialIndex::cell_size;
+
+	void SetUp() override {
+		s.resize(size, size);
+	}
+
+	static IdPoolRef ref(unsigned i) {
+		return IdPoolRef(i, 0);
+	}
+
+	void query(float x, float y, float r) {
+		found.clear();
+		s.query(x, y, r, [this](IdPoolRef ref) { found.emplace_back(ref); });
+		std::sort(found.begin(), found.end());
+	}
+
+	void query_rect(float x0, float y0, float x1, float y1) {
+		found.clear();
+		s.query_rect(x0, y0, x1, y1, [this](IdPoolRef ref) { found.emplace_back(ref); });
+		std::sort(found.begin(), found.end());
+	}
+
+	IdPoolRef nearest(float x, float y) {
+		return s.nearest(x, y, [](IdPoolRef) { return true; });
+	}
+};
+
+TEST_F(SpatialFixture, queryAcrossCellEdges) {
+	// either side of the edge between the first two cells
+	s.add(ref(1), edge - 0.01f, 5);
+	s.add(ref(2), edge, 5);
+	s.add(ref(3), edge + 1.5f, 5);
+
+	query(edge, 5, 1);
+	EXPECT_EQ(found, std::vector<IdPoolRef>({ ref(1), ref(2) }));
+
+	// the radius is inclusive
+	query(edge - 0.5f, 5, 2);
+	EXPECT_EQ(found, std::vector<IdPoolRef>({ ref(1), ref(2), ref(3) }));
+
+	query(edge + 3.5f, 5, 2);
+	EXPECT_EQ(found, std::vector<IdPoolRef>({ ref(3) }));
+
+	// moving it to the other cell must take it out of the old one
+	ASSERT_TRUE(s.move(ref(1), edge + 10, 5));
+	query(edge - 1, 5, 1);
+	EXPECT_EQ(found, std::vector<IdPoolRef>({ ref(2) }));
+	query(edge + 10, 5, 0);
+	EXPECT_EQ(found, std::vector<IdPoolRef>({ ref(1) }));
+}
+
+TEST_F(SpatialFixture, queryMapBorders) {
+	s.add(ref(1), 0, 0);
+	s.add(ref(2), size - 0.5f, size - 0.5f);
+
+	// circles that stick out of the map
+	query(-2, -2, 3);
+	EXPECT_EQ(found, std::vector<IdPoolRef>({ ref(1) }));
+
+	query(size + 1.0f, size + 1.0f, 3);
+	EXPECT_EQ(found, std::vector<IdPoolRef>({ ref(2) }));
+
+	query(size / 2.0f, size / 2.0f, 10 * size);
+	EXPECT_EQ(found.size(), 2u);
+
+	query(size + 100.0f, -100, 5);
+	EXPECT_TRUE(found.empty());
+
+	ASSERT_TRUE(s.remove(ref(2)));
+	EXPECT_FALSE(s.remove(ref(2)));
+	query(size / 2.0f, size / 2.0f, 10 * size);
+	EXPECT_EQ(found, std::vector<IdPoolRef>({ ref(1) }));
+}
+
+TEST_F(SpatialFixture, queryRect) {
+	s.add(ref(1), edge - 1, edge - 1);
+	s.add(ref(2), edge, edge);
+	s.add(ref(3), 2 * edge, 2 * edge + 1);
+	s.add(ref(4), size - 1, 0);
+
+	// inclusive on all sides
+	query_rect(edge - 1, edge - 1, edge, edge);
+	EXPECT_EQ(found, std::vector<IdPoolRef>({ ref(1), ref(2) }));
+
+	query_rect(edge - 0.5f, edge - 0.5f, 2 * edge, 2 * edge + 1);
+	EXPECT_EQ(found, std::vector<IdPoolRef>({ ref(2), ref(3) }));
+
+	// rectangles that stick out of the map
+	query_rect(-10, -10, edge - 1, edge - 1);
+	EXPECT_EQ(found, std::vector<IdPoolRef>({ ref(1) }));
+
+	query_rect(size - 2.0f, -5, size + 5.0f, 1);
+	EXPECT_EQ(found, std::vector<IdPoolRef>({ ref(4) }));
+
+	query_rect(-1, -1, size + 1.0f, size + 1.0f);
+	EXPECT_EQ(found.size(), 4u);
+}
+
+TEST_F(SpatialFixture, nearest) {
+	EXPECT_EQ(nearest(5, 5), invalid_ref);
+
+	// closer item in the next cell wins from one in the same cell
+	s.add(ref(1), 1, 8);
+	s.add(ref(2), edge + 0.1f, 8);
+	EXPECT_EQ(nearest(edge - 0.1f, 8), ref(2));
+	EXPECT_EQ(nearest(2, 8), ref(1));
+
+	// only thing left is in the opposite corner of the map
+	s.clear();
+	s.resize(size, size);
+	s.add(ref(3), size - 1, size - 1);
+	EXPECT_EQ(nearest(0, 0), ref(3));
+	EXPECT_EQ(nearest(-10, -10), ref(3));
+
+	s.add(ref(4), 0, size - 1);
+	EXPECT_EQ(nearest(size + 10.0f, size + 10.0f), ref(3));
+	EXPECT_EQ(nearest(-1, size - 2.0f), ref(4));
+
+	// skip what the predicate rejects
+	IdPoolRef r = s.nearest(-1, size - 2.0f, [](IdPoolRef r) { return r != IdPoolRef(4, 0); });
+	EXPECT_EQ(r, ref(3));
+
+	r = s.nearest(0, 0, [](IdPoolRef) { return false; });
+	EXPECT_EQ(r, invalid_ref);
+}
+
+}
@@ -0,0 +1,70 @@
+#include "../src/world/timer.hpp"
+
+#include <random>
+
+#include <gtest/gtest.h>
+
+namespace aoe {
+
+TEST(TimerWheel, FiresInOrder) {
+	TimerWheel tw;
+	std::vector<EntityTimer> due;
+
+	tw.schedule(EntityTimer(5, IdPoolRef(2, 0), EntityTimerType::decayed));
+	tw.schedule(EntityTimer(5, IdPoolRef(1, 0), EntityTimerType::decayed));
+	tw.schedule(EntityTimer(3, IdPoolRef(3, 0), EntityTimerType::died));
+	ASSERT_EQ(tw.size(), 3u);
+
+	tw.advance(2, due);
+	EXPECT_TRUE(due.empty());
+
+	tw.advance(5, due);
+	ASSERT_EQ(due.size(), 3u);
+	EXPECT_EQ(due[0].ref, IdPoolRef(3, 0));
+	EXPECT_EQ(due[1].ref, IdPoolRef(1, 0));
+	EXPECT_EQ(due[2].ref, IdPoolRef(2, 0));
+	EXPECT_EQ(tw.size(), 0u);
+}
+
+TEST(TimerWheel, LateTimerFiresNextTick) {
+	TimerWheel tw;
+	std::vector<EntityTimer> due;
+
+	tw.reset(100);
+	tw.schedule(EntityTimer(90, IdPoolRef(1, 0), EntityTimerType::died));
+
+	tw.advance(101, due);
+	ASSERT_EQ(due.size(), 1u);
+	EXPECT_EQ(due[0].tick, 101u);
+}
+
+TEST(TimerWheel, MatchesSortedList) {
+	TimerWheel tw;
+	std::vector<EntityTimer> expected, due;
+	std::mt19937 rng(7);
+
+	tw.reset(1000);
+
+	// all levels, including the overflow list
+	for (unsigned i = 0; i < 2000; ++i) {
+		uint32_t delay = 1 + (i % 100 == 0 ? (1u << 24) + rng() % 1000 : rng() % (1u << (3 * i % 23 + 1)));
+		EntityTimer t(1000 + delay, IdPoolRef(i + 1, 0), EntityTimerType::died);
+
+		tw.schedule(t);
+		expected.emplace_back(t);
+	}
+
+	std::sort(expected.begin(), expected.end());
+
+	for (uint32_t tick = 1000; tw.size(); tick += 1 + rng() % 5000)
+		tw.advance(tick, due);
+
+	ASSERT_EQ(due.size(), expected.size());
+
+	for (size_t i = 0; i < due.size(); ++i) {
+		EXPECT_EQ(due[i].ref, expected[i].ref) << "timer " << i;
+		EXPECT_EQ(due[i].tick, expected[i].tick) << "timer " << i;
+	}
+}
+
+}
@@ -0,0 +1,418 @@
+#include "../src/server.hpp"
+
+#include <cmath>
+
+#include <gtest/gtest.h>
+
+namespace aoe {
+
+class WorldFixture : public ::testing::Test {
+protected:
+	NullServer srv;
+
+	/** Two armies fighting each other, some priests converting and villagers gathering behind the lines. */
+	void battle(World &w, unsigned threads) {
+		ScenarioSettings scn;
+
+		scn.width = scn.height = 64;
+		scn.seed = 1;
+		scn.type = TerrainType::flat;
+		scn.players.emplace_back("red", 0, 1, scn.res);
+		scn.players.emplace_back("blue", 1, 2, scn.res);
+
+		w.tick_threads = threads;
+		w.start_lockstep(srv, scn);
+
+		std::vector<IdPoolRef> red, blue;
+
+		for (unsigned i = 0; i < 1200; ++i) {
+			float x = (i / 60) * 0.4f, y = 2 + (i % 60) * 1.0f;
+
+			red.emplace_back(w.add_unit(EntityType::melee1, 1, 20 - x, y, 0));
+			blue.emplace_back(w.add_unit(i % 10 ? EntityType::melee1 : EntityType::priest, 2, 24 + x, y, M_PI));
+		}
+
+		// the host may give orders to anyone
+		LockstepFrame f(0, 0);
+
+		for (size_t i = 0; i < red.size(); ++i) {
+			f.inputs.emplace_back(invalid_ref, WorldEventType::entity_task, EntityTask(EntityTaskType::infer, red[i], blue[i * 7 % blue.size()]));
+			f.inputs.emplace_back(invalid_ref, WorldEventType::entity_task, EntityTask(EntityTaskType::infer, blue[i], red[i * 3 % red.size()]));
+		}
+
+		for (unsigned i = 0; i < 100; ++i) {
+			float y = 2 + (i % 50) * 1.2f;
+
+			IdPoolRef res = w.add_resource(i % 2 ? EntityType::berries : EntityType::gold, 5, y, 0);
+			IdPoolRef v = w.add_unit(EntityType::villager, 1 + i % 2, 6, y, 0);
+			f.inputs.emplace_back(invalid_ref, WorldEventType::entity_task, EntityTask(EntityTaskType::infer, v, res));
+		}
+
+		std::vector<NetStateHash> hashes;
+		w.step_lockstep(f, hashes);
+	}
+
+	void tick(World &w) {
+		std::vector<NetStateHash> hashes;
+		w.step_lockstep(LockstepFrame(w.tick_count(), 1), hashes);
+	}
+
+	void expect_same(const World &a, const World &b) {
+		const IdPool<Entity> &pa = a.entity_pool(), &pb = b.entity_pool();
+		ASSERT_EQ(pa.size(), pb.size());
+
+		for (auto ia = pa.begin(), ib = pb.begin(); ia != pa.end(); ++ia, ++ib) {
+			const Entity &ea = ia->second, &eb = ib->second;
+
+			ASSERT_EQ(ea.ref, eb.ref);
+			ASSERT_EQ(ea.type, eb.type);
+			ASSERT_EQ(ea.playerid, eb.playerid);
+			ASSERT_EQ(ea.x, eb.x);
+			ASSERT_EQ(ea.y, eb.y);
+			ASSERT_EQ(ea.angle, eb.angle);
+			ASSERT_EQ(ea.target_ref, eb.target_ref);
+			ASSERT_EQ(ea.subimage, eb.subimage);
+			ASSERT_EQ(ea.state, eb.state);
+			ASSERT_EQ(ea.hp, eb.hp);
+		}
+
+		ASSERT_EQ(a.busy_entities(), b.busy_entities());
+		ASSERT_EQ(a.state_hash(), b.state_hash());
+
+		for (size_t i = 0; i < a.player_list().size(); ++i) {
+			Player pa = a.player_list()[i], pb = b.player_list()[i];
+			PlayerAchievements sa(pa.get_score()), sb(pb.get_score());
+
+			ASSERT_EQ(pa.res.food, pb.res.food);
+			ASSERT_EQ(pa.res.gold, pb.res.gold);
+			ASSERT_EQ(sa.kills, sb.kills);
+			ASSERT_EQ(sa.losses, sb.losses);
+		}
+	}
+
+	static size_t kills(const World &w) {
+		size_t n = 0;
+
+		for (Player p : w.player_list())
+			n += p.get_score().kills;
+
+		return n;
+	}
+
+	/** Small random map with two players, where (1::0) controls the first one. */
+	static ScenarioSettings lockstep_scn() {
+		ScenarioSettings scn;
+
+		scn.width = scn.height = 48;
+		scn.seed = 1234;
+		scn.lockstep = true;
+		scn.players.emplace_back("you", 0, 1, scn.res);
+		scn.players.emplace_back("them", 1, 2, scn.res);
+		scn.owners[IdPoolRef(1, 0)] = 1;
+
+		return scn;
+	}
+
+	static const Entity &entity(const World &w, IdPoolRef ref) {
+		const Entity *e = w.entity_pool().try_get(ref);
+		if (!e)
+			throw std::out_of_range("bad ref");
+
+		return *e;
+	}
+
+	static bool exists(const World &w, IdPoolRef ref) {
+		return w.entity_pool().try_get(ref) != nullptr;
+	}
+
+	static const std::set<IdPoolRef> &active(const World &w) {
+		return w.busy_entities();
+	}
+
+	static IdPoolRef unit_of(const World &w, unsigned player) {
+		for (auto &kv : w.entity_pool())
+			if (kv.second.playerid == player && !kv.second.is_building())
+				return kv.first;
+
+		return invalid_ref;
+	}
+};
+
+TEST_F(WorldFixture, tickParallelMatchesSerial) {
+	World serial, parallel;
+
+	battle(serial, 1);
+	battle(parallel, 4);
+
+	for (unsigned i = 0; i < 500; ++i) {
+		tick(serial);
+		tick(parallel);
+
+		expect_same(serial, parallel);
+		if (HasFatalFailure())
+			FAIL() << "diverged at tick " << i;
+	}
+
+	// make sure the battle actually did something
+	EXPECT_GT(kills(serial), 0u);
+}
+
+TEST_F(WorldFixture, lockstepSameInputsSameHash) {
+	ScenarioSettings scn(lockstep_scn());
+	NullServer s2, s3;
+	World a, b, c;
+
+	a.start_lockstep(srv, scn);
+	b.start_lockstep(s2, scn);
+	c.start_lockstep(s3, scn);
+
+	ASSERT_EQ(a.state_hash(), b.state_hash());
+	ASSERT_EQ(a.state_hash(), c.state_hash());
+
+	IdPoolRef unit = unit_of(a, 1);
+	ASSERT_NE(unit, invalid_ref);
+
+	// c doesn't get the move order
+	LockstepFrame f(0, World::hash_interval), idle(0, World::hash_interval);
+	f.inputs.emplace_back(IdPoolRef(1, 0), WorldEventType::entity_task, EntityTask(unit, 10, 10));
+
+	std::vector<NetStateHash> ha, hb, hc;
+
+	for (unsigned i = 0; i < 4; ++i) {
+		f.tick = idle.tick = i * World::hash_interval;
+
+		a.step_lockstep(f, ha);
+		b.step_lockstep(f, hb);
+		c.step_lockstep(idle, hc);
+
+		f.inputs.clear();
+	}
+
+	ASSERT_EQ(ha.size(), 4u);
+	ASSERT_EQ(hb.size(), ha.size());
+	ASSERT_EQ(hc.size(), ha.size());
+
+	for (size_t i = 0; i < ha.size(); ++i) {
+		EXPECT_EQ(ha[i].tick, (i + 1) * World::hash_interval);
+		EXPECT_EQ(ha[i].hash, hb[i].hash);
+		EXPECT_NE(ha[i].hash, hc[i].hash);
+	}
+}
+
+TEST_F(WorldFixture, idleUnitsAreNotTicked) {
+	World w;
+	w.start_lockstep(srv, lockstep_scn());
+
+	// nobody has anything to do yet
+	EXPECT_TRUE(active(w).empty());
+
+	IdPoolRef unit = unit_of(w, 1);
+	ASSERT_NE(unit, invalid_ref);
+
+	const Entity &e = entity(w, unit);
+	LockstepFrame f(0, 0);
+	f.inputs.emplace_back(IdPoolRef(1, 0), WorldEventType::entity_task, EntityTask(unit, (uint32_t)e.x + 2, (uint32_t)e.y));
+
+	std::vector<NetStateHash> hashes;
+	w.step_lockstep(f, hashes);
+
+	ASSERT_EQ(entity(w, unit).state, EntityState::moving);
+	EXPECT_EQ(active(w), std::set<IdPoolRef>{ unit });
+
+	// plenty of time to get there or to give up
+	w.step_lockstep(LockstepFrame(0, 30 * World::hash_interval), hashes);
+
+	EXPECT_EQ(entity(w, unit).state, EntityState::alive);
+	EXPECT_TRUE(active(w).empty());
+}
+
+TEST_F(WorldFixture, deadUnitsRotAway) {
+	World w;
+	w.start_lockstep(srv, lockstep_scn());
+
+	IdPoolRef unit = unit_of(w, 1);
+	ASSERT_NE(unit, invalid_ref);
+
+	LockstepFrame f(0, 1);
+	f.inputs.emplace_back(IdPoolRef(1, 0), WorldEventType::entity_kill, unit);
+
+	std::vector<NetStateHash> hashes;
+	w.step_lockstep(f, hashes);
+
+	// corpses just wait for their timers
+	ASSERT_EQ(entity(w, unit).state, EntityState::dying);
+	EXPECT_TRUE(active(w).empty());
+
+	uint32_t tick = 1;
+	for (; tick < 100 && entity(w, unit).state == EntityState::dying; ++tick)
+		w.step_lockstep(LockstepFrame(tick, 1), hashes);
+
+	ASSERT_EQ(entity(w, unit).state, EntityState::decaying);
+
+	w.step_lockstep(LockstepFrame(tick, 200 * World::hash_interval), hashes);
+	EXPECT_FALSE(exists(w, unit));
+}
+
+TEST_F(WorldFixture, trainOnlyUnits) {
+	World w;
+	w.start_lockstep(srv, lockstep_scn());
+
+	IdPoolRef tc = invalid_ref;
+	for (auto &kv : w.entity_pool())
+		if (kv.second.playerid == 1 && kv.second.type == EntityType::town_center)
+			tc = kv.first;
+
+	ASSERT_NE(tc, invalid_ref);
+	size_t count = w.entity_pool().size();
+
+	// whatever a peer sends, only units can be trained
+	LockstepFrame f(0, 1);
+	for (EntityType t : { EntityType::barracks, EntityType::gold, EntityType::max, (EntityType)1000 })
+		f.inputs.emplace_back(invalid_ref, WorldEventType::entity_task, EntityTask(tc, t));
+
+	std::vector<NetStateHash> hashes;
+	w.step_lockstep(f, hashes);
+	EXPECT_EQ(w.entity_pool().size(), count);
+
+	f = LockstepFrame(w.tick_count(), 1);
+	f.inputs.emplace_back(invalid_ref, WorldEventType::entity_task, EntityTask(tc, EntityType::villager));
+	w.step_lockstep(f, hashes);
+	EXPECT_EQ(w.entity_pool().size(), count + 1);
+}
+
+/** Kill the first unit of player 1 and return the number of ticks until its corpse starts decaying. */
+static unsigned death_ticks(World &w) {
+	IdPoolRef unit = invalid_ref;
+	for (auto &kv : w.entity_pool())
+		if (kv.second.playerid == 1 && !kv.second.is_building()) {
+			unit = kv.first;
+			break;
+		}
+
+	if (unit == invalid_ref)
+		return 0;
+
+	std::vector<NetStateHash> hashes;
+	LockstepFrame f(w.tick_count(), 1);
+	f.inputs.emplace_back(IdPoolRef(1, 0), WorldEventType::entity_kill, unit);
+	w.step_lockstep(f, hashes);
+
+	unsigned n = 1;
+	for (; n < 1000; ++n) {
+		const Entity *e = w.entity_pool().try_get(unit);
+		if (!e || e->state != EntityState::dying)
+			break;
+
+		w.step_lockstep(LockstepFrame(w.tick_count(), 1), hashes);
+	}
+
+	return n;
+}
+
+TEST_F(WorldFixture, reusedWorldStartsFresh) {
+	ScenarioSettings scn(lockstep_scn());
+	NullServer s2;
+	World fresh, reused;
+
+	// play a while, so the timers are well past tick 0
+	reused.start_lockstep(s2, scn);
+	std::vector<NetStateHash> hashes;
+	reused.step_lockstep(LockstepFrame(0, 5 * World::hash_interval), hashes);
+
+	fresh.start_lockstep(srv, scn);
+	reused.start_lockstep(s2, scn);
+	EXPECT_EQ(reused.tick_count(), 0u);
+
+	unsigned exp = death_ticks(fresh);
+	ASSERT_GT(exp, 1u);
+	EXPECT_EQ(death_ticks(reused), exp);
+}
+
+TEST_F(WorldFixture, replayPlaysSameGame) {
+	ScenarioSettings scn(lockstep_scn());
+	std::string path(::testing::TempDir() + "world.replay");
+	World a;
+
+	a.start_lockstep(srv, scn);
+	IdPoolRef unit = unit_of(a, 1);
+	ASSERT_NE(unit, invalid_ref);
+
+	std::vector<NetStateHash> ha;
+	{
+		ReplayWriter out(path, a.scn);
+
+		// one tick at a time, just like the server
+		for (uint32_t tick = 0; tick < 3 * World::hash_interval; ++tick) {
+			LockstepFrame f(tick, 1);
+			if (tick == 5)
+				f.inputs.emplace_back(IdPoolRef(1, 0), WorldEventType::entity_task, EntityTask(unit, 20, 20));
+
+			out.frame(f.tick, f.steps, f.inputs);
+
+			size_t n = ha.size();
+			a.step_lockstep(f, ha);
+
+			for (; n < ha.size(); ++n)
+				out.hash(ha[n].tick, ha[n].hash);
+		}
+	}
+
+	Replay r;
+	r.load(path);
+	remove(path.c_str());
+
+	EXPECT_EQ(r.scn.seed, scn.seed);
+	EXPECT_EQ(r.scn.players.size(), a.scn.players.size());
+	EXPECT_EQ(r.scn.owners, scn.owners);
+	// empty frames are merged
+	EXPECT_LT(r.frames.size(), 10u);
+	ASSERT_EQ(r.hashes.size(), ha.size());
+
+	NullServer s2;
+	World b;
+	std::vector<NetStateHash> hb;
+
+	b.start_lockstep(s2, r.scn);
+	for (const LockstepFrame &f : r.frames)
+		b.step_lockstep(f, hb);
+
+	ASSERT_EQ(hb.size(), ha.size());
+	for (size_t i = 0; i < ha.size(); ++i) {
+		EXPECT_EQ(r.hashes[i].hash, ha[i].hash);
+		EXPECT_EQ(hb[i].hash, ha[i].hash);
+	}
+}
+
+TEST(EntityMotion, legsEndExactlyAtWaypoint) {
+	EntityMotion mv;
+
+	// odd count, so both the vector loop and the remainder get some lanes
+	for (unsigned i = 0; i < 11; ++i)
+		mv.add(i, Fixed(1.0f), Fixed(2.0f), Fixed(1.0f + i * 0.1f), Fixed(1.5f), Fixed(0.04f), Fixed(-0.02f), i + 1);
+
+	for (unsigned t = 1; t <= 11; ++t) {
+		mv.step();
+
+		for (unsigned i = 0; i < 11; ++i) {
+			ASSERT_EQ(mv.arrived[i], t == i + 1 ? 1 : 0) << "lane " << i << " tick " << t;
+
+			if (t < i + 1) {
+				EXPECT_EQ(mv.x[i], Fixed(1.0f).raw + (int32_t)t * Fixed(0.04f).raw);
+				EXPECT_EQ(mv.y[i], Fixed(2.0f).raw - (int32_t)t * Fixed(0.02f).raw);
+			} else {
+				EXPECT_EQ(mv.x[i], Fixed(1.0f + i * 0.1f).raw);
+				EXPECT_EQ(mv.y[i], Fixed(1.5f).raw);
+			}
+		}
+
+		// Entity::walk would start a new leg, just park them
+		for (unsigned i = 0; i < 11; ++i) {
+			if (mv.arrived[i]) {
+				mv.dx[i] = mv.dy[i] = 0;
+				mv.ticks[i] = INT32_MAX;
+			}
+		}
+	}
+}
+
+}
@@ -0,0 +1,104 @@
+# Turn doc/reverse_engineering/unit_stats_aoe.csv into UnitStats initializers for game/src/world/entity_info.hpp
+# usage: cmake -DIN=unit_stats_aoe.csv -DOUT=unit_stats_aoe.inc -P unit_stats.cmake
+
+cmake_minimum_required(VERSION 3.11)
+
+if (NOT IN OR NOT OUT)
+	message(FATAL_ERROR "usage: cmake -DIN=<csv> -DOUT=<inc> -P unit_stats.cmake")
+endif()
+
+file(READ "${IN}" csv)
+
+# cmake lists are separated by semicolons, so get rid of the ones in the notes first
+string(REPLACE ";" "," csv "${csv}")
+string(REPLACE "\r" "" csv "${csv}")
+string(REPLACE "\n" ";" lines "${csv}")
+
+# skip header
+list(REMOVE_AT lines 0)
+
+get_filename_component(src "${IN}" NAME)
+set(out "// generated from ${src} by tools/unit_stats.cmake. do not edit\n")
+
+foreach(line IN LISTS lines)
+	if (line STREQUAL "")
+		continue()
+	endif()
+
+	string(REPLACE "," ";" cols "${line}")
+	list(LENGTH cols n)
+	if (n LESS 17)
+		message(FATAL_ERROR "${IN}: expected at least 17 columns: ${line}")
+	endif()
+
+	set(v "")
+	foreach(i RANGE 16)
+		list(GET cols ${i} c)
+		string(STRIP "${c}" c)
+		list(APPEND v "${c}")
+	endforeach()
+
+	list(GET v 0 name)
+	list(GET v 1 age)
+	list(GET v 4 atk_type)
+	list(GET v 11 speed)
+
+	if (age STREQUAL "I")
+		set(age 1)
+	elseif (age STREQUAL "II")
+		set(age 2)
+	elseif (age STREQUAL "III")
+		set(age 3)
+	elseif (age STREQUAL "IV")
+		set(age 4)
+	else()
+		message(FATAL_ERROR "${IN}: ${name}: bad age: ${age}")
+	endif()
+
+	if (atk_type STREQUAL "M")
+		set(atk_type melee)
+	elseif (atk_type STREQUAL "P")
+		set(atk_type pierce)
+	else()
+		set(atk_type none)
+	endif()
+
+	if (speed STREQUAL "S")
+		set(speed slow)
+	elseif (speed STREQUAL "M")
+		set(speed medium)
+	elseif (speed STREQUAL "F")
+		set(speed fast)
+	else()
+		message(FATAL_ERROR "${IN}: ${name}: bad speed: ${speed}")
+	endif()
+
+	list(GET v 2 hp)
+	list(GET v 3 atk)
+	list(GET v 5 reload)
+	if (NOT reload MATCHES "\\.")
+		string(APPEND reload ".0")
+	endif()
+	list(GET v 6 armor_melee)
+	list(GET v 7 armor_pierce)
+	list(GET v 8 los)
+	list(GET v 9 range)
+	list(GET v 10 accuracy)
+	list(GET v 12 train)
+	list(GET v 13 food)
+	list(GET v 14 wood)
+	list(GET v 15 stone)
+	list(GET v 16 gold)
+
+	string(APPEND out "{\"${name}\", ${age}, ${hp}, ${atk}, AttackType::${atk_type}, ${reload}f, ${armor_melee}, ${armor_pierce}, ${los}, ${range}, ${accuracy}, UnitSpeed::${speed}, ${train}, Resources(${wood}, ${food}, ${gold}, ${stone})},\n")
+endforeach()
+
+# don't touch the output if nothing has changed, so we don't rebuild everything that includes it
+if (EXISTS "${OUT}")
+	file(READ "${OUT}" old)
+	if (old STREQUAL out)
+		return()
+	endif()
+endif()
+
+file(WRITE "${OUT}" "${out}")